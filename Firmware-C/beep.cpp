@@ -78,26 +78,26 @@ void BeepHz( int Hz , int Delay )
 
 void BeepTune(void)
 {
-//  BeepHz( 1174, 150 );           //D5
-//  BeepHz( 1318, 150 );           //E5
-//  BeepHz( 1046, 150 );           //C5
-//  BeepHz(  522, 150 );           //C4
-//  BeepHz(  784, 300 );           //G4
-
-  BeepHz( 1046, 150 );           //C5
-  BeepHz( 1318, 300 );           //E5
+//  BeepQueue( 1174, 150 );        //D5
+//  BeepQueue( 1318, 150 );        //E5
+//  BeepQueue( 1046, 150 );        //C5
+//  BeepQueue(  522, 150 );        //C4
+//  BeepQueue(  784, 300 );        //G4
+
+  BeepQueue( 1046, 150 );        //C5
+  BeepQueue( 1318, 300 );        //E5
 }
 
 
 void Beep(void)
 {
-  BeepHz( 5000 , 80 );
+  BeepQueue( 5000 , 80 );
 }
 
 void Beep2(void)
 {
   Beep();
-  waitcnt( 5000000 + CNT );
+  BeepQueue( 0, 62 );   // 5000000 cycles
   Beep();
 }  
 
@@ -105,9 +105,9 @@ void Beep2(void)
 void Beep3(void)
 {
   Beep();
-  waitcnt( 5000000 + CNT );
+  BeepQueue( 0, 62 );
   Beep();
-  waitcnt( 5000000 + CNT );
+  BeepQueue( 0, 62 );
   Beep();
 }
 
@@ -161,3 +161,73 @@ void BeepOff( int CtrAB )
   else if (CtrAB == 'B' )
     CTRB = 0;
 }
+
+
+#define BEEP_QUEUE  16    // Notes waiting to play - must be a power of 2
+
+static struct BEEPNOTE {
+  short Hz;               // 0 for a rest
+  short Delay;            // milliseconds
+} Notes[BEEP_QUEUE];
+
+static unsigned char NoteHead, NoteTail;  // Next note to play, next free slot
+static char Playing;
+static int  NoteEnd;                      // CNT when the current note is up
+static int  SavedCtr, SavedFrq;           // What counter A was doing before the queue started playing
+
+void BeepQueue( int Hz , int Delay )
+{
+  unsigned char next = (NoteTail + 1) & (BEEP_QUEUE-1);
+  if( next == NoteHead ) return;          // Full - drop it rather than wait
+
+  Notes[NoteTail].Hz = Hz;
+  Notes[NoteTail].Delay = Delay;
+  NoteTail = next;
+
+  if( !Playing ) {
+    Beep_Tick();                          // Start it now, not on the next loop
+  }
+}
+
+void Beep_Tick(void)
+{
+  if( !Playing ) {
+    if( NoteHead == NoteTail ) return;
+    SavedCtr = CTRA;
+    SavedFrq = FRQA;
+    Playing = 1;
+  }
+  else if( (int)(CNT - NoteEnd) < 0 ) {
+    return;                               // Current note isn't finished
+  }
+
+  if( NoteHead == NoteTail ) {
+    FRQA = SavedFrq;                      // All done - back to what counter A was doing before
+    CTRA = SavedCtr;
+    Playing = 0;
+    return;
+  }
+
+  BEEPNOTE & n = Notes[NoteHead];
+  NoteHead = (NoteHead + 1) & (BEEP_QUEUE-1);
+
+  if( n.Hz ) {
+    if( PIN_BUZZER_1 == PIN_BUZZER_2 ) {
+      CTRA = (4 << 26) | PIN_BUZZER_1;                                // NCO on the one buzzer pin
+    }
+    else {
+      CTRA = (5 << 26) | (PIN_BUZZER_2 << 9) | PIN_BUZZER_1;          // NCO differential - buzzer 2 is the inverse of buzzer 1
+    }
+    FRQA = (n.Hz * 3436) >> 6;    // Hz * 2^32 / 80MHz, without the long division in fraction()
+    DIRA |= (1<<PIN_BUZZER_1) | (1<<PIN_BUZZER_2);
+  }
+  else {
+    CTRA = 0;   // Rest
+  }
+  NoteEnd = CNT + n.Delay * (80000000/1000);
+}
+
+int Beep_Playing(void)
+{
+  return Playing;
+}
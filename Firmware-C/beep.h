@@ -23,13 +23,22 @@
 */
 
 
-void BeepHz( int Hz , int Delay );
+void BeepHz( int Hz , int Delay );     // Bit-bangs the tone, and returns when it's done
+
+// These queue their notes and return right away - Beep_Tick() plays them on counter A
 void BeepTune(void);
 
 void Beep(void);
 void Beep2(void);
 void Beep3(void);
 
+// Queued tones.  Beep_Tick() is called once per main loop, and starts the next note (or rest, Hz = 0) when the
+// current one is up, so a tune costs the loop a few counter writes, not the length of the tune.  Counter A
+// is put back to whatever it was doing (an alarm tone, or nothing) when the queue runs out.
+void BeepQueue( int Hz , int Delay );
+void Beep_Tick(void);
+int  Beep_Playing(void);
+
 void BeepOn(int CtrAB, int Pin, int Freq);
 void BeepOff(int CtrAB);
 
@@ -0,0 +1,144 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+#include "biquad.h"
+
+#define Biquad_One14  16384     // 1.0 in 2.14, used while working out the coefficients
+#define Biquad_Bits   13        // Fraction bits of the coefficients
+
+
+// Sine of Phase, where 16384 is 90 degrees (0 to 16384 only), in 2.14.  Taylor series to x^7, which
+// is within 4 counts over the quarter circle.
+static int Sine( int Phase )
+{
+  int x = (Phase * 25736 + 8192) >> 14;       // To radians, 2.14 (PI/2 = 25736)
+  int x2 = (x * x) >> 14;
+
+  int t = Biquad_One14 - x2 / 42;
+  t = Biquad_One14 - ((x2 * t) >> 14) / 20;
+  t = Biquad_One14 - ((x2 * t) >> 14) / 6;
+
+  int s = (x * t) >> 14;
+  return (s > Biquad_One14) ? Biquad_One14 : s;
+}
+
+// Sine and cosine of 2*PI * Freq / SampleRate - Freq must be under SampleRate / 2
+static void SinCos( int Freq, int SampleRate, int & s, int & c )
+{
+  int Phase = (Freq << 16) / SampleRate;      // 65536 is a full turn, so this is under 32768
+
+  if( Phase <= 16384 ) {
+    s = Sine( Phase );
+    c = Sine( 16384 - Phase );
+  }
+  else {
+    s = Sine( 32768 - Phase );
+    c = -Sine( Phase - 16384 );
+  }
+}
+
+// Num / Den, both 2.14, as a rounded 2.13 coefficient
+static long Ratio( int Num, int Den )
+{
+  int n = Num << Biquad_Bits;
+  n += (n < 0) ? -(Den >> 1) : (Den >> 1);
+  return n / Den;
+}
+
+
+void Biquad_Reset( BIQUAD & f )
+{
+  f.X1 = f.X2 = 0;
+  f.Y1 = f.Y2 = 0;
+  f.Err = 0;
+}
+
+void Biquad_SetOff( BIQUAD & f )
+{
+  f.Type = Biquad_Off;
+  f.B0 = 1 << Biquad_Bits;
+  f.A1 = f.A2 = 0;
+  Biquad_Reset( f );
+}
+
+// From the RBJ Audio EQ Cookbook.  a1 and a2 are computed, and b0 is then picked from them to give
+// unity gain at DC (the notch too), so rounding b0 on its own doesn't throw the DC gain off.
+
+void Biquad_SetLowpass( BIQUAD & f, int Freq, int SampleRate )
+{
+  if( Freq <= 0 || Freq*2 >= SampleRate ) {
+    Biquad_SetOff( f );
+    return;
+  }
+
+  int s, c;
+  SinCos( Freq, SampleRate, s, c );
+
+  int alpha = (s * 11585) >> 14;              // sin(w) / (2 * Q), Q = 0.7071
+  int a0 = Biquad_One14 + alpha;
+
+  f.A1 = Ratio( -2 * c, a0 );
+  f.A2 = Ratio( Biquad_One14 - alpha, a0 );
+  f.B0 = ((1 << Biquad_Bits) + f.A1 + f.A2 + 2) >> 2;    // b0 + b1 + b2 = 4 * b0 = 1 + a1 + a2
+  f.Type = Biquad_Lowpass;
+  Biquad_Reset( f );
+}
+
+void Biquad_SetNotch( BIQUAD & f, int Freq, int Width, int SampleRate )
+{
+  if( Freq <= 0 || Width <= 0 || Freq*2 >= SampleRate ) {
+    Biquad_SetOff( f );
+    return;
+  }
+
+  int s, c;
+  SinCos( Freq, SampleRate, s, c );
+
+  int alpha = s * Width / (Freq * 2);         // sin(w) / (2 * Q), Q = Freq / Width
+  int a0 = Biquad_One14 + alpha;
+
+  f.A1 = Ratio( -2 * c, a0 );
+  f.A2 = Ratio( Biquad_One14 - alpha, a0 );
+  f.B0 = ((1 << Biquad_Bits) + f.A2 + 1) >> 1;           // b0 + b1 + b2 = 2 * b0 + a1 = 1 + a1 + a2
+  f.Type = Biquad_Notch;
+  Biquad_Reset( f );
+}
+
+
+int Biquad_Filter( BIQUAD & f, int x )
+{
+  if( f.Type == Biquad_Off ) return x;
+
+  long acc = f.Err - f.A2 * f.Y2;
+
+  if( f.Type == Biquad_Lowpass ) {
+    acc += f.B0 * (x + (f.X1 << 1) + f.X2) - f.A1 * f.Y1;
+  }
+  else {
+    acc += f.B0 * (x + f.X2) + f.A1 * (f.X1 - f.Y1);
+  }
+
+  int y = acc >> Biquad_Bits;
+  f.Err = acc & ((1 << Biquad_Bits) - 1);    // Carry the dropped fraction into the next output, so a slow
+                                              // filter settles on the input instead of a few counts short
+  f.X2 = f.X1;  f.X1 = x;
+  f.Y2 = f.Y1;  f.Y1 = y;
+  return y;
+}
@@ -0,0 +1,63 @@
+#ifndef __BIQUAD_H__
+#define __BIQUAD_H__
+
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+/*
+  Biquad - Integer second order (biquad) lowpass and notch filters
+
+  The coefficients are worked out once, by Biquad_SetLowpass() / Biquad_SetNotch(), in 2.13 fixed point,
+  with sines from a short polynomial, so there's no float or math library code involved.  The inputs
+  must fit in 16 bits (the gyro readings do) - with 2.13 coefficients no sum can overflow 32 bits.
+
+  Both filter types have b2 = b0, and the lowpass has b1 = 2*b0 while the notch has b1 = a1, so each
+  one is run with 3 multiplies instead of the usual 5:
+
+    Lowpass:  y = b0*(x + 2*x1 + x2) - a1*y1 - a2*y2
+    Notch:    y = b0*(x + x2) + a1*(x1 - y1) - a2*y2
+
+  The Propeller has no multiply instruction, so the multiplies are most of the cost.  A filter that's
+  off just passes its input through.
+*/
+
+enum {
+  Biquad_Off = 0,
+  Biquad_Lowpass,
+  Biquad_Notch,
+};
+
+struct BIQUAD {
+  long B0, A1, A2;          // Coefficients, 2.13 fixed point (a0 is 1)
+  long X1, X2, Y1, Y2;      // The last two inputs and outputs
+  long Err;                 // Fraction dropped from the last output
+  char Type;
+};
+
+
+void Biquad_SetOff( BIQUAD & f );
+void Biquad_SetLowpass( BIQUAD & f, int Freq, int SampleRate );               // Butterworth (Q = 0.707), Freq is the -3dB point
+void Biquad_SetNotch( BIQUAD & f, int Freq, int Width, int SampleRate );      // Width is the bandwidth in the same units as Freq
+
+void Biquad_Reset( BIQUAD & f );          // Clear the history, keep the coefficients
+
+int  Biquad_Filter( BIQUAD & f, int x );
+
+#endif
@@ -0,0 +1,104 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+#include <stddef.h>
+
+#include "blackbox.h"
+#include "serial_4x.h"
+
+#define Blackbox_MaxFields  (offsetof(BLACKBOX_DATA, FlightMode) / sizeof(long))
+#define Blackbox_MaxFrame   (4 + Blackbox_MaxFields * 5 + 2)   // Sync, sequence, flags, the longest fields, checksum
+
+static long Prev[Blackbox_MaxFields];       // Field values in the last frame
+static unsigned char Frame[Blackbox_MaxFrame];
+static long PrevCounter;
+static char Logging;                        // Armed, and writing frames
+static char NeedKey;                        // The next frame has to be a keyframe
+static int  Dropped;
+
+
+// Zig-zag, then 7 bits per byte, low bits first
+static unsigned char * PutValue( unsigned char * p, long v )
+{
+  unsigned long z = ((unsigned long)v << 1) ^ (v >> 31);
+  while( z >= 0x80 ) {
+    *p++ = z | 0x80;
+    z >>= 7;
+  }
+  *p++ = z;
+  return p;
+}
+
+
+void Blackbox_Write( char port, const BLACKBOX_DATA * Data, int MotorCount, char Armed )
+{
+  if( !Armed ) {
+    Logging = 0;
+    return;
+  }
+
+  if( !Logging ) {
+    Logging = 1;
+    NeedKey = 1;
+  }
+  else if( (int)(Data->Counter - PrevCounter) > 1 ) {     // The comms cog missed some loops
+    Dropped += Data->Counter - PrevCounter - 1;
+    NeedKey = 1;
+  }
+  PrevCounter = Data->Counter;
+
+  if( (Data->Counter & (Blackbox_KeyInterval-1)) == 0 ) NeedKey = 1;
+
+  unsigned char * p = Frame;
+  *p++ = 0xE8;
+  *p++ = 0xB8;
+  *p++ = Data->Counter;
+  *p++ = NeedKey | (Data->FlightMode << 1) | (MotorCount << 4);
+
+  const long * v = &Data->Counter;
+  int Count = Blackbox_MaxFields - 8 + MotorCount;      // Motor[] is last, and only MotorCount of its 8 go out
+
+  for( int i=0; i<Count; i++ ) {
+    p = PutValue( p, NeedKey ? v[i] : v[i] - Prev[i] );
+    Prev[i] = v[i];
+  }
+
+  unsigned char sum1 = 0, sum2 = 0;
+  for( unsigned char * s = Frame + 2; s < p; s++ ) {
+    sum1 += *s;
+    sum2 += sum1;
+  }
+  *p++ = sum1;
+  *p++ = sum2;
+
+  if( S4_Try_Put_Bytes( port, Frame, p - Frame ) ) {
+    NeedKey = 0;
+  }
+  else {
+    Dropped++;                              // Prev[] has this frame's values now, so the next has to be a keyframe
+    NeedKey = 1;
+  }
+}
+
+
+int Blackbox_Dropped(void)
+{
+  return Dropped;
+}
@@ -0,0 +1,71 @@
+#ifndef __BLACKBOX_H__
+#define __BLACKBOX_H__
+
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+/*
+  Blackbox - binary flight log, one frame per loop, written to a serial port (port 3, on ENABLE_LOGGING builds)
+
+  The flight cog fills in a BLACKBOX_DATA with the telemetry snapshot, and the comms cog turns each one
+  into a frame, so the logging costs the flight loop a few dozen copies and no cog of its own.  Frames are
+  only written while armed.  Each frame is:
+
+    u8  : 0xE8      sync
+    u8  : 0xB8      sync
+    u8  : sequence  (low 8 bits of the loop counter)
+    u8  : flags     bit 0 = keyframe, bits 1-3 = FlightMode, bits 4-7 = MotorCount
+    ..  : fields    one per BLACKBOX_DATA long, in order, with MotorCount of the Motor[] values
+    u8  : sum1      sum of the bytes from the sequence through the last field, mod 256
+    u8  : sum2      sum of the sum1 values after each of those bytes, mod 256 (Fletcher-16)
+
+  Each field is the difference from that field's value in the previous frame - or, in a keyframe, the value
+  itself - zig-zag encoded ((d << 1) ^ (d >> 31), so small negative numbers are small too) and written 7 bits
+  per byte, low bits first, with the top bit set on every byte but the last.  Most fields change very little
+  from one loop to the next, so most take one byte.  There's no length - the field count comes from the
+  flags, and a reader that loses its place looks for the next sync bytes with a good checksum.
+
+  The first frame after arming is a keyframe, and so is every 64th loop, and the frame after any that
+  were dropped, so a reader can start anywhere and never applies a difference to the wrong frame.  Frames
+  are dropped, not waited for, when the transmit buffer is full, and also when the comms cog fell behind
+  and never saw a loop's snapshot.  Both are counted in Blackbox_Dropped(), and show up as gaps in the
+  sequence number.
+*/
+
+struct BLACKBOX_DATA {
+  long Counter;             // Main loop counter
+  long Sens[12];            // SENS from Temperature through AltRate - temp, gyro xyz, accel xyz, mag xyz, alt, alt rate
+  long Radio[8];            // Thro, Aile, Elev, Rudd, Gear, Aux1, Aux2, Aux3
+  long PID[5][4];           // Roll, pitch, yaw, altitude, ascent PIDs - P error, I error, D error, output
+  long Roll, Pitch;         // Estimator outputs
+  long PitchDifference, RollDifference, YawDifference;
+  long AltiEst, AscentEst;
+  long DesiredAltitude, DesiredAscentRate;
+  long Motor[8];            // Last, so only the frame's MotorCount of them are logged
+  char FlightMode;          // Not a field - goes in the flags
+};
+
+#define Blackbox_KeyInterval  64      // Loops between keyframes - a power of 2
+
+
+void Blackbox_Write( char port, const BLACKBOX_DATA * Data, int MotorCount, char Armed );   // Call once per loop
+int  Blackbox_Dropped(void);          // Frames not written since power up
+
+#endif
@@ -21,62 +21,91 @@
 #include "commlink.h"
 
 
-u16 COMMLINK::cachedLength;
-u16 COMMLINK::packetChecksum;
-u8  COMMLINK::packetBuf[64];
-u8  COMMLINK::bufIndex;
+u16     COMMLINK::packetChecksum;
+u16     COMMLINK::packetLeft;
+S4_SPAN COMMLINK::span;
+int     COMMLINK::reserved;
+char    COMMLINK::dropped;
 
 u16 Checksum(u16 checksum, u16 * buf , int len );
 
 
 void COMMLINK::StartPacket( char port, u8 type , u16 length )
 {
-  cachedLength = length + 8;    // 2 byte signature, 2 byte type, 2 byte length, 2 byte checksum
+  packetLeft = length + 8;      // 2 byte signature, 2 byte type, 2 byte length, 2 byte checksum
+  reserved = S4_Reserve( port, packetLeft, &span );   // Usually the whole packet, so the driver sees all of it at once
+  packetLeft -= reserved;
+  dropped = 0;
 
-  u16 buf[3];
-  buf[0] = 0xAA55;
-  buf[1] = type;
-  buf[2] = cachedLength;
-
-  packetChecksum = Checksum( 0, buf, 3 );  // 6 bytes = 3 u16's, and the checksum is done on u16's for speed
-  S4_Put_Bytes( port, buf, 6 );
+  Header( port, type, length );
 }
 
-void COMMLINK::AddPacketData( char port, void * data , u16 Count )
+char COMMLINK::TryStartPacket( char port, u8 type , u16 length )
 {
-  packetChecksum = Checksum( packetChecksum, (u16*)data, Count>>1 );
-  S4_Put_Bytes( port, data, Count );
-}
+  reserved = length + 8;
+  dropped = !S4_Try_Reserve( port, reserved, &span );
+  if( dropped ) return 0;
 
+  packetLeft = 0;
+  Header( port, type, length );
+  return 1;
+}
 
-void COMMLINK::StartPacket( u8 type , u16 length )
+void COMMLINK::Header( char port, u8 type , u16 length )
 {
-  cachedLength = length + 8;    // 2 byte signature, 1 byte type, 2 byte length, 2 byte crc
+  u16 buf[3];
+  buf[0] = 0xAA55;              // 55AA signature when done in little-endian
+  buf[1] = type;
+  buf[2] = length + 8;
 
-  ((u16*)packetBuf)[0] = 0xAA55;  // 55AA signature when done in little-endian
-  ((u16*)packetBuf)[1] = type;
-  ((u16*)packetBuf)[2] = cachedLength;
-  bufIndex = 6; // 3 x U16s = 6 bytes
+  packetChecksum = Checksum( 0, buf, 3 );  // 6 bytes = 3 u16's, and the checksum is done on u16's for speed
+  Write( port, buf, 6 );
 }
 
-void COMMLINK::AddPacketData( void * data , u16 Count )
+void COMMLINK::AddPacketData( char port, void * data , u16 Count )
 {
-  memcpy( packetBuf + bufIndex , data, Count );
-  bufIndex += Count;
+  if( dropped ) return;
+  packetChecksum = Checksum( packetChecksum, (u16*)data, Count>>1 );
+  Write( port, data, Count );
 }
 
-void COMMLINK::EndPacket(void)
+void COMMLINK::EndPacket( char port )
 {
-  packetChecksum = Checksum( 0, (u16*)packetBuf, bufIndex>>1 );
-  memcpy( packetBuf + bufIndex, &packetChecksum, 2 );
-  bufIndex += 2;
+  if( dropped ) return;
+  Write( port, &packetChecksum, 2 );
+  S4_Commit( port, reserved );
 }
 
-void COMMLINK::BuildPacket( u8 type , void * data , u16 length )
+
+// Copy into the reserved space, reserving more (and sending what's written so far) if the packet is
+// bigger than the transmit buffer
+void COMMLINK::Write( char port, void * data , int Count )
 {
-  StartPacket( type , length );
-  AddPacketData( data , length );
-  EndPacket();
+  char * bytes = (char *)data;
+
+  while( Count > 0 )
+  {
+    if( span.Count[0] == 0 ) {
+      if( span.Count[1] != 0 ) {
+        span.Ptr[0] = span.Ptr[1];                // Carry on at the start of the buffer
+        span.Count[0] = span.Count[1];
+        span.Count[1] = 0;
+      }
+      else {
+        if( packetLeft == 0 ) return;             // More data than StartPacket() was told about
+        S4_Commit( port, reserved );
+        reserved = S4_Reserve( port, packetLeft, &span );
+        packetLeft -= reserved;
+      }
+    }
+
+    int C = (Count < span.Count[0]) ? Count : span.Count[0];
+    memcpy( span.Ptr[0], bytes, C );
+    span.Ptr[0] += C;
+    span.Count[0] -= C;
+    bytes += C;
+    Count -= C;
+  }
 }
 
 
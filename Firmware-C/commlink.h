@@ -35,33 +35,44 @@
 // u8[N]: data bytes, 2 byte aligned
 // u16  : 0x#### : checksum of entire packet, including signature, length, and data
 
+// Packets are written straight into the port's transmit buffer - StartPacket() reserves room for the
+// whole packet, AddPacketData() copies the data in as it's added, and EndPacket() adds the checksum and
+// lets the serial driver send it.  A packet too big for the transmit buffer is sent in pieces.
+// The Try versions never wait - if the transmit buffer can't take the whole packet right now, it's
+// dropped (and counted by the serial driver), and the AddPacketData() / EndPacket() calls do nothing.
+
 class COMMLINK
 {
 public:
 
   // Length in THIS case is just the length of data you'll submit.  I'll add the rest.
   static void StartPacket( char port, u8 type , u16 length );
+  static char TryStartPacket( char port, u8 type , u16 length );     // Returns 0 if the packet was dropped
   static void AddPacketData( char port, void * data , u16 Count );   // Incrementally add packet data as you like
+  static void EndPacket( char port );                                // Call this when the packet is finished to close it and send the CRC
 
-  static void EndPacket(char port) {                                 // Call this when the packet is finished to close it and send the CRC
-      S4_Put_Bytes( port, &packetChecksum, 2 );
+  static void SendPacket( char port, u8 type , void * data , u16 length ) {  // Send a whole packet from one block of data
+      StartPacket( port, type, length );
+      AddPacketData( port, data, length );
+      EndPacket( port );
   }
 
-  // Use these versions to buffer the data internally so you can send to more than one port more efficiently
-  static void StartPacket( u8 type , u16 length );
-  static void AddPacketData( void * data , u16 Count );   // Incrementally add packet data as you like
-  static void EndPacket(void);                            // Call this when the packet is finished to close it and send the CRC
-
-  static void BuildPacket( u8 type , void * data , u16 length );
-  static void SendPacket( char port ) {  // Sends the pre-built packet to the port
-      S4_Put_Bytes( port, packetBuf, bufIndex );
+  static void TrySendPacket( char port, u8 type , void * data , u16 length ) {
+      if( TryStartPacket( port, type, length ) ) {
+          AddPacketData( port, data, length );
+          EndPacket( port );
+      }
   }
 
 private:
-  static u16 cachedLength;
+  static void Header( char port, u8 type , u16 length );
+  static void Write( char port, void * data , int Count );
+
   static u16 packetChecksum;
-  static u8  packetBuf[64];
-  static u8  bufIndex;
+  static u16 packetLeft;          // Bytes of the packet not reserved yet
+  static S4_SPAN span;            // Reserved space not written yet
+  static int reserved;            // Bytes reserved, to commit when they're written
+  static char dropped;            // The packet being built was dropped
 };
 
 #endif
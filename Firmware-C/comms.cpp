@@ -0,0 +1,456 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+#include <propeller.h>
+#include <string.h>
+
+#include "blackbox.h"
+#include "comms.h"
+#include "commlink.h"
+#include "constants.h"
+#include "f32.h"
+#include "serial_4x.h"
+
+
+volatile short UsbPulse = 0;
+volatile short XBeePulse = 0;
+
+static TELEMETRY Snapshot[2];       // Written by the flight cog - Snapshot[PublishSeq & 1] is the latest finished one
+static volatile int PublishSeq;
+
+static volatile int Mailbox;        // Command waiting for the flight cog, or 0
+static PREFS NewPrefs;              // Prefs that came with Comm_SetPrefs - left alone until the flight cog is done with them
+
+
+#define COMMS_STACK_SIZE (64 + 40)      // thread control structure (40) plus room for the packet and serial functions
+static int comms_stack[COMMS_STACK_SIZE];
+
+// Everything below here is only touched by the comms cog
+static TELEMETRY Snap;              // Copy of the latest snapshot, being sent
+static char  Mode = MODE_None;      // Debug communication mode
+static int   HostCommandUSB, HostCommandXBee;
+static signed char BlockPort = -1;  // Port a prefs or subscription block is coming in on, or -1
+static int   BlockCommand;          // Which of the two it is
+static char * BlockDest;            // Where it goes
+static short BlockSize;
+static short BlockCount;            // Bytes of it received so far
+static int   BlockTimer;            // CNT when the last one arrived
+static long  LastCounter;           // Loop counter of the last snapshot sent from
+
+static signed char StreamPort = -1;             // Port the telemetry streams are set up for
+static unsigned char StreamPeriod[Stream_Count]; // Loops between packets for each stream, 0 = not sent
+static long  StreamDue[Stream_Count];           // Loop counter each stream is next due on
+static unsigned char NewPeriods[Stream_Count];  // Subscription being received
+static volatile short LoopTimingWanted;   // Bumped once a loop timing packet is out - the flight cog takes the next one
+#ifdef F32_PROFILE
+static char  ProfileSkip;
+#endif
+
+static void CommsThread( void * );
+
+
+void Comms_Start(void)
+{
+  cogstart( &CommsThread, NULL, comms_stack, sizeof(comms_stack) );
+}
+
+
+TELEMETRY * Comms_GetSnapshot(void)
+{
+  return &Snapshot[(PublishSeq + 1) & 1];   // The one the comms cog isn't reading
+}
+
+void Comms_Publish(void)
+{
+  PublishSeq = PublishSeq + 1;
+}
+
+
+int Comms_GetCommand(void) {
+  return Mailbox;
+}
+
+PREFS * Comms_GetPrefs(void) {
+  return &NewPrefs;
+}
+
+short Comms_LoopTimingWanted(void) {
+  return LoopTimingWanted;
+}
+
+void Comms_CommandDone(void) {
+  Mailbox = 0;
+}
+
+
+static void WaitForMailbox(void)
+{
+  while( Mailbox )
+    ;   // The flight cog picks up a command every loop
+}
+
+static void Post( int Command )
+{
+  WaitForMailbox();
+  Mailbox = Command;
+}
+
+
+// How many bytes per second each port is allowed - about 80% of the baud rate, to leave room for replies to commands
+static const int PortBudget[2] = { 9000, 4500 };   // USB at 115200, XBee at 57600
+
+
+static void DefaultStreams( char port )   // Each stream every 8th loop (every 16th on XBee), one stream per loop
+{
+  int Period = (port == 0) ? 8 : 16;
+  for( int i=0; i<Stream_Count; i++ ) {
+    StreamPeriod[i] = Period;
+    StreamDue[i] = Snap.Counter + (((Period >> 3) * i - Snap.Counter) & (Period-1));
+  }
+  StreamPort = port;
+}
+
+static void Subscribe( char port, const unsigned char * Periods )
+{
+  memcpy( StreamPeriod, Periods, Stream_Count );
+
+  while( true )
+  {
+    int Load = 0;         // bytes per second
+    char Slower = 0;
+    for( int i=0; i<Stream_Count; i++ ) {
+      if( StreamPeriod[i] ) Load += StreamBytes[i] * Const_UpdateRate / StreamPeriod[i];
+    }
+    if( Load <= PortBudget[(int)port] ) break;
+
+    for( int i=0; i<Stream_Count; i++ ) {
+      if( StreamPeriod[i] && StreamPeriod[i] < 128 ) {
+        StreamPeriod[i] <<= 1;
+        Slower = 1;
+      }
+    }
+    if( !Slower ) break;  // Can't go any slower
+  }
+
+  for( int i=0; i<Stream_Count; i++ ) {
+    StreamDue[i] = Snap.Counter + 1 + i;    // Spread out the streams that have the same period
+  }
+  StreamPort = port;
+}
+
+
+static void StartBlock( char port, int Command, void * Dest, int Size )
+{
+  BlockPort = port;
+  BlockCommand = Command;
+  BlockDest = (char *)Dest;
+  BlockSize = Size;
+  BlockCount = 0;
+  BlockTimer = CNT;
+}
+
+
+static void DoCommand( char port, int HostCommand )
+{
+  if( HostCommand == Comm_Beat )
+  {
+    if( Mode != MODE_SensorTest || port != StreamPort ) {
+      DefaultStreams( port );   // New connection - the GroundStation subscribes again after the heartbeat
+    }
+
+    Mode = MODE_SensorTest;
+    if( port == 0 ) {
+      UsbPulse = Const_UpdateRate * 2;   // send USB data for the next two seconds (we'll get another heartbeat before then)
+      XBeePulse = 0;
+    }
+    if( port == 1 ) {
+      UsbPulse = 0;
+      XBeePulse = Const_UpdateRate * 2;  // send XBee data for the next two seconds (we'll get another heartbeat before then)
+    }
+    return;
+  }
+
+  if( HostCommand == Comm_Elv8 ) {
+    S4_Try_Put_Bytes( port, &HostCommand , 4 ); //Simple ping-back to tell the application we have the right comm port
+    return;
+  }
+
+  if( HostCommand == Comm_Subscribe ) {         // Telemetry rates can change in flight - ReceiveBlock() collects the periods
+    StartBlock( port, Comm_Subscribe, NewPeriods, Stream_Count );
+    return;
+  }
+
+  if( Snap.FlightEnabled ) return; // Don't allow any settings adjustment when in-flight (the flight cog checks again)
+
+
+  switch( HostCommand )
+  {
+    case Comm_Motor1:
+    case Comm_Motor2:
+    case Comm_Motor3:
+    case Comm_Motor4:
+    case Comm_Motor5:
+    case Comm_Motor6:
+    case Comm_ResetRadio:
+    case Comm_ZeroGyro:
+    case Comm_ResetGyro:
+    case Comm_ZeroAccel:
+    case Comm_ResetAccel:
+    case Comm_Wipe:
+      Post( HostCommand );
+      break;
+
+    case Comm_Motor7:   // ESC throttle calibration - the GroundStation sends 0xFF to go to max throttle, then anything to finish
+      Post( HostCommand );
+
+      if( S4_Get(0) == 0xFF )     // Safety check - Allow the user to break out by sending anything else
+      {
+        Post( Comm_CalibrateMax );
+        S4_Get(0);  // Get the next character to finish
+        Post( Comm_CalibrateDone );
+      }
+      else {
+        Post( Comm_CalibrateCancel );
+      }
+      break;
+
+    case Comm_QueryPrefs:  // Query Preferences
+      {
+      WaitForMailbox();   // Let any change to the prefs finish first, and make sure NewPrefs is free
+
+      memcpy( &NewPrefs, &Prefs, sizeof(PREFS) );
+      NewPrefs.Checksum = Prefs_CalculateChecksum( NewPrefs );
+      int size = sizeof(PREFS);
+
+      COMMLINK::StartPacket( port, 0x18 , size );
+      COMMLINK::AddPacketData( port, &NewPrefs, size );
+      COMMLINK::EndPacket(port);
+      }
+      break;
+
+    case Comm_SetPrefs:  //Store new preferences - ReceiveBlock() collects the bytes as they come in
+      WaitForMailbox();   // NewPrefs might still be in use by the last command
+      StartBlock( port, Comm_SetPrefs, &NewPrefs, sizeof(PREFS) );
+      break;
+  }
+}
+
+
+static void ReceiveBlock(void)
+{
+  int c;
+  while( BlockCount < BlockSize && (c = S4_Check(BlockPort)) >= 0 ) {
+    BlockDest[BlockCount++] = c;
+    BlockTimer = CNT;
+  }
+
+  if( BlockCount == BlockSize ) {
+    if( BlockCommand == Comm_Subscribe ) {
+      Subscribe( BlockPort, NewPeriods );
+    }
+    else if( Prefs_CalculateChecksum( NewPrefs ) == NewPrefs.Checksum ) {
+      Post( Comm_SetPrefs );
+    }
+    else {
+      Post( Comm_PrefsBad );
+    }
+    BlockPort = -1;
+  }
+  else if( (int)(CNT - BlockTimer) > Const_ClockFreq / 20 ) {   // wait up to 50ms per byte - Should be plenty
+    if( BlockCommand == Comm_SetPrefs ) {
+      Post( Comm_PrefsBad );
+    }
+    BlockPort = -1;
+  }
+}
+
+
+static void CheckInput(void)
+{
+  int c;
+
+  if( BlockPort >= 0 ) {
+    ReceiveBlock();
+  }
+
+  // Commands stop at the start of a prefs or subscription block - the rest of it is picked up by ReceiveBlock()
+  while( BlockPort != 0 && (c = S4_Check(0)) >= 0 ) {
+    HostCommandUSB = (HostCommandUSB<<8) | c;
+    DoCommand( 0, HostCommandUSB );
+  }
+
+  while( BlockPort != 1 && (c = S4_Check(1)) >= 0 ) {
+    HostCommandXBee = (HostCommandXBee<<8) | c;
+    DoCommand( 1, HostCommandXBee );
+  }
+}
+
+
+static void SendStream( char port, int Stream )
+{
+  switch( Stream )
+  {
+  case Stream_Radio:
+    COMMLINK::TryStartPacket( port, 1, 18 );                // Radio values, 18 byte payload
+    COMMLINK::AddPacketData( port, Snap.Radio , 16 );       // First 8 channels of Radio struct is 16 bytes total
+    COMMLINK::AddPacketData( port, &Snap.BatteryVolts, 2 ); // Send 2 additional bytes for battery voltage
+    COMMLINK::EndPacket(port);
+    break;
+
+  case Stream_Stats:
+    COMMLINK::TryStartPacket( port, 7, 12 );                // Debug values, 16 byte payload
+    COMMLINK::AddPacketData( port, Snap.Stats, 8 );         // Version number, + Stats on update cycle counts
+    COMMLINK::AddPacketData( port, &Snap.Counter, 4 );      // Send the counter (sequence timestamp)
+    COMMLINK::EndPacket(port);
+    break;
+
+  case Stream_Sensors:
+    COMMLINK::TrySendPacket( port, 2, Snap.Sensors, 20 );  //Send 20 bytes of data from Sensors onward (sends 10 words worth of data)
+    break;
+
+  case Stream_LoopTiming:
+  {
+  #ifdef F32_PROFILE
+    if( (++ProfileSkip & 7) == 0 ) {  // F32 cog profile - big, so it only goes every 8th time around
+      COMMLINK::StartPacket( port, 8, sizeof(F32_STATS) );
+      COMMLINK::AddPacketData( port, F32::GetProfile(), sizeof(F32_STATS) );
+      COMMLINK::EndPacket(port);
+      break;
+    }
+  #endif
+
+    // Loop timing for one phase of the loop, and the run stats of one scheduler task, 60 byte payload - the flight
+    // cog takes a new phase and task into the snapshot each time one goes out, so each gets sent every 9th time around
+    if( Snap.LoopTimingSeq != LoopTimingWanted ) break;       // Not taken yet
+    if( !COMMLINK::TryStartPacket( port, 9, sizeof(LOOPTIMING) ) ) break;    // Dropped - send it again next time
+    COMMLINK::AddPacketData( port, &Snap.LoopTiming, sizeof(LOOPTIMING) );
+    COMMLINK::EndPacket(port);
+
+    LoopTimingWanted = LoopTimingWanted + 1;
+    break;
+  }
+
+  case Stream_Quat:
+    COMMLINK::TrySendPacket( port, 3, Snap.Quat, 16 );   // Quaternion data, 16 byte payload
+    break;
+
+  case Stream_Motors: // Motor data
+    COMMLINK::TryStartPacket( port, 5, Snap.MotorCount * 2 + 2 );   // 10 to 18 byte payload
+    COMMLINK::AddPacketData( port, Snap.Motor, Snap.MotorCount * 2 );
+    COMMLINK::AddPacketData( port, &Snap.FrameType, 2 );
+    COMMLINK::EndPacket(port);
+    break;
+
+  case Stream_Computed:
+    COMMLINK::TryStartPacket( port, 4, 24 );   // Computed data, 24 byte payload
+
+    COMMLINK::AddPacketData( port, &Snap.PitchDifference, 4 );
+    COMMLINK::AddPacketData( port, &Snap.RollDifference, 4 );
+    COMMLINK::AddPacketData( port, &Snap.YawDifference, 4 );
+
+    COMMLINK::AddPacketData( port, &Snap.Alt, 4 );            //Send 4 bytes of data for Alt
+    COMMLINK::AddPacketData( port, &Snap.GroundHeight, 4 );   //Send 4 bytes of data for height above ground
+    COMMLINK::AddPacketData( port, &Snap.AltiEst, 4 );        //Send 4 bytes for altitude estimate
+    COMMLINK::EndPacket(port);
+    break;
+
+  case Stream_DesiredQ:
+    COMMLINK::TrySendPacket( port, 6, Snap.DesiredQ, 16 );   // Desired Quaternion data, 16 byte payload
+    break;
+
+  case Stream_Link:   // Serial error counts for each port, and blackbox frames dropped, 26 byte payload - the low 16 bits of the running totals
+  {
+    short Counts[13];
+    for( int i=0; i<4; i++ ) {
+      Counts[i]   = S4_Tx_Dropped(i);
+      Counts[i+4] = S4_Rx_Overruns(i);
+      Counts[i+8] = S4_Rx_Framing(i);
+    }
+    Counts[12] = Blackbox_Dropped();
+    COMMLINK::TrySendPacket( port, 10, Counts, 26 );
+    break;
+  }
+  }
+}
+
+
+static void SendTelemetry(void)
+{
+  char port = 0;
+  int loops = Snap.Counter - LastCounter;   // Usually 1, more if we fell behind and skipped a snapshot
+  LastCounter = Snap.Counter;
+
+  if( UsbPulse > 0 ) {
+    UsbPulse = (UsbPulse > loops) ? UsbPulse - loops : 0;
+    if( UsbPulse == 0 ) {
+      Mode = MODE_None;
+      return;
+    }
+  }
+  else if( XBeePulse > 0 )
+  {
+    XBeePulse = (XBeePulse > loops) ? XBeePulse - loops : 0;
+    if( XBeePulse == 0 ) {
+      Mode = MODE_None;
+      return;
+    }
+    port = 1;
+  }
+
+  if( Mode != MODE_SensorTest || port != StreamPort ) return;
+
+  for( int i=0; i<Stream_Count; i++ )
+  {
+    if( StreamPeriod[i] == 0 || (int)(Snap.Counter - StreamDue[i]) < 0 ) continue;
+
+    StreamDue[i] += StreamPeriod[i];
+    if( (int)(Snap.Counter - StreamDue[i]) >= 0 ) {     // Skipped snapshots put it a whole period behind
+      StreamDue[i] = Snap.Counter + StreamPeriod[i];
+    }
+    SendStream( port, i );
+  }
+}
+
+
+static void CommsThread( void * )
+{
+  int Seq = PublishSeq;
+  LastCounter = Snapshot[Seq & 1].Counter;
+
+  while( true )
+  {
+    CheckInput();
+
+    if( PublishSeq == Seq ) continue;   // Nothing new from the flight cog yet
+
+    // If the flight cog published again while we were copying, it may have started writing
+    // over the buffer we were reading, so copy the newer one instead
+    do {
+      Seq = PublishSeq;
+      memcpy( &Snap, &Snapshot[Seq & 1], sizeof(TELEMETRY) );
+    } while( PublishSeq != Seq );
+
+    SendTelemetry();
+
+#ifdef ENABLE_LOGGING
+    Blackbox_Write( 3, &Snap.Log, Snap.MotorCount, Snap.FlightEnabled );
+#endif
+  }
+}
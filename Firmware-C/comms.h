@@ -0,0 +1,147 @@
+#ifndef __COMMS_H__
+#define __COMMS_H__
+
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+/*
+  Comms - GroundStation link, run on its own cog
+
+  The comms cog reads the USB and XBee ports, builds and sends all the telemetry packets, and
+  parses the commands from the GroundStation, so a full serial buffer only ever holds up the
+  comms cog, never the flight loop.
+
+  Once per loop the flight cog fills in the buffer from Comms_GetSnapshot() and hands it over with
+  Comms_Publish().  There are two buffers - the flight cog always writes the one the comms cog isn't
+  reading, and the comms cog re-reads if a publish happened while it was copying.
+
+  Telemetry goes out as separate streams, one packet type each.  The GroundStation picks how often each one
+  is sent with Comm_Subscribe, followed by one byte per stream: the number of loops between packets, or 0 to
+  not send it.  If the streams asked for don't fit the port's bandwidth, all the periods are doubled until
+  they do.  Until a subscription arrives (and again after the GroundStation goes quiet) each stream goes out
+  every 8th loop over USB, every 16th over XBee, one stream per loop.  Telemetry packets are dropped, not
+  waited for, when the port's transmit buffer is full - the drops are counted in the link stream.
+
+  On ENABLE_LOGGING builds the comms cog also writes the blackbox frame from each snapshot to port 3
+  (see blackbox.h).
+
+  Commands the comms cog has received and checked (for prefs, the whole block has arrived and the
+  checksum is good) are posted one at a time.  The flight cog picks them up with Comms_GetCommand()
+  and calls Comms_CommandDone() when it's finished, and only then does the comms cog post another.
+
+  The loop timing stream works the same way in the other direction.  Each time the comms cog has sent
+  one, it asks for the next with Comms_LoopTimingWanted(), and the flight cog takes the next loop phase
+  and scheduler task into the snapshot and clears their maximums, so only the flight cog ever writes them.
+*/
+
+#include "blackbox.h"
+#include "elev8-main.h"
+#include "prefs.h"
+
+
+// One loop phase's timing and one scheduler task's run stats - the payload of packet 9, in the order it's sent.
+// The counts are running totals that wrap, and the maximums are since the last time that phase or task was taken.
+struct LOOPTIMING {
+  short Phase;                          // LoopPhase_ (see elev8-main.h)
+  unsigned short Overruns;              // Loops that ran past their time slot
+  long  Max;
+  unsigned short Counts[LoopTime_Buckets];
+  short Task;                           // Index in the scheduler's task table - the GroundStation names them by it
+  short TaskPeriod;
+  unsigned short TaskRuns;
+  unsigned short TaskOverruns;          // Runs that went over TaskBudget
+  long  TaskBudget;
+  long  TaskMax;
+  long  LoopCycles;                     // Clock cycles in one update loop, so the GroundStation can show loads
+};
+
+
+// The flight state sent to the GroundStation, grouped by the packet each part goes out in
+struct TELEMETRY {
+  short Radio[8];           // Packet 1 - first 8 radio channels
+  short BatteryVolts;
+  short Stats[4];           // Packet 7 - Version, min / max / avg cycles per loop
+  long  Counter;            //            main loop counter (sequence timestamp)
+  short Sensors[10];        // Packet 2 - Temperature, Gyro, Accel, Mag as words
+  float Quat[4];            // Packet 3 - current orientation
+  short Motor[8];           // Packet 5 - one value per output the frame type uses, then the frame type
+  short FrameType;          //            the mixer is running (see mixer.h) - quad X if the board can't drive the configured one
+  long  PitchDifference;    // Packet 4 - computed values
+  long  RollDifference;
+  long  YawDifference;
+  long  Alt;
+  long  GroundHeight;
+  long  AltiEst;
+  float DesiredQ[4];        // Packet 6 - desired orientation
+  LOOPTIMING LoopTiming;    // Packet 9
+  short LoopTimingSeq;      //   the Comms_LoopTimingWanted() request it answers
+  char  MotorCount;
+  char  FlightEnabled;      // Not sent - the comms cog won't post settings commands while armed
+#ifdef ENABLE_LOGGING
+  BLACKBOX_DATA Log;        // Blackbox frame, written to port 3 every loop while armed
+#endif
+};
+
+
+// Telemetry streams, in the order Comm_Subscribe lists them
+enum {
+  Stream_Radio = 0,         // Packet 1
+  Stream_Stats,             // Packet 7
+  Stream_Sensors,           // Packet 2
+  Stream_LoopTiming,        // Packet 9, loop phase times and scheduler task stats (and 8, the F32 profile, on F32_PROFILE builds)
+  Stream_Quat,              // Packet 3
+  Stream_Motors,            // Packet 5
+  Stream_Computed,          // Packet 4
+  Stream_DesiredQ,          // Packet 6
+  Stream_Link,              // Packet 10, serial port error counts
+  Stream_Count,
+};
+
+// Bytes each stream's packet takes on the wire - 8 bytes of header and checksum, plus the payload.  Streams are sent
+// with TryStartPacket, which drops a packet that won't fit in the free space, and a ring never has more than its
+// size - 1 bytes free, so every one of these has to be smaller than Comms_TxBufSize (host/ring_test checks it).
+static const unsigned char StreamBytes[Stream_Count] = { 26, 20, 28, 68, 24, 26, 32, 24, 34 };
+
+#define Comms_TxBufSize   128     // Transmit ring for the USB and XBee ports
+
+
+// Posted by the comms cog itself, never received from the GroundStation as-is
+#define Comm_CalibrateMax     COMMAND('C','a','l','M')   // ESC throttle calibration: go to max throttle
+#define Comm_CalibrateDone    COMMAND('C','a','l','D')   //                           back to min throttle, done
+#define Comm_CalibrateCancel  COMMAND('C','a','l','C')   //                           cancelled by the user
+#define Comm_PrefsBad         COMMAND('P','r','f','X')   // A prefs block arrived with a bad checksum
+
+
+void Comms_Start(void);                 // Starts the comms cog - the serial ports must already be running
+
+TELEMETRY * Comms_GetSnapshot(void);    // The buffer to fill in for this loop
+void Comms_Publish(void);               // Hand the filled in buffer to the comms cog
+
+int  Comms_GetCommand(void);            // The waiting command, or 0 if there isn't one
+PREFS * Comms_GetPrefs(void);           // The new prefs that came with Comm_SetPrefs
+void Comms_CommandDone(void);           // Finished with the command (and its prefs) - frees the mailbox for the next one
+
+short Comms_LoopTimingWanted(void);     // Changes when the comms cog wants the next loop phase and task in the snapshot
+
+
+extern volatile short UsbPulse;         // Periodically, the GroundStation will ping the FC to say it's still there - these are countdowns,
+extern volatile short XBeePulse;        // in loops, until the comms cog decides it's gone
+
+#endif
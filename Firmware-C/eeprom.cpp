@@ -214,6 +214,18 @@ void EEPROM::Poll(void)
 }
 
 
+int EEPROM::Ready(void)
+{
+  //One pass of the Poll loop.  The 24LC256 doesn't acknowledge its address until it's finished
+  //copying its page buffer to EEPROM.
+
+  i2cStart();
+  int ackbit = SendByte(0xA0);
+  i2cRelease();
+  return ackbit == 0;
+}
+
+
 #define Set( var, mask )   { var |= mask; }
 #define Clear( var, mask ) { var &= ~mask; }
 
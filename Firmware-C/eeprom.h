@@ -29,6 +29,7 @@ public:
 
 	static void FromRam(void * startAddr, void * endAddr, int eeStart);
 	static void ToRam(void * startAddr, void * endAddr, int eeStart);
+	static int  Ready(void);     // Returns 0 while the EEPROM is still busy with a write, without waiting
 
 
 //private:
@@ -31,41 +31,29 @@
 
 #include "battery.h"            // Battery monitor functions (charge time to voltage)
 #include "beep.h"               // Piezo beeper functions
-#include "commlink.h"           // GroundStation communication link
+#include "biquad.h"             // Integer lowpass / notch filters for the gyro
+#include "blackbox.h"           // Binary flight log on serial port 3, written by the comms cog
+#include "comms.h"              // GroundStation link - telemetry and command parsing           (1 COG)
 #include "constants.h"          // Project-wide constants, like clock rate, update frequency
 #include "elev8-main.h"         // Main thread functions and defines                            (Main thread takes 1 COG)
-#include "f32.h"                // 32 bit IEEE floating point math and stream processor         (1 COG)
+#include "f32.h"                // 32 bit IEEE floating point math and stream processor         (1 COG, unless QUATIMU_FIXED)
 #include "intpid.h"             // Integer PID functions
 
 #if defined(ENABLE_LASER_RANGE)
 #include "laserrange.h"         // Laser Rangefinder
 #endif
 
+#include "mixer.h"              // Motor mixing for each frame type
 #include "pins.h"               // Pin assignments for the hardware
 #include "prefs.h"              // User preferences storage
 #include "quatimu.h"            // Quaternion IMU and control functions
 #include "rc.h"                 // High precision 8-port R/C PWM input driver                   (1 COG, if enabled)
 #include "sbus.h"               // S-BUS (Futaba 1-wire receiver) driver                        (1 COG, if enabled)
+#include "sched.h"              // Rate group scheduler for the sub-rate work in the main loop
 #include "sensors.h"            // Sensors (gyro,accel,mag,baro) + LEDs driver                  (1 COG)
 #include "serial_4x.h"          // 4 port simultaneous serial I/O                               (1 COG)
 #include "servo32_highres.h"    // 32 port, high precision / high rate PWM servo output driver  (1 COG)
 
-//#define ENABLE_LOGGING
-
-#ifdef ENABLE_LOGGING
-void DoLogOutput(void);
-void DataLogThread(void *par);
-
-#define LOG_STACK_SIZE (16 + 40)      // stack needs to accomodate thread control structure (40) plus room for functions (16)
-static int log_stack[LOG_STACK_SIZE]; // allocate space for the stack - you need to set up a 
-
-volatile char LogTrigger = 0;
-#endif
-
-short UsbPulse = 0;     // Periodically, the GroundStation will ping the FC to say it's still there - these are countdowns
-short XBeePulse = 0;
-
-
 // Potential new settings values
 const int AltiThrottleDeadband = 150;   // was 100
 const int MaxVerticalRate = 5000;       // 5000mm/sec = 5M/sec
@@ -76,7 +64,7 @@ const int MaxVerticalRate = 5000;       // 5000mm/sec = 5M/sec
 static RADIO Radio;
 
 static int  LoopCycles = 0;
-static short CycleCount[8];   // Number of cycles an update loop takes, recorded over 8 cycles so we can get min/max/avg
+static int  CycleMin, CycleMax, CycleSum;   // Loop cycle counts over each block of 8 loops, for min/max/avg
 
 static struct CYCLESTATS {
   short Version;
@@ -86,23 +74,38 @@ static struct CYCLESTATS {
 } Stats;
 
 
+static LOOPTIMES LoopTimes;         // Loop phase timing histograms (see elev8-main.h)
+static long  PhaseStart;            // CNT at the start of the current loop phase
+static LOOPTIMING LoopTiming;       // The phase and task going out in the telemetry snapshot
+static short LoopTimingSeq = -1;    // The Comms_LoopTimingWanted() request they were taken for
+
+
 //Sensor inputs, in order of outputs from the Sensors cog, so they can be bulk copied for speed
 static SENS sens;
+static int  GyroSum[3];               // Sum of the gyro readings taken since the last IMU update
+static int  GyroSamples;              // How many readings are in GyroSum
 
 
 static long  GyroZX, GyroZY, GyroZZ;  // Gyro zero values
 
+// Background gyro zero, kept up to date while disarmed (see UpdateGyroZero)
+const int GyroStillRange = 24;              // max - min of a still window is ~15, so more than this is moving
+const int GyroZeroStep = 4;                 // how far a new zero can move from the one before it
+static int   GZMin[3], GZMax[3], GZSum[3];  // min, max, sum of the readings in the current window
+static short GZCount;                       // readings in the current window so far
+static short GZVar = -1;                    // variation of the window the zero came from, -1 if it didn't come from one
+static int   GZLast[3];                     // averages of the last still window, for the next one to agree with
+static char  GZAgree;                       // still windows in a row that agreed with each other, up to GZLast
+
 static long  AccelZSmooth;            // Smoothed (filtered) accelerometer Z value (used for height fluctuation damping)
 
 //Debug output mode, working variables  
 static long   counter = 0;    //Main loop iteration counter
-static short  TxData[12];     //Word-sized copies of Temp, Gyro, Accel, Mag, for debug transfer speed
-static char   Quat[16];       //Current quaternion from the IMU functions
 
-static char Mode = MODE_None;         //Debug communication mode
 static signed char NudgeMotor = -1;   // Which motor to nudge during testing (-1 == no motor)
-static char NudgeCount[4];            // How long to spin the motor for (0 == stopped)
-static int HostCommandUSB, HostCommandXBee;
+static short NudgeCount[4];           // How long to spin the motor for (0 == stopped)
+static short LEDTestStep = -1;        // How far through its rainbow the LED test is (-1 == not running)
+static char EscCalibrating;           // Set from the ESC calibration command until the GroundStation finishes or cancels it
 
 static long  AltiEst, AscentEst;                              // altitude estimate and ascent rate estimate
 static long  DesiredAltitude, DesiredAscentRate;              // desired values for altitude and ascent rate
@@ -113,11 +116,17 @@ static long  GyroRoll, GyroPitch, GyroYaw;                    //Raw gyro values
 static long  GyroRPFilter, GyroYawFilter;   // Tunable damping values for gyro noise
 
 
-static short Motor[4];                     //Motor output values
+static short Motor[MAX_MOTORS];             //Motor output values
+static char  MotorCount = 4;                //Outputs used by the frame type - set at power up
+static char  FrameType;                     //Frame the mixer is running - Prefs.FrameType, unless this board can't drive it
+static char  FrameUnusable;                 //Prefs.FrameType needs more outputs than this board has - won't arm
+static const MIXER * Mixer;
 static long  LEDValue[LED_COUNT];           //LED outputs (copied to the LEDs by the Sensors cog)
 
 static long loopTimer;                      //Master flight loop counter - used to keep a steady update rate
 
+#define PrefsDelay(d)  ((d) * Const_UpdateRate / Prefs_UpdateRate)   // Arm/Disarm delay prefs to update counts
+
 static short FlightEnableStep;        //Flight arm/disarm counter
 static short CompassConfigStep;       //Compass configure mode counter
 static short ReArmTimer = 0;          // ONLY used in throttle cut - set this value to non-zero to allow instant re-arm if throttle present until it expires
@@ -130,7 +139,12 @@ static char AllowThrottleCut = 1;     // < -1100 throttle is considered a system
 static char AllowRearm = 1;           // Will get moved into Prefs once tested
 static short StartupDelay;            //Used to change convergence rates for IMU, enable battery monitor
 
-static char MotorPin[4] = {PIN_MOTOR_FL, PIN_MOTOR_FR, PIN_MOTOR_BR, PIN_MOTOR_BL };            //Motor index to pin index table
+//Motor index to pin index table - the frames with more than 4 motors take over the AUX pins
+static const char MotorPin[] = {PIN_MOTOR_FL, PIN_MOTOR_FR, PIN_MOTOR_BR, PIN_MOTOR_BL, PIN_MOTOR_AUX1, PIN_MOTOR_AUX2,
+#if defined(PIN_MOTOR_AUX3)
+                                PIN_MOTOR_AUX3, PIN_MOTOR_AUX4,
+#endif
+                               };
 
 static long LEDModeColor;
 
@@ -142,8 +156,18 @@ static char calib_Quadrants;
 static char calib_Step;
 static long c_xmin, c_ymin, c_xmax, c_ymax, c_zmin, c_zmax;
 
-// PIDs for roll, pitch, yaw, altitude
-static IntPID  RollPID, PitchPID, YawPID, AltPID, AscentPID;
+// PIDs for roll, pitch, yaw, altitude - the I gains are all zero, so none of them have the I term compiled in
+typedef IntPIDT<8, false, true, false>   AxisPID_t;     // Filtered derivative
+typedef IntPIDT<8, false, false, false>  AltiPID_t;
+
+static AxisPID_t  AxisPID[3];     // Roll, pitch, yaw - run together with AxisPID_t::CalculateAll()
+static AxisPID_t & RollPID = AxisPID[0];
+static AxisPID_t & PitchPID = AxisPID[1];
+static AxisPID_t & YawPID = AxisPID[2];
+static AltiPID_t  AltPID, AscentPID;
+
+// Gyro filters ahead of the roll, pitch, and yaw PIDs, set up from the prefs by ApplyPrefs()
+static BIQUAD  GyroLowpass[3], GyroNotch[3];
 
 
 // Used to attenuate the brightness of the LEDs, if desired.  A shift of zero is full brightness
@@ -164,247 +188,352 @@ void LaserRangeThread( void *par );
 #endif
 
 
-#ifdef ENABLE_LOGGING
-// Only used for debugging
-static const char * nibbleToAscii = "0123456789abcdef";
+static int abs(int v) {
+  v = (v<0) ? -v : v;
+  return v;
+}
+
 
-static char LogInt( int x , char * dest )
+static void RecordLoopTime( int phase, int cycles )
 {
-  char buf[14];
-  char index = 13;
-  buf[index] = ',';   // Add the comma here for speed
-  char isNeg;
-  if( x < 0 ) {
-    isNeg = 1;
-    x = -x;
-  }    
-  else isNeg = 0;
+  int bucket = 0;
+  for( int v = cycles >> 7; v != 0 && bucket < LoopTime_Buckets-1; v >>= 1 ) {
+    bucket++;
+  }
+  LoopTimes.Counts[phase][bucket]++;
 
-  do {
-    buf[--index] = nibbleToAscii[x & 15];
-    x >>= 4;
-  } while(x > 0);
+  if( cycles > LoopTimes.Max[phase] ) {
+    LoopTimes.Max[phase] = cycles;
+  }
+}
 
-  if( isNeg ) {
-    buf[--index] = '-';
-  }    
+static void EndLoopPhase( int phase )   // Time since the last phase ended counts against this one
+{
+  int now = CNT;
+  RecordLoopTime( phase, now - PhaseStart );
+  PhaseStart = now;
+}
+
+
+// Sub-rate tasks, run by Sched_Run() at the end of each loop.  Tasks in the same rate group get different phases,
+// so no single loop picks up more than one of them:
+//
+//   loop & 15:   0 cycle stats   1 battery read   2 battery discharge   4 battery charge   6 alarm (every other time)
+//                8 cycle stats
+//
+// DoMotorTest and Task_PrefsSave run every loop, but do nothing unless the GroundStation asked for a test or
+// sent new prefs.  UpdateGyroZero and Beep_Tick run every loop too - one takes a gyro reading every loop while
+// disarmed, the other starts each queued note on time.  Budgets are rough - the Loop Timing tab in the GroundStation
+// shows each task's longest run, and how many runs went over budget.
+
+static char BatteryCharging;    // Set once the battery monitor cap has been discharged and is charging
 
-  char count = 14-index;
-  memcpy( dest, buf+index, count );
-  return count;
+static void Task_BatteryDischarge(void)
+{
+  if( Prefs.UseBattMon && StartupDelay == 0 ) {
+    Battery::DischargePin();
+  }
 }
-#endif
 
+static void Task_BatteryCharge(void)
+{
+  if( Prefs.UseBattMon && StartupDelay == 0 ) {
+    Battery::ChargePin();
+    BatteryCharging = 1;
+  }
+}
 
-static int abs(int v) {
-  v = (v<0) ? -v : v;
-  return v;
+static void Task_BatteryRead(void)
+{
+  if( BatteryCharging ) {   // 13 loops since ChargePin() - the longest charge time is a little over 2 loops
+    BatteryVolts = Battery::ComputeVoltage( Battery::ReadResult() ) + Prefs.VoltageOffset;
+    BatteryCharging = 0;
+  }
 }
 
+static void (*PrefsSavedBeep)(void);  // Which beep to give when the prefs being saved are written and checked
 
-int main()                                    // Main function
+static void Task_PrefsSave(void)
 {
-  Initialize(); // Set up all the objects
-  
-  //Prefs_Test();
+  switch( Prefs_SaveStep() )      // A chunk at a time - Prefs_SaveChunk bytes, or a poll if the EEPROM is busy
+  {
+    case PrefsSave_Done:
+      PrefsSavedBeep();
+      break;
 
-  //Grab the first set of sensor readings (should be ready by now)
-  memcpy( &sens, Sensors_Address(), Sensors_ParamsSize );
+    case PrefsSave_Failed:
+      Beep();                     // Didn't read back the same - the old prefs (or defaults) will load at power up
+      break;
+  }
+}
 
-  //Set a reasonable starting point for the altitude computation
-  QuatIMU_SetInitialAltitudeGuess( sens.Alt );
+#if defined( __PINS_V3_H__ )
+static void Task_LowVoltageAlarm(void)
+{
+  // Battery alarm at low voltage - on for 32 loops, then off for 32
 
-  loopTimer = CNT;
+  // If we want to use the PING sensor *and* use a timer for the alarm, we'll need to
+  // move the freq generator onto another cog.  Currently the battery monitor uses CTRB
+  // to count charge time.  Ideally the PING sensor would use CTRA to count return time,
+  // so we can have one or the other in the main thread, but not both.
 
-  // Set all the motors to their low-throttle point
-  for( int i=0; i<4; i++ ) {
-    Motor[i] = Prefs.MinThrottle;
-    Servo32_Set( MotorPin[i], Prefs.MinThrottle );
+  if( Prefs.UseBattMon == 0 || Prefs.LowVoltageAlarm == 0 ) return;
+  if( Beep_Playing() ) return;    // Counter A is busy with queued notes - they put it back when they're done
+
+  if( (counter & 32) == 0 ) {
+    if( (BatteryVolts < Prefs.LowVoltageAlarmThreshold) && (BatteryVolts > 200) ) {  // Make sure the voltage is above the (0 + VoltageOffset) range
+      BeepOn( 'A' , PIN_BUZZER_1, 4800 );
+    }
+  }
+  else {
+    BeepOff( 'A' );
   }
+}
+#endif
+
+// The GroundStation names these by their index (TaskNames in mainwindow.cpp), so new ones go at the end
+static SCHED_TASK Tasks[] = {
+  //             Function               Period  Phase  Budget (cycles)
+  SCHED_TASK_DEF( UpdateGyroZero,        1,      0,      3000 ),
+  SCHED_TASK_DEF( DoMotorTest,           1,      0,      2000 ),
+  SCHED_TASK_DEF( Task_PrefsSave,        1,      0,     20000 ),
+  SCHED_TASK_DEF( Beep_Tick,             1,      0,      1000 ),
+  SCHED_TASK_DEF( UpdateCycleStats,      8,      0,      2000 ),
+  SCHED_TASK_DEF( Task_BatteryRead,      16,     1,      5000 ),
+  SCHED_TASK_DEF( Task_BatteryDischarge, 16,     2,      1000 ),
+  SCHED_TASK_DEF( Task_BatteryCharge,    16,     4,      1000 ),
+#if defined( __PINS_V3_H__ )
+  SCHED_TASK_DEF( Task_LowVoltageAlarm,  32,     6,      2000 ),
+#endif
+};
+
+static const int TaskCount = sizeof(Tasks) / sizeof(Tasks[0]);
+
+
+int main()                                    // Main function
+{
+  Initialize(); // Set up all the objects
+  
+  //Prefs_Test();
 
+  loopTimer = CNT;
 
   while(1)
   {
     int Cycles = CNT;
+    PhaseStart = Cycles;
 
-    //Read ALL inputs from the sensors into local memory, starting at Temperature
-    memcpy( &sens, Sensors_Address(), Sensors_ParamsSize );
+    DoFlightUpdate();   // Read the sensors and radio, run the IMU and controls, update the motors
 
-    QuatIMU_Update( (int*)&sens.GyroX );        //Entire IMU takes ~125000 cycles
-    AccelZSmooth += (sens.AccelZ - AccelZSmooth) * Prefs.AccelCorrectionFilter / 256;
+    PublishTelemetry(); // Hand this loop's state to the comms cog
+    CheckDebugInput();  // Run any command the comms cog has passed on
+    EndLoopPhase( LoopPhase_Comms );
 
-    if( Prefs.ReceiverType & 1 ) // SBUS or RemoteRX?
-    {
-      // Unrolling these loops saves about 10000 cycles, but costs a little over 1/2kb of code space
-      for( int i=0; i<8; i++ ) {
-        Radio.Channel(i) =  (SBUS::GetRC(Prefs.ChannelIndex(i)) - Prefs.ChannelCenter(i)) * Prefs.ChannelScale(i) / 1024;
-      }
+    Sched_Run( Tasks, TaskCount, counter );   // Battery monitor, motor tests, and anything else that doesn't run every loop
+    EndLoopPhase( LoopPhase_Tasks );
 
-      // Extra raw channel for SBUS users, tuning, experimentation
-      Radio.Channel(8) =  ((SBUS::GetRC(8) + 32) * 1280) / 1024;  // Aux4
+    LoopCycles = CNT - Cycles;    // Record how long it took for one full iteration
+    RecordLoopTime( LoopPhase_Total, LoopCycles );
+
+    // Min / max / sum over each block of 8 loops - UpdateCycleStats picks them up at the start of the next block
+    if( (counter & 7) == 0 || LoopCycles < CycleMin ) CycleMin = LoopCycles;
+    if( (counter & 7) == 0 || LoopCycles > CycleMax ) CycleMax = LoopCycles;
+    CycleSum = ((counter & 7) == 0) ? LoopCycles : CycleSum + LoopCycles;
+
+    ++counter;
+    loopTimer += Const_UpdateCycles;
+
+    if( ((long)CNT - loopTimer) > 0 ) {
+      LoopTimes.Overruns++;     // Missed the start of the next time slot
     }
-    else
-    {
-      for( int i=0; i<8; i++ ) {
-        Radio.Channel(i) =  (RC::GetRC( Prefs.ChannelIndex(i)) - Prefs.ChannelCenter(i)) * Prefs.ChannelScale(i) / 1024;
-      }        
+
+
+    // If we go "enough" over our loop allotment (1%) trigger an alarm
+    if( ((long)CNT - loopTimer) > (Const_UpdateCycles/10) ) {
+      BeepOn( 'A' , PIN_BUZZER_1, 4500 );
+      loopTimer = CNT;
     }
 
-      //-------------------------------------------------
-    if( FlightMode == FlightMode_CalibrateCompass )
-    {
-      DoCompassCalibrate();
+    // This used to be a waitcnt, which is technically more accurate, but if the main loop
+    // ever goes over its time allotment the waitcnt() will hold until the counter wraps
+    // around, which is about 53 seconds without control.
+
+    while( ((long)CNT - loopTimer) < 0 ) {
+      // do nothing until the loop elapses
     }
-    //-------------------------------------------------
-    else
-    //-------------------------------------------------
-    {
-      char NewFlightMode;
 
+    //waitcnt( loopTimer );
+  }
+}
 
-      if( Radio.Gear > 512 )
-        NewFlightMode = Prefs.FlightMode[0];    // Forward default is "Assist" - IE altitude hold
-      else if( Radio.Gear < -512 )
-        NewFlightMode = Prefs.FlightMode[2];    // Back default is "Manual"
-      else
-        NewFlightMode = Prefs.FlightMode[1];    // Centered default is "Stable"
 
+void DoFlightUpdate(void)
+{
+  //Read ALL inputs from the sensors into local memory, starting at Temperature
+  memcpy( &sens, Sensors_Address(), Sensors_ParamsSize );
+  GyroSamples = Sensors_GyroSum( GyroSum );   //All the gyro readings since the last update, averaged by the IMU (the PIDs use the latest one)
+  EndLoopPhase( LoopPhase_Sensors );
 
-      char NewControlMode = ControlMode;
+  QuatIMU_Update( (int*)&sens.GyroX , GyroSum , GyroSamples );  //Entire IMU takes ~125000 cycles - queued on the F32 cog, runs while we do the rest
+  AccelZSmooth += (sens.AccelZ - AccelZSmooth) * Prefs.AccelCorrectionFilter / 256;
+  EndLoopPhase( LoopPhase_IMUStart );
 
-      if( NewFlightMode != FlightMode )
-      {
-        if( NewFlightMode == FlightMode_Manual ) {
-          NewControlMode = ControlMode_Manual;
-        }
-        else if( NewFlightMode != FlightMode_AutoManual ) {
-          NewControlMode = ControlMode_AutoLevel;
-        }                    
+  // The receiver drivers apply the channel map, centers and scales as each frame arrives
+  if( Prefs.ReceiverType & 1 ) { // SBUS or RemoteRX?
+    memcpy( &Radio, SBUS::GetRadio(), sizeof(RADIO) );
+  }
+  else {
+    memcpy( &Radio, RC::GetRadio(), sizeof(RADIO) );
+  }
 
-        if( NewFlightMode == FlightMode_Assist ) {
-          DesiredAltitude = AltiEst;
-          DesiredGroundHeight = GroundHeight;  // GroundHeight is now scaled up by 4 bits to allow for stronger smoothing
-        }
+    //-------------------------------------------------
+  if( FlightMode != FlightMode_CalibrateCompass )
+  {
+    char NewFlightMode;
 
-        // ANY flight mode change means you're not currently holding altitude
-        IsHolding = 0;
 
-        FlightMode = NewFlightMode;
-      }
+    if( Radio.Gear > 512 )
+      NewFlightMode = Prefs.FlightMode[0];    // Forward default is "Assist" - IE altitude hold
+    else if( Radio.Gear < -512 )
+      NewFlightMode = Prefs.FlightMode[2];    // Back default is "Manual"
+    else
+      NewFlightMode = Prefs.FlightMode[1];    // Centered default is "Stable"
 
-      if( FlightMode == FlightMode_AutoManual ) {
-        if( abs(Radio.Aile) > 500 || abs(Radio.Elev) > 500 ) {
-          NewControlMode = ControlMode_Manual;
-        }
-        else {
-          NewControlMode = ControlMode_AutoLevel;
-        }
-      }
 
-      if( NewControlMode != ControlMode )
-      {
-        if( NewControlMode == ControlMode_Manual ) {
-          QuatIMU_ResetDesiredOrientation();
-        }
-        else {
-          QuatIMU_ResetDesiredYaw();          // Sync the heading when switching from manual to auto-level
-        }
-        ControlMode = NewControlMode;
+    char NewControlMode = ControlMode;
+
+    if( NewFlightMode != FlightMode )
+    {
+      if( NewFlightMode == FlightMode_Manual ) {
+        NewControlMode = ControlMode_Manual;
       }
+      else if( NewFlightMode != FlightMode_AutoManual ) {
+        NewControlMode = ControlMode_AutoLevel;
+      }                    
 
-      UpdateFlightLoop();            //~72000 cycles when in flight mode
-      //-------------------------------------------------
+      if( NewFlightMode == FlightMode_Assist ) {
+        DesiredAltitude = AltiEst;
+        DesiredGroundHeight = GroundHeight;  // GroundHeight is now scaled up by 4 bits to allow for stronger smoothing
+      }
 
-      // Sound travels approx 343m/sec in 20C air, but it varies with temperature and pressure (faster at higher temps or lower pressure).
-      // This works out to about 232 clock ticks per millimeter (80000000hz / 345 = ~232000 ticks per meter)
-      // Dividing by 256 is relatively close to that, and we don't need the value to be exact, just close
-      // Also, the ping sensor time must be cut in half, because the sound travels to the target, then back again
-      // So I use >> 9 to approximate / 512 (or / 256*2)
+      // ANY flight mode change means you're not currently holding altitude
+      IsHolding = 0;
 
-      #ifdef ENABLE_PING_SENSOR
-      int TempHeight = Servo32_GetPing() >> 9;
-      if( TempHeight < 3000 )                   // 10ft == 3048mm, so check to see if we're just under that
-      {
-        long diff = TempHeight - GroundHeight;
+      FlightMode = NewFlightMode;
+    }
 
-        // Filter it to keep it from changing too fast
-        GroundHeight += diff >> 3;
-        GroundHeightValidCount = counter;    // Record the last loop iteration we had a good reading
+    if( FlightMode == FlightMode_AutoManual ) {
+      if( abs(Radio.Aile) > 500 || abs(Radio.Elev) > 500 ) {
+        NewControlMode = ControlMode_Manual;
+      }
+      else {
+        NewControlMode = ControlMode_AutoLevel;
       }
-      #endif
     }
 
-
-    if( Prefs.UseBattMon )
+    if( NewControlMode != ControlMode )
     {
-      if( StartupDelay > 0 ) {
-        StartupDelay--;       // Count down until the startup delay has passed
-        LEDModeColor = LED_Blue;
+      if( NewControlMode == ControlMode_Manual ) {
+        QuatIMU_ResetDesiredOrientation();
+      }
+      else {
+        QuatIMU_ResetDesiredYaw();          // Sync the heading when switching from manual to auto-level
+      }
+      ControlMode = NewControlMode;
+    }
 
-        if( StartupDelay == 0 ) { // Did we JUST hit zero?
-          QuatIMU_SetErrScaleMode(0);   // No longer in power-up (fast-convergence) mode
-        }          
+    // With the throttle essentially off there's no control authority, so the desired orientation follows the
+    // current one.  This happens here, before the control update is queued, so that update sees it this loop
+    if( FlightEnabled && Radio.Thro < -900 && !(Radio.Thro < -1100 && AllowThrottleCut) )
+    {
+      if( ControlMode == ControlMode_Manual ) {
+        QuatIMU_ResetDesiredOrientation();
       }
-      else
-      {
-        // Update the battery voltage
-        switch( counter & 15 )
-        {
-          case 0: Battery::DischargePin();   break;
-          case 2: Battery::ChargePin();      break;
-    
-          case 15:
-            BatteryVolts = Battery::ComputeVoltage( Battery::ReadResult() ) + Prefs.VoltageOffset;
-            break;
-        }      
+      else {
+        // Zero yaw target when throttle is off - makes for more stable liftoff
+        QuatIMU_ResetDesiredYaw();
       }
     }
+  }
 
-    All_LED( LEDModeColor );
-    QuatIMU_WaitForCompletion();    // Wait for the IMU to finish updating
+  // Queue the control update behind the IMU update - the F32 cog runs both while the flight loop,
+  // battery, and LED code below run here.  The results are picked up after QuatIMU_WaitForCompletion()
+  QuatIMU_UpdateControls( &Radio , ControlMode == ControlMode_Manual , FlightMode == FlightMode_AutoManual );
+  EndLoopPhase( LoopPhase_Radio );
 
 
-    QuatIMU_UpdateControls( &Radio , ControlMode == ControlMode_Manual , FlightMode == FlightMode_AutoManual );   // Now update the control quaternion
-    QuatIMU_WaitForCompletion();
+    //-------------------------------------------------
+  if( FlightMode == FlightMode_CalibrateCompass )
+  {
+    DoCompassCalibrate();
+  }
+  //-------------------------------------------------
+  else
+  //-------------------------------------------------
+  {
+    UpdateFlightLoop();            //~72000 cycles when in flight mode
+    //-------------------------------------------------
 
-    PitchDifference = QuatIMU_GetPitchDifference();
-    RollDifference = QuatIMU_GetRollDifference();
-    YawDifference = -QuatIMU_GetYawDifference();
+    // Sound travels approx 343m/sec in 20C air, but it varies with temperature and pressure (faster at higher temps or lower pressure).
+    // This works out to about 232 clock ticks per millimeter (80000000hz / 345 = ~232000 ticks per meter)
+    // Dividing by 256 is relatively close to that, and we don't need the value to be exact, just close
+    // Also, the ping sensor time must be cut in half, because the sound travels to the target, then back again
+    // So I use >> 9 to approximate / 512 (or / 256*2)
 
+    #ifdef ENABLE_PING_SENSOR
+    int TempHeight = Servo32_GetPing() >> 9;
+    if( TempHeight < 3000 )                   // 10ft == 3048mm, so check to see if we're just under that
+    {
+      long diff = TempHeight - GroundHeight;
 
-    AltiEst = QuatIMU_GetAltitudeEstimate();
-    AscentEst = QuatIMU_GetVerticalVelocityEstimate();
+      // Filter it to keep it from changing too fast
+      GroundHeight += diff >> 3;
+      GroundHeightValidCount = counter;    // Record the last loop iteration we had a good reading
+    }
+    #endif
+  }
 
-    CheckDebugInput();
-    DoDebugModeOutput();
 
-#ifdef ENABLE_LOGGING
-    DoLogOutput();
-#endif
+  if( Prefs.UseBattMon && StartupDelay > 0 )
+  {
+    StartupDelay--;       // Count down until the startup delay has passed - the battery monitor tasks start after that
+    LEDModeColor = LED_Blue;
 
-    LoopCycles = CNT - Cycles;    // Record how long it took for one full iteration
-    CycleCount[counter & 7] = LoopCycles / 64;
+    if( StartupDelay == 0 ) { // Did we JUST hit zero?
+      QuatIMU_SetErrScaleMode(0);   // No longer in power-up (fast-convergence) mode
+    }          
+  }
 
-    ++counter;
-    loopTimer += Const_UpdateCycles;
+  if( LEDTestStep < 0 ) {         // The LED test (DoMotorTest) has the LEDs while it runs
+    All_LED( LEDModeColor );
+  }
+  EndLoopPhase( LoopPhase_FlightLoop );
 
+  QuatIMU_WaitForCompletion();    // Wait for the IMU and control updates to finish
 
-    // If we go "enough" over our loop allotment (1%) trigger an alarm
-    if( ((long)CNT - loopTimer) > (Const_UpdateCycles/10) ) {
-      BeepOn( 'A' , PIN_BUZZER_1, 4500 );
-      loopTimer = CNT;
-    }
+  PitchDifference = QuatIMU_GetPitchDifference();
+  RollDifference = QuatIMU_GetRollDifference();
+  YawDifference = -QuatIMU_GetYawDifference();
 
-    // This used to be a waitcnt, which is technically more accurate, but if the main loop
-    // ever goes over its time allotment the waitcnt() will hold until the counter wraps
-    // around, which is about 53 seconds without control.
 
-    while( ((long)CNT - loopTimer) < 0 ) {
-      // do nothing until the loop elapses
-    }
+  AltiEst = QuatIMU_GetAltitudeEstimate();
+  AscentEst = QuatIMU_GetVerticalVelocityEstimate();
+  EndLoopPhase( LoopPhase_IMUWait );
+}
 
-    //waitcnt( loopTimer );
+
+// Is one of the motor outputs using this pin?
+static bool IsMotorPin( int Pin )
+{
+  for( int i=0; i<MotorCount; i++ ) {
+    if( MotorPin[i] == Pin ) return true;
   }
+  return false;
+}
+
+// A serial port pin, or 32 (unused) if a motor output has it
+static int PortPin( int Pin ) {
+  return IsMotorPin(Pin) ? 32 : Pin;
 }
 
 
@@ -418,20 +547,42 @@ void Initialize(void)
   ControlMode = ControlMode_AutoLevel;
   Stats.Version = 0x0110;   // Version 1.10
 
-  InitSerial();
-
   All_LED( LED_Red & LED_Half );                         //LED red on startup
 
   // Do this before settings are loaded, because Sensors_Start resets the drift coefficients to defaults
   Sensors_Start( PIN_SDI, PIN_SDO, PIN_SCL, PIN_CS_AG, PIN_CS_M, PIN_CS_ALT, PIN_LED, (int)&LEDValue[0], LED_COUNT );
 
-  F32::Start();
+#ifndef QUATIMU_FIXED
+  // The fixed point IMU doesn't need the F32 cog.  If it won't start - no free cog, or an F32 driver built
+  // differently from this code (see F32_PROFILE) - nothing works, so stay here with the LEDs red, beeping
+  if( !F32::Start() ) {
+    while(1) {
+      BeepHz( 4000, 80 );
+      waitcnt( CNT + 40000000 );
+    }
+  }
+#endif
   QuatIMU_Start();
   QuatIMU_SetErrScaleMode(1);   // Start with the IMU in fast-converge mode (takes ~3 instead of ~26 seconds to converge)
 
   InitializePrefs();
   InitReceiver();
 
+  // The frame type is only read here, at power up - frames with more than 4 motors take over AUX pins
+  // that the serial ports and ping sensor would otherwise use, so the serial ports are set up after this
+  FrameType = Prefs.FrameType;
+  Mixer = Mixer_Get( FrameType );
+  if( Mixer->Outputs > (int)sizeof(MotorPin) ) {
+    // Not enough outputs on this board.  The motor pins are driven as a quad X so they idle at min throttle,
+    // but it won't arm with a different motor layout than the one configured
+    FrameType = Frame_QuadX;
+    Mixer = Mixer_Get( FrameType );
+    FrameUnusable = 1;
+  }
+  MotorCount = Mixer->Outputs;
+
+  InitSerial();
+
   // Wait 2 seconds after startup to begin checking battery voltage, rounded to an integer multiple of 16 updates
   // Also used to reduce convergence rate for the IMU (starts up with a high convergence rate)
   StartupDelay = (Const_UpdateRate * 2) & ~15;
@@ -445,13 +596,15 @@ void Initialize(void)
 
 
   Servo32_Init( 400 );
-  for( int i=0; i<4; i++ ) {
+  for( int i=0; i<MotorCount; i++ ) {
     Servo32_AddFastPin( MotorPin[i] );
     Servo32_Set( MotorPin[i], Prefs.MinThrottle );
   }
 
   #ifdef ENABLE_PING_SENSOR
-  Servo32_SetPingPin( PIN_MOTOR_AUX1 );
+  if( !IsMotorPin( PIN_MOTOR_AUX1 ) ) {
+    Servo32_SetPingPin( PIN_MOTOR_AUX1 );
+  }
   #endif
 
   Servo32_Start();
@@ -486,7 +639,7 @@ void Initialize(void)
 
   // Altitude hold PID object
   // The altitude hold PID object feeds speeds into the vertical rate PID object, when in "hold" mode
-  AltPID.Init( AltP, AltI, 600*250, Const_UpdateRate );
+  AltPID.Init( AltP, AltI, 600 * Const_UpdateRate, Const_UpdateRate );
   AltPID.SetMaxOutput( 5000 );    // Fastest the altitude hold object will ask for is 5000 mm/sec (5 M/sec)
   AltPID.SetPIMax( 1000 );
   AltPID.SetMaxIntegral( 4000 );
@@ -495,16 +648,12 @@ void Initialize(void)
 
   // Vertical rate PID object
   // The vertical rate PID object manages vertical speed in alt hold mode
-  AscentPID.Init( AscentP, 0, 400 * 250, Const_UpdateRate );
+  AscentPID.Init( AscentP, 0, 400 * Const_UpdateRate, Const_UpdateRate );
   AscentPID.SetMaxOutput( 3000 );   // Limit of the control rate applied to the throttle
   AscentPID.SetPIMax( 500 );
   AscentPID.SetMaxIntegral( 2000 );
 
 
-#ifdef ENABLE_LOGGING
-  cogstart( &DataLogThread , NULL, log_stack, sizeof(log_stack) );
-#endif
-
 #if defined(EXTRA_LIGHTS)
   LEDValue[3 +  0] = LED_Green;
   LEDValue[4 +  0] = LED_Green;
@@ -525,6 +674,25 @@ void Initialize(void)
 #ifdef ENABLE_LASER_RANGE
   cogstart( &LaserRangeThread , NULL, laser_stack, sizeof(laser_stack) );
 #endif
+
+  //Grab the first set of sensor readings (should be ready by now)
+  memcpy( &sens, Sensors_Address(), Sensors_ParamsSize );
+  Sensors_GyroSum( GyroSum );   // Start the gyro sums from here, so the first update doesn't get everything since power up
+
+  //Set a reasonable starting point for the altitude computation
+  QuatIMU_SetInitialAltitudeGuess( sens.Alt );
+
+  // Set all the motors to their low-throttle point
+  for( int i=0; i<MotorCount; i++ ) {
+    Motor[i] = Prefs.MinThrottle;
+    Servo32_Set( MotorPin[i], Prefs.MinThrottle );
+  }
+
+  Comms_Start();    // The GroundStation link - nothing else touches serial ports 0 and 1 after this
+
+  if( FrameUnusable ) {
+    FrameAlarm();
+  }
 }
 
 
@@ -555,15 +723,19 @@ void InitReceiver(void)
 }
 
 
-static char RXBuf1[32], TXBuf1[64];
-static char RXBuf2[32], TXBuf2[64];
+static char RXBuf1[32], TXBuf1[Comms_TxBufSize];
+static char RXBuf2[32], TXBuf2[Comms_TxBufSize];
 
 #if 1 // Currently unused - these buffers might grow later
 static char RXBuf3[128],TXBuf3[4];  // GPS?
-static char RXBuf4[4],  TXBuf4[64]; // Data Logger
 #else
 static char RXBuf3[32], TXBuf3[4]; // laser rangefinder
-static char RXBuf4[4],  TXBuf4[4]; // Data Logger
+#endif
+
+#ifdef ENABLE_LOGGING
+static char RXBuf4[4],  TXBuf4[1024]; // Blackbox - room for about 10 frames, so a keyframe doesn't get dropped
+#else
+static char RXBuf4[4],  TXBuf4[4];
 #endif
 
 void InitSerial(void)
@@ -573,9 +745,12 @@ void InitSerial(void)
   S4_Define_Port(0, 115200,      30, TXBuf1, sizeof(TXBuf1),      31, RXBuf1, sizeof(RXBuf1));
   S4_Define_Port(1,  57600, XBEE_TX, TXBuf2, sizeof(TXBuf2), XBEE_RX, RXBuf2, sizeof(RXBuf2));
 
-  // Unused ports get a pin value of 32
-  S4_Define_Port(2, 19200,       19, TXBuf3, sizeof(TXBuf3),      20, RXBuf3, sizeof(RXBuf3));
-  S4_Define_Port(3, 115200, PIN_MOTOR_AUX2, TXBuf4, sizeof(TXBuf4), 32, RXBuf4, sizeof(RXBuf4));
+  // Unused ports get a pin value of 32, and so do pins the motors are using
+  S4_Define_Port(2, 19200,       PortPin(19), TXBuf3, sizeof(TXBuf3),      PortPin(20), RXBuf3, sizeof(RXBuf3));
+
+  // The blackbox averages around 65 bytes a frame, 16kb/sec at 250Hz.  With USB, XBee, and this port busy
+  // at once the driver is good for about 236000 baud (see serial_4x_driver.spin).
+  S4_Define_Port(3, 230400, PortPin(PIN_MOTOR_AUX2), TXBuf4, sizeof(TXBuf4), 32, RXBuf4, sizeof(RXBuf4));
 
   S4_Start();
 }
@@ -592,6 +767,34 @@ static int min( int a, int b ) { return a < b ? a : b; }
 
 
 
+// Turns the sums of a 64 reading window into averages, and returns the variation for the worst axis - how far the
+// mid-point between the min & max is from the average, or how much wider the range is than a still gyro's, whichever
+// is more.  A steady turn or a slow ramp is centered, but not narrow.
+static int GyroWindowVariation( int * vmin, int * vmax, int * avg )
+{
+  int maxVar = 0;
+  for( int a=0; a<3; a++)
+  {
+    if( avg[a] >= 0 ) avg[a] += 32;   // rounding to reduce drift
+    else avg[a] -= 32;
+
+    avg[a] /= 64;
+
+    // range is the difference between min and max over the sample period.
+    // I measured this as ~15 units on all axis when totally still
+    int range = vmax[a] - vmin[a];
+
+    // variation is how centered the average is between the min and max.
+    // if the craft is perfectly still, this *should* be zero or VERY close.
+    int var = (vmax[a]+vmin[a])/2 - avg[a];
+
+    maxVar = max( maxVar, abs(var) );
+    maxVar = max( maxVar, range - GyroStillRange );
+  }
+  return maxVar;
+}
+
+
 void FindGyroZero(void)
 {
   // The idea here is that it's VERY hard for someone to hold a thing perfectly still.
@@ -604,6 +807,9 @@ void FindGyroZero(void)
   const int MinTries = 2, MaxTries = 64;
 
   // Wait for any buzzer vibration to stop.  Yes, this is actually necessary, it can be that sensitive.
+  while( Beep_Playing() ) {
+    Beep_Tick();      // Let anything queued (like the arming beeps) finish first
+  }
   waitcnt( CNT + Const_ClockFreq/50 );
 
   do {
@@ -623,28 +829,10 @@ void FindGyroZero(void)
         avg[a] += v;
       }
 
-      waitcnt( CNT + Const_ClockFreq/250 );
+      waitcnt( CNT + Const_UpdateCycles );
     }
 
-    // Compute the mid-point between the min & max, and how different that is from the average (variation)
-    int maxVar = 0;
-    for( int a=0; a<3; a++)
-    {
-      if( avg[a] >= 0 ) avg[a] += 32;   // rounding to reduce drift
-      else avg[a] -= 32;
-
-      avg[a] /= 64;
-
-      // range is the difference between min and max over the sample period.
-      // I measured this as ~15 units on all axis when totally still
-      int range = vmax[a] - vmin[a];
-
-      // variation is how centered the average is between the min and max.
-      // if the craft is perfectly still, this *should* be zero or VERY close.
-      int var = (vmax[a]+vmin[a])/2 - avg[a];
-
-      maxVar = max( maxVar, abs(var) );
-    }
+    int maxVar = GyroWindowVariation( vmin, vmax, avg );
 
     if( (bestvar == -1) || (maxVar < bestvar) ) {
       best[0] = avg[0];
@@ -653,7 +841,8 @@ void FindGyroZero(void)
       bestvar = maxVar;
     }
 
-    // Every 4th loop, beep at the user to tell them what's happening
+    // Every 4th loop, beep at the user to tell them what's happening - this one has to finish before
+    // the next set of readings, so it's played directly instead of queued
     if( (TryCounter & 3) == 3 ) {
       BeepHz( 4000, 80 );
     }
@@ -668,22 +857,105 @@ void FindGyroZero(void)
   GyroZZ = best[2];
 
   QuatIMU_SetGyroZero( GyroZX, GyroZY, GyroZZ );
+
+  GZCount = 0;          // The background zero picks up from here
+  GZVar = bestvar;
+  GZAgree = 0;
 }
 
 
-void UpdateCycleStats(void)
+// Largest difference on any axis between two sets of gyro averages
+static int GyroZeroDiff( const int * a, const int * b )
 {
-  // Prime the initial values
-  int avg;
-  Stats.MinCycles = Stats.MaxCycles = avg = CycleCount[0];
+  int diff = 0;
+  for( int i=0; i<3; i++ ) diff = max( diff, abs(a[i] - b[i]) );
+  return diff;
+}
 
-  for( int i=1; i<8; i++ )
-  {
-    Stats.MinCycles = min( Stats.MinCycles, CycleCount[i] );
-    Stats.MaxCycles = max( Stats.MaxCycles, CycleCount[i] );
-    avg += CycleCount[i];
+
+void UpdateGyroZero(void)
+{
+  // FindGyroZero() done a loop at a time, and all the time while disarmed, so arming doesn't have to wait for it.
+  // The readings from each loop are collected into a window of 64, and the window is checked the same way.  Only a
+  // still window (variation of 2 or less) can become the new zero, and only if it's within GyroZeroStep of the zero
+  // it replaces, so it follows drift as the gyro warms up but not a craft being carried or turned on the bench.
+  // Otherwise it takes still windows in a row that agree with each other - two when the zero didn't come from a
+  // still window (after a reset, or if FindGyroZero gave up), and 8 (2 seconds) to move a zero that did.
+
+  if( FlightEnabled ) {
+    GZCount = 0;            // Start a fresh window after landing
+    GZAgree = 0;
+    return;
   }
-  Stats.AvgCycles = avg >> 3;
+
+  int * g = (int *)&sens.GyroX;
+
+  if( GZCount == 0 ) {
+    for( int a=0; a<3; a++) {
+      GZMin[a] = GZMax[a] = g[a];
+      GZSum[a] = 0;
+    }
+  }
+
+  for( int a=0; a<3; a++) {
+    GZMin[a] = min(GZMin[a], g[a]);
+    GZMax[a] = max(GZMax[a], g[a]);
+    GZSum[a] += g[a];
+  }
+
+  if( ++GZCount < 64 ) return;
+  GZCount = 0;
+
+  int var = GyroWindowVariation( GZMin, GZMax, GZSum );   // GZSum becomes the averages
+
+  if( var > 2 ) {
+    GZAgree = 0;            // Moving - never a zero, and the next still window has nothing to agree with
+    return;
+  }
+
+  int zero[3] = { GyroZX, GyroZY, GyroZZ };
+  char HaveZero = GZVar >= 0 && GZVar <= 2;
+
+  if( GZAgree > 0 && GyroZeroDiff( GZSum, GZLast ) > GyroZeroStep ) GZAgree = 0;
+  if( GZAgree < 8 ) GZAgree++;
+  memcpy( GZLast, GZSum, sizeof(GZLast) );
+
+  if( HaveZero ) {
+    if( GyroZeroDiff( GZSum, zero ) > GyroZeroStep && GZAgree < 8 ) return;
+  }
+  else if( GZAgree < 2 ) return;
+
+  GyroZX = GZSum[0];
+  GyroZY = GZSum[1];
+  GyroZZ = GZSum[2];
+  GZVar = var;
+  GZAgree = 0;
+
+  QuatIMU_SetGyroZero( GyroZX, GyroZY, GyroZZ );
+}
+
+
+void ResetGyroZero(void)
+{
+  // The gyro readings have changed (new drift settings), so the zero has to come from new windows.  The current one
+  // is kept until two still windows in a row agree on a new one.
+  GZCount = 0;
+  GZVar = -1;
+  GZAgree = 0;
+}
+
+
+void UpdateCycleStats(void)
+{
+  // Min / max / avg over the last block of 8 loops, in units of 64 cycles
+  Stats.MinCycles = CycleMin / 64;
+  Stats.MaxCycles = CycleMax / 64;
+  Stats.AvgCycles = CycleSum / (8 * 64);
+}
+
+static int FilterGyro( int Axis, int Rate )   // Only the PIDs see the filtered rates - the IMU gets the raw readings
+{
+  return Biquad_Filter( GyroNotch[Axis], Biquad_Filter( GyroLowpass[Axis], Rate ) );
 }
 
 void UpdateFlightLoop(void)
@@ -717,9 +989,9 @@ void UpdateFlightLoop(void)
       }
     }      
 
-    //Are the sticks being pushed down and toward the center?
+    //Are the sticks being pushed down and toward the center?  (Not while the ESCs are being calibrated)
 
-    if( (Radio.Thro < -750)  &&  (Radio.Elev < -750) )
+    if( (Radio.Thro < -750)  &&  (Radio.Elev < -750)  &&  !EscCalibrating )
     {
       if( (Radio.Rudd > 750)  &&  (Radio.Aile < -750) )
       {
@@ -727,8 +999,14 @@ void UpdateFlightLoop(void)
         CompassConfigStep = 0;
         LEDModeColor = LED_Yellow & LED_Half;
 
-        if( FlightEnableStep >= Prefs.ArmDelay ) {   //Hold for delay time
-          ArmFlightMode();
+        if( FlightEnableStep >= PrefsDelay(Prefs.ArmDelay) ) {   //Hold for delay time
+          if( FrameUnusable ) {
+            FlightEnableStep = 0;     // Refuse, and sound the alarm again for as long as the sticks are held
+            FrameAlarm();
+          }
+          else {
+            ArmFlightMode();
+          }
         }          
       }
       // Compass calibration not enabled yet
@@ -739,7 +1017,7 @@ void UpdateFlightLoop(void)
 
         LEDModeColor = (LED_Blue | LED_Red) & LED_Half;
 
-        if( CompassConfigStep == 250 ) {   //Hold for 1 second
+        if( CompassConfigStep == Const_UpdateRate ) {   //Hold for 1 second
           StartCompassCalibrate();
         }
       }
@@ -765,7 +1043,7 @@ void UpdateFlightLoop(void)
       FlightEnableStep++;
       LEDModeColor = LED_Yellow & LED_Half;
 
-      if( FlightEnableStep >= Prefs.DisarmDelay ) {   //Hold for delay time
+      if( FlightEnableStep >= PrefsDelay(Prefs.DisarmDelay) ) {   //Hold for delay time
         DisarmFlightMode();
         return;                  //Prevents the motor outputs from being un-zero'd
       }        
@@ -780,13 +1058,19 @@ void UpdateFlightLoop(void)
     GyroPitch = -(sens.GyroX - GyroZX);
     GyroYaw = -(sens.GyroZ - GyroZZ);
 
+    int FilterStart = CNT;
+    GyroRoll = FilterGyro( 0, GyroRoll );
+    GyroPitch = FilterGyro( 1, GyroPitch );
+    GyroYaw = FilterGyro( 2, GyroYaw );
+    RecordLoopTime( LoopPhase_GyroFilter, CNT - FilterStart );
+
 
     if( Radio.Thro < -900 )
     {
       if( Radio.Thro < -1100 && AllowThrottleCut )
       {
         // We're in throttle cut - disarm immediately, set a timer to allow rearm
-        for( int i=0; i<4; i++ ) {
+        for( int i=0; i<MotorCount; i++ ) {
           Motor[i] = Prefs.MinThrottle;
           Servo32_Set( MotorPin[i], Prefs.MinThrottle );
         }
@@ -794,24 +1078,15 @@ void UpdateFlightLoop(void)
         FlightEnabled = 0;
         FlightEnableStep = 0;
         CompassConfigStep = 0;
-        ReArmTimer = 250;
+        ReArmTimer = Const_UpdateRate;
 
         All_LED( LED_Green & LED_Half );
         loopTimer = CNT;
         return;   // Exit the loop so the motors stay killed, no additional flight code runs
       }
-      else
-      {
-        // When throttle is essentially zero, disable control authority
-  
-        if( ControlMode == ControlMode_Manual ) {
-          QuatIMU_ResetDesiredOrientation();
-        }
-        else {
-          // Zero yaw target when throttle is off - makes for more stable liftoff
-          QuatIMU_ResetDesiredYaw();
-        }
-      }
+
+      // When throttle is essentially zero, disable control authority (DoFlightUpdate has already
+      // reset the desired orientation, before it queued the control update)
       DoIntegrate = 0;          // Disable PID integral terms until throttle is applied      
     }      
     else {
@@ -819,9 +1094,13 @@ void UpdateFlightLoop(void)
     }
 
 
-    int RollOut = RollPID.Calculate( RollDifference , GyroRoll , DoIntegrate );
-    int PitchOut = PitchPID.Calculate( PitchDifference , GyroPitch , DoIntegrate );
-    int YawOut = YawPID.Calculate( YawDifference, GyroYaw, DoIntegrate );
+    long AxisDifference[3] = { RollDifference, PitchDifference, YawDifference };
+    long AxisGyro[3] = { GyroRoll, GyroPitch, GyroYaw };
+    AxisPID_t::CalculateAll( AxisPID, 3, AxisDifference, AxisGyro, DoIntegrate );
+
+    int RollOut = RollPID.Output;
+    int PitchOut = PitchPID.Output;
+    int YawOut = YawPID.Output;
 
 
     int ThroMix = (Radio.Thro + 1024) >> 1;           // Approx 0 - 1024
@@ -858,7 +1137,7 @@ void UpdateFlightLoop(void)
         else
         {
         #ifdef ENABLE_GROUND_HEIGHT
-          bool GoodHeight = (Radio.Aux1 > 0) && ((counter - GroundHeightValidCount) < 30);
+          bool GoodHeight = (Radio.Aux1 > 0) && ((counter - GroundHeightValidCount) < (Const_UpdateRate * 3 / 25));   // 120ms
           static bool UsedHeight = false;
         #endif
 
@@ -926,11 +1205,7 @@ void UpdateFlightLoop(void)
     }
     //-------------------------------------------
 
-    //X configuration
-    Motor[OUT_FL] = ThroOut + (((+PitchOut + RollOut - YawOut) * ThroMix) >> 7);
-    Motor[OUT_FR] = ThroOut + (((+PitchOut - RollOut + YawOut) * ThroMix) >> 7);
-    Motor[OUT_BL] = ThroOut + (((-PitchOut + RollOut + YawOut) * ThroMix) >> 7);
-    Motor[OUT_BR] = ThroOut + (((-PitchOut - RollOut - YawOut) * ThroMix) >> 7);
+    Mixer->Mix( Motor, ThroOut, PitchOut, RollOut, YawOut, ThroMix );
 
 
     // The low-throttle clamp prevents combined PID output from sending the ESCs below a minimum value
@@ -938,46 +1213,24 @@ void UpdateFlightLoop(void)
 
     if( UsbPulse > 0 && Prefs.DisableMotors == 0 ) {
       // If USB is connected and motors aren't disabled, don't allow throttle to go above test value for added safety.
-      Motor[0] = clamp( Motor[0], Prefs.MinThrottleArmed , Prefs.ThrottleTest);
-      Motor[1] = clamp( Motor[1], Prefs.MinThrottleArmed , Prefs.ThrottleTest);
-      Motor[2] = clamp( Motor[2], Prefs.MinThrottleArmed , Prefs.ThrottleTest);
-      Motor[3] = clamp( Motor[3], Prefs.MinThrottleArmed , Prefs.ThrottleTest);
+      for( int i=0; i<MotorCount; i++ ) {
+        Motor[i] = clamp( Motor[i], Prefs.MinThrottleArmed , Prefs.ThrottleTest);
+      }
     }
     else {
-      Motor[0] = clamp( Motor[0], Prefs.MinThrottleArmed , Prefs.MaxThrottle);
-      Motor[1] = clamp( Motor[1], Prefs.MinThrottleArmed , Prefs.MaxThrottle);
-      Motor[2] = clamp( Motor[2], Prefs.MinThrottleArmed , Prefs.MaxThrottle);
-      Motor[3] = clamp( Motor[3], Prefs.MinThrottleArmed , Prefs.MaxThrottle);
+      for( int i=0; i<MotorCount; i++ ) {
+        Motor[i] = clamp( Motor[i], Prefs.MinThrottleArmed , Prefs.MaxThrottle);
+      }
     }
 
     if( Prefs.DisableMotors == 0 ) {
       //Copy new Ouput array into servo values
-      Servo32_Set( PIN_MOTOR_FL, Motor[0] );
-      Servo32_Set( PIN_MOTOR_FR, Motor[1] );
-      Servo32_Set( PIN_MOTOR_BR, Motor[2] );
-      Servo32_Set( PIN_MOTOR_BL, Motor[3] );
+      for( int i=0; i<MotorCount; i++ ) {
+        Servo32_Set( MotorPin[i], Motor[i] );
+      }
     }
   }
 
-#if defined( __PINS_V3_H__ )
-    // Battery alarm at low voltage
-    if( Prefs.UseBattMon != 0 && Prefs.LowVoltageAlarm != 0 )
-    {
-      // If we want to use the PING sensor *and* use a timer for the alarm, we'll need to
-      // move the freq generator onto another cog.  Currently the battery monitor uses CTRB
-      // to count charge time.  Ideally the PING sensor would use CTRA to count return time,
-      // so we can have one or the other in the main thread, but not both.
-
-      if( (BatteryVolts < Prefs.LowVoltageAlarmThreshold) && (BatteryVolts > 200) && ((counter & 63) == 0) )  // Make sure the voltage is above the (0 + VoltageOffset) range
-      {
-        BeepOn( 'A' , PIN_BUZZER_1, 4800 );
-      }
-      else if( (counter & 63) > 32 )
-      {
-        BeepOff( 'A' );
-      }        
-    }      
-#endif
 }
 
 
@@ -1034,20 +1287,24 @@ void ArmFlightMode(void)
   FlightEnableStep = 0;
   CompassConfigStep = 0;
   Beep2();
-   
-  All_LED( LED_Red & LED_Half );
-  FindGyroZero();
+
+  // No FindGyroZero() here - UpdateGyroZero has been keeping the zero current while disarmed, and
+  // stops now, so the last zero it found is the one used for the flight
+
+  for( int i=0; i<3; i++ ) {      // The gyro filters only run while armed, so don't start from the last flight
+    Biquad_Reset( GyroLowpass[i] );
+    Biquad_Reset( GyroNotch[i] );
+  }
    
   All_LED( LED_Blue & LED_Half );
   BeepTune();
 
   DesiredAltitude = AltiEst;
-  loopTimer = CNT;
 }
 
 void DisarmFlightMode(void)
 {
-  for( int i=0; i<4; i++ ) {
+  for( int i=0; i<MotorCount; i++ ) {
     Motor[i] = Prefs.MinThrottle;
     Servo32_Set( MotorPin[i], Prefs.MinThrottle );
   }
@@ -1058,13 +1315,22 @@ void DisarmFlightMode(void)
   Beep3();
   
   All_LED( LED_Green & LED_Half );
-  loopTimer = CNT;
+}
+
+void FrameAlarm(void)
+{
+  // The frame type in the prefs needs more outputs than this board has - 3 long low beeps, in place of arming
+  if( Beep_Playing() ) return;    // Still sounding the last one
+  for( int i=0; i<3; i++ ) {
+    BeepQueue( 2000, 400 );
+    BeepQueue( 0, 200 );
+  }
 }
 
 void StartCompassCalibrate(void)
 {
   // Make sure the motors are totally off
-  for( int i=0; i<4; i++ ) {
+  for( int i=0; i<MotorCount; i++ ) {
     Motor[i] = Prefs.MinThrottle;
     Servo32_Set( MotorPin[i], Prefs.MinThrottle );
   }
@@ -1073,9 +1339,9 @@ void StartCompassCalibrate(void)
   FlightMode = FlightMode_CalibrateCompass;
 
   Beep();
-  waitcnt( 10000000 + CNT );
+  BeepQueue( 0, 125 );
   Beep2();
-  waitcnt( 10000000 + CNT );
+  BeepQueue( 0, 125 );
   Beep();
 
   calib_Step = 0;
@@ -1132,8 +1398,7 @@ void DoCompassCalibrate(void)
       // are we in a new quadrant?
       if( ((1<<q) | calib_Quadrants) != calib_Quadrants )
       {
-        BeepHz( 5000, 10 );
-        loopTimer = CNT;
+        BeepQueue( 5000, 10 );
         calib_Quadrants |= (1<<q);
       }        
 
@@ -1153,8 +1418,6 @@ void DoCompassCalibrate(void)
         //Reset these for the next phase
         calib_Quadrants = 0;
         calib_StartQuadrant = 0xff;
-
-        loopTimer = CNT;       //Keep the outer counter happy - the beep has a delay, which messes it up
         return;
       }
     }
@@ -1185,8 +1448,7 @@ void DoCompassCalibrate(void)
 
       if( ((1<<q) | calib_Quadrants) != calib_Quadrants )
       {
-        BeepHz( 5000, 10 );
-        loopTimer = CNT;
+        BeepQueue( 5000, 10 );
         calib_Quadrants |= 1<<q;
       }
 
@@ -1243,56 +1505,145 @@ void DoCompassCalibrate(void)
     FlightMode = FlightMode_Stable;
 
     Beep2();
-    waitcnt( 10000000 + CNT );
+    BeepQueue( 0, 125 );
     Beep2();
-    waitcnt( 10000000 + CNT );
+    BeepQueue( 0, 125 );
     Beep2();
 
-    loopTimer = CNT;        // Keep the outer counter happy - the beep has a delay, which messes it up
+    loopTimer = CNT;        // Keep the outer counter happy - the prefs save has a delay, which messes it up
   }
 }
 
 
-void CheckDebugInput(void)
+#ifdef ENABLE_LOGGING
+template<class PID> static void LogPID( long * dest, const PID & pid )
 {
-  int i, c, HostCommand;
-
-  char port = 0;
-  c = S4_Check(0);
-  if(c < 0) {
-    c = S4_Check(1);
-    if(c < 0)
-      return;
-    port = 1;
-    HostCommandXBee = (HostCommandXBee<<8) | c;
-    HostCommand = HostCommandXBee;
+  dest[0] = pid.LastPError;
+  dest[1] = pid.IError;
+  dest[2] = pid.DError;
+  dest[3] = pid.Output;
+}
+
+// The blackbox frame - just copies, the comms cog does the encoding
+static void LogFrame( BLACKBOX_DATA & b )
+{
+  b.Counter = counter;
+  memcpy( b.Sens, &sens, sizeof(b.Sens) );    // Temperature through AltRate, in SENS order
+  for( int i=0; i<8; i++ ) {
+    b.Radio[i] = Radio.Channel(i);
   }
-  else {
-    HostCommandUSB = (HostCommandUSB<<8) | c;
-    HostCommand = HostCommandUSB;
-  }    
 
-  if( HostCommand == Comm_Beat )
-  {
-    Mode = MODE_SensorTest;
-    if( port == 0 ) {
-      UsbPulse = 500;   // send USB data for the next two seconds (we'll get another heartbeat before then)
-      XBeePulse = 0;
-    }
-    if( port == 1 ) {
-      UsbPulse = 0;
-      XBeePulse = 500;  // send XBee data for the next two seconds (we'll get another heartbeat before then)
-    }
-    return;
+  LogPID( b.PID[0], RollPID );
+  LogPID( b.PID[1], PitchPID );
+  LogPID( b.PID[2], YawPID );
+  LogPID( b.PID[3], AltPID );
+  LogPID( b.PID[4], AscentPID );
+
+  b.Roll = QuatIMU_GetRoll();
+  b.Pitch = QuatIMU_GetPitch();
+  b.PitchDifference = PitchDifference;
+  b.RollDifference = RollDifference;
+  b.YawDifference = YawDifference;
+  b.AltiEst = AltiEst;
+  b.AscentEst = AscentEst;
+  b.DesiredAltitude = DesiredAltitude;
+  b.DesiredAscentRate = DesiredAscentRate;
+
+  for( int i=0; i<MotorCount; i++ ) {
+    b.Motor[i] = Motor[i];
   }
+  b.FlightMode = FlightMode;
+}
+#endif
 
-  if( HostCommand == Comm_Elv8 ) {
-    S4_Put_Bytes( port, &HostCommand , 4 );     //Simple ping-back to tell the application we have the right comm port
-    return;
+
+static void TakeLoopTiming(void)
+{
+  // The next loop phase and scheduler task go into the snapshot, and their maximums start over
+  static short Phase, Task;
+
+  LoopTiming.Phase = Phase;
+  LoopTiming.Overruns = LoopTimes.Overruns;
+  LoopTiming.Max = LoopTimes.Max[Phase];
+  memcpy( LoopTiming.Counts, LoopTimes.Counts[Phase], sizeof(LoopTiming.Counts) );
+  LoopTimes.Max[Phase] = 0;
+
+  SCHED_TASK & st = Tasks[Task];
+  LoopTiming.Task = Task;
+  LoopTiming.TaskPeriod = st.Period;
+  LoopTiming.TaskRuns = st.Runs;
+  LoopTiming.TaskOverruns = st.Overruns;
+  LoopTiming.TaskBudget = st.Budget;
+  LoopTiming.TaskMax = st.MaxCycles;
+  st.MaxCycles = 0;
+
+  LoopTiming.LoopCycles = Const_UpdateCycles;
+
+  if( ++Phase == LoopPhase_Count ) Phase = 0;
+  if( ++Task == TaskCount ) Task = 0;
+}
+
+void PublishTelemetry(void)
+{
+  TELEMETRY & t = *Comms_GetSnapshot();
+
+  memcpy( t.Radio, &Radio, 16 );              // First 8 channels of Radio struct is 16 bytes total
+  t.BatteryVolts = BatteryVolts;
+  memcpy( t.Stats, &Stats, 8 );
+  t.Counter = counter;
+
+  t.Sensors[0] = sens.Temperature;            //Copy the values we're interested in into a WORD array, for faster transmission
+  t.Sensors[1] = sens.GyroX;
+  t.Sensors[2] = sens.GyroY;
+  t.Sensors[3] = sens.GyroZ;
+  t.Sensors[4] = sens.AccelX;
+  t.Sensors[5] = sens.AccelY;
+  t.Sensors[6] = sens.AccelZ;
+  t.Sensors[7] = sens.MagX;
+  t.Sensors[8] = sens.MagY;
+  t.Sensors[9] = sens.MagZ;
+
+  memcpy( t.Quat, QuatIMU_GetQuaternion(), 16 );
+  memcpy( t.Motor, Motor, sizeof(Motor) );
+  t.MotorCount = MotorCount;
+  t.FrameType = FrameType;
+
+  if( Comms_LoopTimingWanted() != LoopTimingSeq ) {   // The comms cog sent the last ones
+    LoopTimingSeq = Comms_LoopTimingWanted();
+    TakeLoopTiming();
   }
+  t.LoopTiming = LoopTiming;
+  t.LoopTimingSeq = LoopTimingSeq;
+
+  t.PitchDifference = PitchDifference;
+  t.RollDifference = RollDifference;
+  t.YawDifference = YawDifference;
+  t.Alt = sens.Alt;
+  t.GroundHeight = GroundHeight;
+  t.AltiEst = AltiEst;
+
+  QuatIMU_GetDesiredQ( t.DesiredQ );
+  t.FlightEnabled = FlightEnabled;
+
+#ifdef ENABLE_LOGGING
+  if( FlightEnabled ) LogFrame( t.Log );
+#endif
+
+  Comms_Publish();
+}
 
-  if( FlightEnabled ) return; // Don't allow any settings adjustment when in-flight
 
+void CheckDebugInput(void)
+{
+  int HostCommand = Comms_GetCommand();
+  if( HostCommand == 0 ) return;
+
+  // Don't allow any settings adjustment when in-flight - the comms cog checks this too, but it's working
+  // from the last snapshot, so it can be a loop behind
+  if( FlightEnabled ) {
+    Comms_CommandDone();
+    return;
+  }
 
   switch( HostCommand )
   {
@@ -1303,11 +1654,39 @@ void CheckDebugInput(void)
     case Comm_Motor5:
     case Comm_Motor6:
     case Comm_Motor7:
-      NudgeMotor = (HostCommand&255) - '1';    // Becomes an index from 0 to 5, 0 to 3 are motors, 4 is LED, 5 is beeper
+      NudgeMotor = (HostCommand&255) - '1';    // Becomes an index from 0 to 6, 0 to 3 are motors, 4 is beeper, 5 is LED, 6 is ESC calibration
       if( NudgeMotor < 4 ) {
-        NudgeCount[NudgeMotor] = 50;  // 1/5th of a second at 250 updates per sec
+        NudgeCount[NudgeMotor] = Const_UpdateRate / 5;  // 1/5th of a second
         NudgeMotor = -1;
       }
+      else if( NudgeMotor == 6 ) {
+        EscCalibrating = 1;
+      }
+      break;
+
+    case Comm_CalibrateMax:     // ESC throttle calibration, the user has the ESCs powered and waiting
+      if( EscCalibrating ) {
+        for( int i=0; i<MotorCount; i++ ) {
+          Servo32_Set(MotorPin[i], Prefs.MaxThrottle);
+        }
+      }
+      break;
+
+    case Comm_CalibrateDone:
+      if( EscCalibrating ) {
+        for( int i=0; i<MotorCount; i++ ) {
+          Servo32_Set(MotorPin[i], Prefs.MinThrottle);  // Must add 64 to min throttle value (in this calibration code only) if using ESCs with BLHeli version 14.0 or 14.1
+        }
+        Beep2();                  // Throttle calibration successful
+        EscCalibrating = 0;
+      }
+      break;
+
+    case Comm_CalibrateCancel:
+      if( EscCalibrating ) {
+        BeepQueue(3000,500);      // Throttle calibration cancelled - 1/2 second lower tone
+        EscCalibrating = 0;
+      }
       break;
 
     case Comm_ResetRadio:
@@ -1315,17 +1694,20 @@ void CheckDebugInput(void)
         Prefs.ChannelScale(i) = 1024;
         Prefs.ChannelCenter(i) = 0;
       }
+      ApplyChannelMap();
       Beep2();
       break;
 
     case Comm_ZeroGyro:
       // temporarily zero gyro drift settings
       Sensors_TempZeroDriftValues();
+      ResetGyroZero();
       break;
 
     case Comm_ResetGyro:
       // restore previous settings
       Sensors_ResetDriftValues();
+      ResetGyroZero();
       break;
 
     case Comm_ZeroAccel:
@@ -1338,160 +1720,51 @@ void CheckDebugInput(void)
       Sensors_ResetAccelOffsetValues();
       break;
 
-
-    case Comm_QueryPrefs:  // Query Preferences
-      {
-      Prefs.Checksum = Prefs_CalculateChecksum( Prefs );
-      int size = sizeof(Prefs);
-
-      COMMLINK::StartPacket( 0, 0x18 , size );
-      COMMLINK::AddPacketData( 0, &Prefs, size );
-      COMMLINK::EndPacket(port);
-      }
-      break;
-
-    case Comm_SetPrefs:  //Store new preferences
+    case Comm_SetPrefs:  //Store new preferences - the comms cog has already checked the checksum
       {
-      PREFS TempPrefs;
-      for( int i=0; i<sizeof(Prefs); i++ ) {
-        ((char *)&TempPrefs)[i] = S4_Get_Timed(port, 50);   // wait up to 50ms per byte - Should be plenty
+      PREFS * NewPrefs = Comms_GetPrefs();
+      char NewReceiver = NewPrefs->ReceiverType != Prefs.ReceiverType;
+      char NewOffsets = memcmp( NewPrefs->DriftScale, Prefs.DriftScale, sizeof(Prefs.DriftScale) + sizeof(Prefs.DriftOffset) + sizeof(Prefs.AccelOffset) ) != 0;
+
+      memcpy( &Prefs, NewPrefs, sizeof(Prefs) );
+      Prefs_StartSave();          // Task_PrefsSave writes them out over the next few loops, then beeps
+      PrefsSavedBeep = Beep2;
+
+      BeepOff( 'A' );   // turn off the alarm beeper if it was on
+      ApplyPrefs();
+      if( NewReceiver ) {
+        InitReceiver();   // In case the user changes receiver types
       }
-
-      if( Prefs_CalculateChecksum( TempPrefs ) == TempPrefs.Checksum ) {
-        memcpy( &Prefs, &TempPrefs, sizeof(Prefs) );
-        Prefs_Save();
-
-        if( Prefs_Load() ) {
-          BeepOff( 'A' );   // turn off the alarm beeper if it was on
-          Beep2();
-          ApplyPrefs();
-          InitReceiver();   // In case the user changes receiver types
-          FindGyroZero();   // Prevents the IMU from wandering around when we change gyro or accel offsets
-        }
-        else {
-          Beep();
-        }
-      }
-      else {
-        Beep();
+      if( NewOffsets ) {
+        ResetGyroZero();  // Prevents the IMU from wandering around when we change gyro or accel offsets
       }
       }
       break;
 
+    case Comm_PrefsBad:
+      Beep();
+      break;
+
     case Comm_Wipe: // Default prefs - wipe
       Prefs_SetDefaults();
-      Prefs_Save();
-      Beep3();
+      Prefs_StartSave();
+      PrefsSavedBeep = Beep3;
       break;
-
-    default:
-      return;
   }
 
+  Comms_CommandDone();
   loopTimer = CNT;                                                          //Reset the loop counter in case we took too long 
 }
 
-void DoDebugModeOutput(void)
+void DoMotorTest(void)
 {
-  int loop, addr, i, phase;
-  char port = 0;
-
-  if( UsbPulse > 0 ) {
-    if( --UsbPulse == 0 ) {
-      Mode = MODE_None;
-      return;
-    }
-    phase = counter & 7;    // Translates to 31.25 full updates per second, at 250hz
-  }
-  else if( XBeePulse > 0 )
-  {
-    if( --UsbPulse == 0 ) {
-      Mode = MODE_None;
-      return;
-    }
-    port = 1;
-    phase = ((counter >> 1) & 7) | ((counter & 1) << 16);    // Translates to ~15 full updates per second, at 250hz
-  }    
-
-  if( Mode == MODE_None ) return;
-
-  switch( Mode )
-  {
-    case MODE_SensorTest:
-    {
-      switch( phase )
-      {
-      case 0:
-        COMMLINK::StartPacket( 1, 18 );               // Radio values, 18 byte payload
-        COMMLINK::AddPacketData( &Radio , 16 );       // First 8 channels of Radio struct is 16 bytes total
-        COMMLINK::AddPacketData( &BatteryVolts, 2 );  // Send 2 additional bytes for battery voltage
-        COMMLINK::EndPacket();
-        COMMLINK::SendPacket(port);
-        break;
-
-      case 1:
-        UpdateCycleStats();
-        COMMLINK::StartPacket( 7, 12 );                // Debug values, 16 byte payload
-        COMMLINK::AddPacketData( &Stats, 8 );          // Version number, + Stats on update cycle counts (sending debug data takes a long time)
-        COMMLINK::AddPacketData( &counter, 4 );        // Send the counter (sequence timestamp)
-        COMMLINK::EndPacket();
-        COMMLINK::SendPacket(port);
-        break;
-
-      case 2:
-        TxData[0] = sens.Temperature;       //Copy the values we're interested in into a WORD array, for faster transmission                        
-        TxData[1] = sens.GyroX;
-        TxData[2] = sens.GyroY;
-        TxData[3] = sens.GyroZ;
-        TxData[4] = sens.AccelX;
-        TxData[5] = sens.AccelY;
-        TxData[6] = sens.AccelZ;
-        TxData[7] = sens.MagX;
-        TxData[8] = sens.MagY;
-        TxData[9] = sens.MagZ;
-
-        COMMLINK::BuildPacket( 2, &TxData, 20 );   //Send 20 bytes of data from @TxData onward (sends 10 words worth of data)
-        COMMLINK::SendPacket(port);
-        break;
-
-      case 4:
-        COMMLINK::BuildPacket( 3, QuatIMU_GetQuaternion(), 16 );  // Quaternion data, 16 byte payload
-        COMMLINK::SendPacket(port);
-        break;
-
-      case 5: // Motor data
-        COMMLINK::BuildPacket( 5, &Motor[0], 8 );   // 8 byte payload
-        COMMLINK::SendPacket(port);
-        break;
-
-
-      case 6:
-        COMMLINK::StartPacket( 4, 24 );   // Computed data, 24 byte payload
-
-        COMMLINK::AddPacketData( &PitchDifference, 4 );
-        COMMLINK::AddPacketData( &RollDifference, 4 );
-        COMMLINK::AddPacketData( &YawDifference, 4 );
-
-        COMMLINK::AddPacketData( &sens.Alt, 4 );       //Send 4 bytes of data for Alt
-        COMMLINK::AddPacketData( &GroundHeight, 4 );   //Send 4 bytes of data for height above ground
-        COMMLINK::AddPacketData( &AltiEst, 4 );        //Send 4 bytes for altitude estimate 
-        COMMLINK::EndPacket();
-        COMMLINK::SendPacket(port);
-        break;
-
-      case 7:
-        QuatIMU_GetDesiredQ( (float*)TxData );
-        COMMLINK::BuildPacket( 6, TxData, 16 );   // Desired Quaternion data, 16 byte payload
-        COMMLINK::SendPacket(port);
-        break;
-      }
-    }
-    break;
-  }
-
+  int i;
 
   //Motor test code---------------------------------------
-  if( FlightEnabled ) return;   // Don't run this code in flight - dangerous
+  if( FlightEnabled ) {         // Don't run this code in flight - dangerous
+    LEDTestStep = -1;
+    return;
+  }
 
   // Check to see if any motors are supposed to test-spin
   for( char m=0; m<4; m++ )
@@ -1507,59 +1780,49 @@ void DoDebugModeOutput(void)
   }
 
 
+  // The LED test's rainbow is 768 steps, 2 a loop, so it takes about a second and a half - it used to
+  // run them all at once, 2ms apart, and hold up the flight loop for that long
+  if( LEDTestStep >= 0 )
+  {
+    i = LEDTestStep & 255;
+    if( LEDTestStep < 256 ) {
+      All_LED( ((255-i)<<16) + (i<<8) );
+    }
+    else if( LEDTestStep < 512 ) {
+      All_LED( i + ((255-i) << 8) );
+    }
+    else {
+      All_LED( (255-i) + (i<<16) );
+    }
+
+    LEDTestStep += 2;
+    if( LEDTestStep >= 768 ) LEDTestStep = -1;
+  }
+
+
   if( NudgeMotor > -1 )
   {
     if( NudgeMotor == 4 )                                             //Buzzer test
     {
-      BeepHz(4500, 50);
-      waitcnt( CNT + 5000000 );
-      BeepHz(3500, 50);
+      BeepQueue(4500, 50);
+      BeepQueue(0, 62);
+      BeepQueue(3500, 50);
     }
     else if( NudgeMotor == 5 )                                        //LED test
     {
-      //RGB led will run a rainbow
-      for( i=0; i<256; i++ ) {
-        All_LED( ((255-i)<<16) + (i<<8) );
-        waitcnt( CNT + 160000 );
-      }
-
-      for( i=0; i<256; i++ ) {
-        All_LED( i + ((255-i) << 8) );
-        waitcnt( CNT + 160000 );
-      }
-
-      for( i=0; i<256; i++ ) {
-        All_LED( (255-i) + (i<<16) );
-        waitcnt( CNT + 160000 );
-      }          
+      LEDTestStep = 0;            //RGB led will run a rainbow, starting next loop
     }
     else if( NudgeMotor == 6 )                                        //ESC Throttle calibration
     {
-      BeepHz(4500, 100);
-      waitcnt( CNT + 5000000 );
-      BeepHz(4500, 100);
-      waitcnt( CNT + 5000000 );   // 4 beeps - Throttle calibration waiting power-on command
-      BeepHz(4500, 100);
-      waitcnt( CNT + 5000000 );
-      BeepHz(4500, 100);
-
-      if( S4_Get(0) == 0xFF )     // Safety check - Allow the user to break out by sending anything else                  
-      {
-        for( int i=0; i<4; i++ ) {
-          Servo32_Set(MotorPin[i], Prefs.MaxThrottle);
-        }
-
-        S4_Get(0);  // Get the next character to finish
-
-        for( int i=0; i<4; i++ ) {
-          Servo32_Set(MotorPin[i], Prefs.MinThrottle);  // Must add 64 to min throttle value (in this calibration code only) if using ESCs with BLHeli version 14.0 or 14.1
-        }
-
-        Beep2();                  // Throttle calibration successful
-      }
-      else {
-        BeepHz(3000,500);         // Throttle calibration cancelled - 1/2 second lower tone
-      }        
+      BeepQueue(4500, 100);
+      BeepQueue(0, 62);
+      BeepQueue(4500, 100);
+      BeepQueue(0, 62);           // 4 beeps - Throttle calibration waiting power-on command
+      BeepQueue(4500, 100);
+      BeepQueue(0, 62);
+      BeepQueue(4500, 100);
+
+      // The rest comes from the GroundStation, through the comms cog - see CheckDebugInput
     }        
 
     NudgeMotor = -1;
@@ -1568,55 +1831,6 @@ void DoDebugModeOutput(void)
   //End Motor test code-----------------------------------
 }
 
-#ifdef ENABLE_LOGGING
-void DoLogOutput(void)
-{
-  if( FlightEnabled == 0 ) return;
-  LogTrigger = 1;
-}
-
-
-void DataLogThread(void *par)
-{
-  char phase = 0;
-
-  while( true )
-  {
-    while( LogTrigger == 0 )
-      ;
-
-    if( phase == 0 ) {
-      // Probably better to write this to just dump raw int, float, etc.
-      // MUCH faster, smaller, and the PC can extract it relatively easily
-
-      static char tempBuf[128];
-      char count = 0;
-
-      count =  LogInt( DesiredAscentRate , tempBuf+count );
-      count += LogInt( AscentEst , tempBuf+count );
-      count += LogInt( AscentPID.LastPError , tempBuf+count );
-      count += LogInt( AscentPID.IError , tempBuf+count );
-      count += LogInt( AscentPID.Output , tempBuf+count );
-      count += LogInt( DesiredAltitude , tempBuf+count );
-      count += LogInt( AltiEst, tempBuf+count );
-      count += LogInt( AltPID.LastPError , tempBuf+count );
-      count += LogInt( AltPID.IError , tempBuf+count );
-      count += LogInt( FlightMode , tempBuf+count);
-
-      count += LogInt( Radio.Thro , tempBuf+count );
-      tempBuf[count++] = 13;  // overwrite the last comma with a carriage return
-
-      S4_Put_Bytes( 3, tempBuf, count );
-    }
-
-    phase = (phase+1) & 3; // Cut the data rate down a little
-
-    // Reset the log trigger
-    LogTrigger = 0;
-  }
-}
-#endif
-
 
 #ifdef ENABLE_LASER_RANGE
 void LaserRangeThread( void *par )
@@ -1676,8 +1890,17 @@ void ApplyPrefs(void)
   QuatIMU_SetRollCorrection( &Prefs.RollCorrect[0] );
   QuatIMU_SetPitchCorrection( &Prefs.PitchCorrect[0] );
 
-  QuatIMU_SetAutoLevelRates( Prefs.AutoLevelRollPitch , Prefs.AutoLevelYawRate );
-  QuatIMU_SetManualRates( Prefs.ManualRollPitchRate , Prefs.ManualYawRate );
+  // Rates are stored per update at Prefs_UpdateRate - rescale them to the actual loop rate
+  const float RateScale = (float)Prefs_UpdateRate / (float)Const_UpdateRate;
+  QuatIMU_SetAutoLevelRates( Prefs.AutoLevelRollPitch , Prefs.AutoLevelYawRate * RateScale );
+  QuatIMU_SetManualRates( Prefs.ManualRollPitchRate * RateScale , Prefs.ManualYawRate * RateScale );
+
+  ApplyChannelMap();
+
+  for( int i=0; i<3; i++ ) {
+    Biquad_SetLowpass( GyroLowpass[i], Prefs.GyroLowpass, Const_UpdateRate );
+    Biquad_SetNotch( GyroNotch[i], Prefs.GyroNotch, Prefs.GyroNotchWidth, Const_UpdateRate );
+  }
 
 //#ifdef FORCE_SBUS
 //  Prefs.ReceiverType = 1;
@@ -1689,6 +1912,14 @@ void ApplyPrefs(void)
 }
 
 
+void ApplyChannelMap(void)
+{
+  // Both drivers get the map, so it's already in place if the receiver type changes
+  RC::SetChannelMap( &Prefs.ChannelIndex(0), &Prefs.ChannelCenter(0), &Prefs.ChannelScale(0) );
+  SBUS::SetChannelMap( &Prefs.ChannelIndex(0), &Prefs.ChannelCenter(0), &Prefs.ChannelScale(0) );
+}
+
+
 void All_LED( int Color )
 {
 #if defined(EXTRA_LIGHTS)
@@ -22,19 +22,26 @@
 */
 
 void Initialize(void);
+void DoFlightUpdate(void);
 void InitReceiver(void);
 void InitSerial(void);
 void FindGyroZero(void);
+void UpdateGyroZero(void);
+void ResetGyroZero(void);
+void UpdateCycleStats(void);
 void UpdateFlightLoop(void);
 void UpdateFlightLEDColor(void);
 void ArmFlightMode(void);
 void DisarmFlightMode(void);
+void FrameAlarm(void);
 void StartCompassCalibrate(void);
 void DoCompassCalibrate(void);
+void PublishTelemetry(void);
 void CheckDebugInput(void);
-void DoDebugModeOutput(void);
+void DoMotorTest(void);
 void InitializePrefs(void);
 void ApplyPrefs(void);
+void ApplyChannelMap(void);
 void All_LED( int Color );
 
 
@@ -42,6 +49,9 @@ void All_LED( int Color );
 // #define ENABLE_PING_SENSOR
 // #define ENABLE_LASER_RANGE
 
+// Blackbox flight log on serial port 3 (the AUX2 pin), one binary frame per loop while armed - see blackbox.h
+// #define ENABLE_LOGGING
+
 
 #define EXTRA_LIGHTS
 
@@ -90,6 +100,32 @@ enum CONTROLMODE {
   ControlMode_Manual = 1,
 };  
 
+// Phases of the update loop, as timed for the loop timing packet
+enum LOOPPHASE {
+  LoopPhase_Sensors = 0,      // Copy the sensor readings, gyro sums
+  LoopPhase_IMUStart = 1,     // Queue the IMU update on the F32 cog
+  LoopPhase_Radio = 2,        // Radio copy, flight mode changes, queue the control update
+  LoopPhase_FlightLoop = 3,   // UpdateFlightLoop (or compass calibration), LEDs
+  LoopPhase_IMUWait = 4,      // Wait for the F32 cog, read the results
+  LoopPhase_Comms = 5,        // Publish the telemetry snapshot, run any command from the comms cog
+  LoopPhase_Tasks = 6,        // Sub-rate tasks from the scheduler (motor tests, battery monitor)
+  LoopPhase_Total = 7,        // The whole loop, not counting the wait for the next time slot
+  LoopPhase_GyroFilter = 8,   // The gyro filters for all 3 axes - also counted in FlightLoop
+  LoopPhase_Count = 9,
+};
+
+// Each phase of the update loop is timed with CNT, and the times are counted into a log2 histogram per phase:
+// bucket 0 is under 128 cycles, bucket n is 2^(n+6) up to 2^(n+7), and the last bucket is everything over that.
+// They go to the GroundStation one phase at a time (see LOOPTIMING in comms.h), so it can work out typical and worst
+// case times.
+#define LoopTime_Buckets  16
+
+struct LOOPTIMES {
+  unsigned short Counts[LoopPhase_Count][LoopTime_Buckets];  // Running totals (they wrap - the GroundStation uses the differences)
+  long  Max[LoopPhase_Count];       // Longest time for each phase since it was last taken for telemetry
+  unsigned short Overruns;          // Running count of loops that ran past their time slot
+};
+
 // Structure to hold radio values to make sure they stay in order
 struct RADIO {
   short Thro, Aile, Elev, Rudd, Gear, Aux1, Aux2, Aux3, Aux4;   // Aux4 is an additional raw channel for SBUS users only
@@ -125,6 +161,7 @@ const int LED_DimWhite = LED_White & LED_Half;
 #define Comm_QueryPrefs COMMAND('Q','P','R','F')
 #define Comm_SetPrefs   COMMAND('U','P','r','f')
 #define Comm_Wipe       COMMAND('W','I','P','E')
+#define Comm_Subscribe  COMMAND('S','u','b','s')    // Followed by a period for each telemetry stream (see comms.h)
 
 #define Comm_ZeroGyro   COMMAND('Z','r','G','r')
 #define Comm_ZeroAccel  COMMAND('Z','e','A','c')
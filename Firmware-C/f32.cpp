@@ -38,6 +38,26 @@ static struct F32_DATA {
   };
 } v;
 
+// Streams waiting for the F32 cog.  It runs entry [done & (F32_QueueSize-1)] until done catches up
+// with queued, writing done back after each one.  Only this code writes queued, only the cog writes done.
+#define F32_QueueSize  4      // must be a power of two, and match QueueMask in f32_driver.spin
+
+static struct F32_QUEUE {
+  volatile int done;
+  volatile int queued;
+  struct {
+    int StreamAddr, VarAddr;              // The profiling build cog replaces VarAddr with the cycles the stream took
+  } entry[F32_QueueSize];
+
+#ifdef F32_PROFILE
+  F32_STATS prof;                       // OpCycles has to follow the entries, the cog finds it from there
+#endif
+} q;
+
+#ifdef F32_PROFILE
+static int ProfileAddr[F32_ProfileStreams];
+#endif
+
 static short* CommandAddr[4];
 static char cog;
 
@@ -60,7 +80,14 @@ int F32::Start(void)
 
   v.cmdCallTableAddr = (int *)driverMem + i + 1;
 
-  cog = load_cog_driver(f32_driver, &v.f32_cmd);
+  // The profiling driver has a nop where Log2 goes - don't start one that was built the other way from this
+#ifdef F32_PROFILE
+  if( v.cmdCallTableAddr[F32_opReserved12] != 0 ) return 0;
+#else
+  if( v.cmdCallTableAddr[F32_opLog2] == 0 ) return 0;
+#endif
+
+  cog = load_cog_driver(f32_driver, &v.f32_cmd) + 1;   // -1 if there's no free cog
   return cog;
 }
 
@@ -75,23 +102,88 @@ void F32::Stop(void)
 }
 */
 
-void F32::RunStream( unsigned char * a , float * b )
+// Starts the cog on the queue if it's idle and there's anything in it.  When the cog finds the queue empty
+// it clears f32_cmd and then looks at the queue again, so a stream added while it was still busy isn't
+// left waiting for the next call - either the cog sees it, or this sees f32_cmd clear and kicks it.
+static void KickQueue(void)
+{
+  if( v.f32_cmd == 0 && q.done != q.queued )
+  {
+    //Can't use the stack for these, because they might be different by the time the COG gets to them
+    v.TempCommand = v.cmdCallTableAddr[ F32_opRunQueue ];
+    v.StreamAddr = (int)&q;
+    v.f32_cmd = (int)&v.TempCommand;
+  }
+}
+
+
+int F32::RunStream( unsigned char * a , float * b )
 {
-  //Can't use the stack for these, because they might be different by the time the COG gets to them
-  v.TempCommand = v.cmdCallTableAddr[ F32_opRunStream ];
-  v.StreamAddr = (int)a;
-  v.VarAddr = (int)b;
-  v.f32_cmd = (int)&v.TempCommand;
+  int seq = q.queued;
+
+  while( seq - q.done >= F32_QueueSize )  // Queue full?
+    KickQueue();
+
+#ifdef F32_PROFILE
+  // The stream that last used this entry has finished, so count its cycles before the entry is reused
+  if( seq >= F32_QueueSize ) {
+    int i = seq & (F32_QueueSize-1);
+    for( int s=0; s<F32_ProfileStreams; s++ ) {
+      if( ProfileAddr[s] == q.entry[i].StreamAddr ) {
+        q.prof.StreamRuns[s]++;
+        q.prof.StreamCycles[s] += q.entry[i].VarAddr;
+        break;
+      }
+    }
+  }
+#endif
+
+  q.entry[seq & (F32_QueueSize-1)].StreamAddr = (int)a;
+  q.entry[seq & (F32_QueueSize-1)].VarAddr = (int)b;
+  q.queued = ++seq;
+
+  KickQueue();
+  return seq;
 }
 
 
 void F32::WaitStream(void)
 {
-	while( v.f32_cmd )
-		;
+  WaitStream( q.queued );
+
+  while( v.f32_cmd )    // Let the cog get back to its idle loop before anyone issues a direct command
+    ;
 }
 
 
+void F32::WaitStream( int seq )
+{
+  while( (q.done - seq) < 0 )
+    KickQueue();
+}
+
+
+bool F32::StreamDone( int seq )
+{
+  KickQueue();
+  return (q.done - seq) >= 0;
+}
+
+
+#ifdef F32_PROFILE
+void F32::ProfileStream( int slot, unsigned char * stream )
+{
+  ProfileAddr[slot] = (int)stream;
+}
+
+
+F32_STATS * F32::GetProfile(void)
+{
+  return &q.prof;
+}
+#endif
+
+
 /*  // FDIV is currently unused
 float F32::FDiv(float _a, float _b)
 {
@@ -122,6 +214,8 @@ float F32::FFloat( int n )
 //    n        32-bit integer value
 //  Returns:   32-bit floating point value
 
+  WaitStream();   // The cog handles one command at a time
+
   v.a = n;
 
   v.result = v.cmdCallTableAddr[ F32_opFloat ];
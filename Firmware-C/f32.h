@@ -16,17 +16,40 @@
 */
 
 
+// Profiling build - counts the cog cycles spent in each op and each stream.  Turned on by defining F32_PROFILE
+// for the whole build, so f32_driver.spin gets it too (see PROFILING there)
+
+#ifdef F32_PROFILE
+#define F32_ProfileStreams  4
+
+struct F32_STATS {
+  unsigned int OpCycles[32];                          // cycles spent in each op, indexed by F32_op (written by the cog)
+  unsigned int StreamRuns[F32_ProfileStreams];        // times each stream given to ProfileStream() has run
+  unsigned int StreamCycles[F32_ProfileStreams];      // cycles spent in each of those streams
+};                                                    // all running totals - they wrap, so compare two samples
+#endif
+
+
 class F32
 {
 public:
   static int  Start(void);
   static void Stop(void);
 
-  static void RunStream( unsigned char * a, float * b );
-  static void WaitStream(void);
+  // Streams are queued and run back to back by the F32 cog.  RunStream only waits if the queue is full,
+  // and returns a sequence number that can be waited on, or polled with StreamDone()
+  static int  RunStream( unsigned char * a, float * b );
+  static void WaitStream(void);               // waits for every queued stream
+  static void WaitStream( int seq );          // waits for the stream RunStream returned 'seq' for
+  static bool StreamDone( int seq );
 
   static float FFloat( int n );
   static float FDiv( float a, float b );
+
+#ifdef F32_PROFILE
+  static void ProfileStream( int slot, unsigned char * stream );    // counts 'stream' in StreamRuns/Cycles[slot]
+  static F32_STATS * GetProfile(void);
+#endif
 };
 
 
@@ -45,15 +68,15 @@ PUB FSqrt(a)
 PUB FCmp(a, b)
 PUB Sin(a)
 PUB Cos(a)
-PUB Tan(a)
+//PUB Tan(a)
 PUB Log(a) | b
 PUB Log2(a) | b
 PUB Log10(a) | b
 PUB Exp(a) | b
 PUB Exp2(a) | b
 PUB Exp10(a) | b
-PUB Pow(a, b)
-PUB Frac(a)
+//PUB Pow(a, b)
+//PUB Frac(a)
 PUB FNeg(a)
 PUB FAbs(a)
 PUB Radians(a) | b
@@ -83,10 +106,15 @@ PUB FShift(a, b)
 #define F32_opCmp                  8    // if(a>b) result = 1;  if(a<b) result = -1; else result = 0;
 #define F32_opSin                  9    // result = Sin(a)
 #define F32_opCos                  10   // result = Cos(a)
-#define F32_opTan                  11   // result = Tan(a)
+#define F32_opReserved11           11   // (was Tan - removed from the cog to make room, the number is kept so the rest don't move)
+#ifndef F32_PROFILE
 #define F32_opLog2                 12   // result = Log2(a)
 #define F32_opExp2                 13   // result = Exp2(a)
-#define F32_opPow                  14   // result = Pow(a,b)  (ie a to the power of b)
+#else
+#define F32_opReserved12           12   // (Log2 - left out of the profiling build's cog to make room)
+#define F32_opReserved13           13   // (Exp2 - left out of the profiling build's cog to make room)
+#endif
+#define F32_opReserved14           14   // (was Pow - removed from the cog to make room, the number is kept so the rest don't move)
 #define F32_opASinCos              15   // if(b==0) result = ACos(a) else result = ASin(a)
 #define F32_opATan2                16   // result = ATan2(a,b)
 #define F32_opShift                17   // result = a  x  pow(2, (float)b)  (works like a binary shift, but on floats)
@@ -94,10 +122,15 @@ PUB FShift(a, b)
 #define F32_opSinCos               19   // result = Sin(a),  b=Cos(a)   (faster than calling opSin(a) + opCos(a)
 #define F32_opFAbs                 20   // result = FAbs(a)
 #define F32_opFMin                 21   // if(a<b) result = a  else result = b
-#define F32_opFrac                 22   // result = fractional portion of a  (portion after the decimal point)
+#define F32_opReserved22           22   // (was Frac - removed from the cog to make room, the number is kept so the rest don't move)
 #define F32_opCNeg                 23   // if(b<0)  a = -a  else  a = a
 #define F32_opMov                  24   // result = a
 #define F32_opRunStream            25
+#define F32_opFMA                  26   // result += a * b                      (stream only - reads the result before writing it)
+#define F32_opDot3                 27   // result = a[0]*b[0] + a[1]*b[1] + a[2]*b[2]   (stream only - a and b are the first of 3 consecutive vars)
+#define F32_opDot4                 28   // result = a[0]*b[0] + ... + a[3]*b[3]         (stream only - a and b are the first of 4 consecutive vars)
+#define F32_opRSqrt                29   // result = 1.0 / Sqrt(a)
+#define F32_opRunQueue             30
 
 
 /*
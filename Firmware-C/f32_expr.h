@@ -0,0 +1,289 @@
+#ifndef __F32_EXPR_H__
+#define __F32_EXPR_H__
+
+/*
+  Elev8 Flight Controller
+
+  F32 expression streams - write F32 command streams as ordinary math
+
+  C++ API Copyright 2015 Parallax Inc
+
+  Released under the MIT License (see the end of f32_driver.spin for details)
+*/
+
+#include "f32.h"
+
+/*
+  Command streams are arrays of { F32_op, a, b, out } byte tuples that index a float / int
+  variable array.  Writing them by hand means one line per operation and hand-picked temp
+  variables.  This header lets the same streams be written as expressions:
+
+    namespace IMU_Expr {
+      F32_VAR(qdw);  F32_VAR(rx);  F32_VAR(ry);  F32_VAR(rz);  ...
+
+      unsigned char * const Stream = F32_STREAM( ::temp, ::temp3,
+        qdw = (rx*qx + ry*qy + rz*qz) * const_neghalf,
+        qdx = Shift( rx*qw + rz*qy - ry*qz, const_neg1 )
+      );
+    }
+
+  Everything happens at compile time - the result is a plain unsigned char array holding
+  the same tuples you would have typed, with the 0,0,0,0 terminator, so it can be passed to
+  QuatIMU_AdjustStreamPointers() and F32::RunStream() like any other stream.  No code is
+  generated for the Propeller.
+
+  - Variables are the indices of the variable array (an enum).  F32_VAR(name) declares a typed
+    stand-in for the enum value 'name', so declare them inside a namespace to keep them apart.
+    The operators and functions are found through the argument types, so no 'using' is needed,
+    except for Op<F32_op>(), which has to be written F32Expr::Op<F32_op>().
+  - The float constants have to be variables too (const_neghalf, not -0.5f) - they're loaded
+    into the array at runtime, and a float can't be a template argument anyway.
+  - Statements are separated by commas and run in order.  Every statement assigns one var.
+  - Intermediate values go into the temp vars given to F32_STREAM (first..last, inclusive),
+    or straight into the destination when that's safe.  Running out of temps, or assigning to
+    one of them by name, is a compile error.
+  - a + b*c becomes opFMA, and a*b + c*d + e*f (+ g*h) over consecutive vars becomes opDot3
+    (opDot4).  Both produce exactly the same bits as the separate Mul / Add ops would.
+  - Ops without an operator are functions: Float(), Sqrt(), RSqrt(), Shift(), FAbs(), FMin(),
+    Cmp(), CNeg(), ATan2(), ASinCos(), TruncRound(), Dot3(), Dot4(), SinCos(), and Op<F32_op>()
+    for anything else.
+
+  Needs -std=c++0x (variadic templates and decltype).
+*/
+
+
+namespace F32Expr {
+
+// Byte lists -----------------------------------------------------------------
+
+template<unsigned char... c> struct Bytes {
+  static unsigned char data[];
+};
+
+template<unsigned char... c> unsigned char Bytes<c...>::data[] = { c... };
+
+template<class A, class B> struct Cat;
+template<unsigned char... a, unsigned char... b> struct Cat< Bytes<a...>, Bytes<b...> > {
+  typedef Bytes<a..., b...> type;
+};
+
+template<int op, int a, int b, int out> struct Instr {
+  typedef Bytes<(unsigned char)op, (unsigned char)a, (unsigned char)b, (unsigned char)out> type;
+};
+
+template<bool c, class A, class B> struct If            { typedef A type; };
+template<class A, class B>         struct If<false, A, B> { typedef B type; };
+
+
+// Expression types ------------------------------------------------------------
+// These are only ever named inside decltype(), so none of the functions below have bodies.
+
+template<int D, class E> struct Assign {};
+template<int Op, class A, class B> struct Expr {};
+template<class... S> struct Seq {};
+
+template<int N> struct Var {
+  template<class E> Assign<N, E> operator=( const E & ) const;
+};
+
+typedef Var<0> None;                                      // unused operand
+
+
+// The operators only take part when both sides are Var / Expr, so they leave plain int and enum math alone
+template<class E> struct IsTerm                               { enum { value = 0 }; };
+template<int N> struct IsTerm< Var<N> >                       { enum { value = 1 }; };
+template<int Op, class A, class B> struct IsTerm< Expr<Op, A, B> > { enum { value = 1 }; };
+
+template<bool c, class R> struct EnableIf {};
+template<class R>         struct EnableIf<true, R> { typedef R type; };
+
+template<int Op, class A, class B> struct BinOp : EnableIf< IsTerm<A>::value && IsTerm<B>::value, Expr<Op, A, B> > {};
+
+template<class A, class B> typename BinOp<F32_opAdd, A, B>::type operator+( const A &, const B & );
+template<class A, class B> typename BinOp<F32_opSub, A, B>::type operator-( const A &, const B & );
+template<class A, class B> typename BinOp<F32_opMul, A, B>::type operator*( const A &, const B & );
+template<class A, class B> typename BinOp<F32_opDiv, A, B>::type operator/( const A &, const B & );
+template<class A>          typename EnableIf< IsTerm<A>::value, Expr<F32_opNeg, A, None> >::type operator-( const A & );
+
+template<class A>          Expr<F32_opFloat, A, None> Float( const A & );
+template<class A>          Expr<F32_opSqrt,  A, None> Sqrt( const A & );
+template<class A>          Expr<F32_opRSqrt, A, None> RSqrt( const A & );
+template<class A>          Expr<F32_opFAbs,  A, None> FAbs( const A & );
+template<class A, class B> Expr<F32_opShift, A, B> Shift( const A &, const B & );          // a * 2^b  (b is an int var)
+template<class A, class B> Expr<F32_opFMin,  A, B> FMin( const A &, const B & );
+template<class A, class B> Expr<F32_opCmp,   A, B> Cmp( const A &, const B & );
+template<class A, class B> Expr<F32_opCNeg,  A, B> CNeg( const A &, const B & );
+template<class A, class B> Expr<F32_opATan2, A, B> ATan2( const A &, const B & );
+template<class A, class B> Expr<F32_opASinCos, A, B> ASinCos( const A &, const B & );      // b: int 0 = acos, 1 = asin
+template<class A, class B> Expr<F32_opTruncRound, A, B> TruncRound( const A &, const B & ); // b: int 0 = trunc, 1 = round
+template<int a, int b>     Expr<F32_opDot3, Var<a>, Var<b> > Dot3( const Var<a> &, const Var<b> & );
+template<int a, int b>     Expr<F32_opDot4, Var<a>, Var<b> > Dot4( const Var<a> &, const Var<b> & );
+template<class A, int s>   Expr<F32_opSinCos, A, Var<s> > SinCos( const A &, const Var<s> & );  // result = cos(a), and s = sin(a)
+template<int op, class A, class B> Expr<op, A, B> Op( const A &, const B & );
+
+template<int D1, class E1, int D2, class E2>
+Seq< Assign<D1, E1>, Assign<D2, E2> > operator,( const Assign<D1, E1> &, const Assign<D2, E2> & );
+
+template<class... S, int D, class E>
+Seq< S..., Assign<D, E> > operator,( const Seq<S...> &, const Assign<D, E> & );
+
+
+// Expression properties --------------------------------------------------------
+
+template<class E> struct Index            { enum { leaf = 0, value = -1 }; };
+template<int N>   struct Index< Var<N> >  { enum { leaf = 1, value = N }; };
+
+template<int Op> struct Span { enum { value = (Op == F32_opDot3) ? 3 : (Op == F32_opDot4) ? 4 : 1 }; };
+
+// Reads<E, N>::value is non-zero if evaluating E reads var N
+template<class E, int N, int span = 1> struct Reads;
+template<int M, int N, int span> struct Reads< Var<M>, N, span > {
+  enum { value = (N >= M && N < M + span) };
+};
+template<int Op, class A, class B, int N, int span> struct Reads< Expr<Op, A, B>, N, span > {
+  enum { value = Reads<A, N, Span<Op>::value>::value || Reads<B, N, Span<Op>::value>::value };
+};
+
+// a * b with both operands plain vars
+template<class E> struct LeafMul { enum { value = 0, a = 0, b = 0 }; };
+template<int a_, int b_> struct LeafMul< Expr<F32_opMul, Var<a_>, Var<b_> > > { enum { value = 1, a = a_, b = b_ }; };
+
+// a[0]*b[0] + a[1]*b[1] + a[2]*b[2] ( + a[3]*b[3] ), summed left to right over consecutive vars
+template<class E> struct DotSum { enum { len = 0, a = 0, b = 0 }; };
+
+template<class E0, class E1, class E2> struct Dot3Terms {
+  enum { len = ( LeafMul<E0>::value && LeafMul<E1>::value && LeafMul<E2>::value &&
+                 LeafMul<E1>::a == LeafMul<E0>::a + 1 && LeafMul<E2>::a == LeafMul<E0>::a + 2 &&
+                 LeafMul<E1>::b == LeafMul<E0>::b + 1 && LeafMul<E2>::b == LeafMul<E0>::b + 2 ) ? 3 : 0,
+         a = LeafMul<E0>::a, b = LeafMul<E0>::b };
+};
+
+template<class E0, class E1, class E2>
+struct DotSum< Expr<F32_opAdd, Expr<F32_opAdd, E0, E1>, E2> > : Dot3Terms<E0, E1, E2> {};
+
+template<class E0, class E1, class E2, class E3>
+struct DotSum< Expr<F32_opAdd, Expr<F32_opAdd, Expr<F32_opAdd, E0, E1>, E2>, E3> > {
+  typedef Dot3Terms<E0, E1, E2> first;
+  enum { len = ( first::len != 0 && LeafMul<E3>::value &&
+                 LeafMul<E3>::a == first::a + 3 && LeafMul<E3>::b == first::b + 3 ) ? 4 : 0,
+         a = first::a, b = first::b };
+};
+
+
+// Code generation ---------------------------------------------------------------
+// Emit<E, D, T, TL>::type is the byte list that evaluates E into var D, using temps T..TL
+
+// Picks temp T if 'need' is set (checking there's one left), or D if not
+template<bool need, int T, int TL, int D> struct TempOr {
+  static_assert( !need || T <= TL, "F32 expression needs more temp variables" );
+  enum { value = need ? T : D };
+};
+
+template<class E, int D, int T, int TL> struct Emit;
+
+template<int N, int D, int T, int TL> struct Emit< Var<N>, D, T, TL > {
+  typedef typename If< N == D, Bytes<>, typename Instr<F32_opMov, N, 0, D>::type >::type type;
+};
+
+// The general case.  A subexpression is built in the destination itself when that can't
+// overwrite something still to be read, otherwise in the next free temp.
+template<int Op, class A, class B, int D, int T, int TL,
+         int kind = Index<A>::leaf + Index<B>::leaf * 2> struct EmitOp;
+
+template<int Op, class A, class B, int D, int T, int TL> struct EmitOp<Op, A, B, D, T, TL, 3> {
+  typedef typename Instr<Op, Index<A>::value, Index<B>::value, D>::type type;
+};
+
+template<int Op, class A, class B, int D, int T, int TL> struct EmitOp<Op, A, B, D, T, TL, 2> {
+  enum { X = TempOr<Index<B>::value == D, T, TL, D>::value,  NT = (X == D) ? T : T + 1 };
+  typedef typename Cat< typename Emit<A, X, NT, TL>::type,
+                        typename Instr<Op, X, Index<B>::value, D>::type >::type type;
+};
+
+template<int Op, class A, class B, int D, int T, int TL> struct EmitOp<Op, A, B, D, T, TL, 1> {
+  enum { Y = TempOr<Index<A>::value == D, T, TL, D>::value,  NT = (Y == D) ? T : T + 1 };
+  typedef typename Cat< typename Emit<B, Y, NT, TL>::type,
+                        typename Instr<Op, Index<A>::value, Y, D>::type >::type type;
+};
+
+template<int Op, class A, class B, int D, int T, int TL> struct EmitOp<Op, A, B, D, T, TL, 0> {
+  enum { X = TempOr<Reads<B, D>::value, T, TL, D>::value,  NT = (X == D) ? T : T + 1,
+         Y = TempOr<true, NT, TL, 0>::value };
+  typedef typename Cat< typename Emit<A, X, NT, TL>::type,
+          typename Cat< typename Emit<B, Y, NT + 1, TL>::type,
+                        typename Instr<Op, X, Y, D>::type >::type >::type type;
+};
+
+// d = a + b*c  ->  d = a;  FMA b, c, d
+template<class A, int b, int c, int D, int T, int TL> struct EmitFMA {
+  typedef typename Cat< typename Emit<A, D, T, TL>::type,
+                        typename Instr<F32_opFMA, b, c, D>::type >::type type;
+};
+
+template<class E, int D> struct EmitDot {
+  typedef typename Instr< DotSum<E>::len == 4 ? F32_opDot4 : F32_opDot3, DotSum<E>::a, DotSum<E>::b, D >::type type;
+};
+
+template<class A, class B, int D, int T, int TL> struct EmitAdd {
+  typedef Expr<F32_opAdd, A, B> E;
+  typedef typename If< DotSum<E>::len != 0,                           EmitDot<E, D>,
+          typename If< LeafMul<B>::value && !Reads<B, D>::value,      EmitFMA<A, LeafMul<B>::a, LeafMul<B>::b, D, T, TL>,
+          typename If< LeafMul<A>::value && !Reads<A, D>::value,      EmitFMA<B, LeafMul<A>::a, LeafMul<A>::b, D, T, TL>,
+                                                                      EmitOp<F32_opAdd, A, B, D, T, TL> >::type >::type >::type sel;
+  typedef typename sel::type type;
+};
+
+template<int Op, class A, class B, int D, int T, int TL> struct Emit< Expr<Op, A, B>, D, T, TL >
+  : EmitOp<Op, A, B, D, T, TL> {};
+
+template<class A, class B, int D, int T, int TL> struct Emit< Expr<F32_opAdd, A, B>, D, T, TL >
+  : EmitAdd<A, B, D, T, TL> {};
+
+
+// Streams --------------------------------------------------------------------------
+
+template<int T, int TL, class... S> struct Join { typedef Bytes<> type; };
+
+template<int T, int TL, int D, class E, class... S> struct Join<T, TL, Assign<D, E>, S...> {
+  static_assert( D < T || D > TL, "F32 expression assigns to one of its own temp variables" );
+  typedef typename Cat< typename Emit<E, D, T, TL>::type, typename Join<T, TL, S...>::type >::type type;
+};
+
+template<class S, int T, int TL> struct Stream;
+
+template<class... S, int T, int TL> struct Stream< Seq<S...>, T, TL > {
+  typedef typename Cat< typename Join<T, TL, S...>::type, Bytes<0, 0, 0, 0> >::type type;
+};
+
+template<int D, class E, int T, int TL> struct Stream< Assign<D, E>, T, TL > : Stream< Seq< Assign<D, E> >, T, TL > {};
+
+} // namespace F32Expr
+
+
+// Declares 'name' as the expression stand-in for the variable index ::name
+#define F32_VAR(name)    extern const F32Expr::Var< ::name > name
+
+// Compiles the statements into a command stream, and evaluates to a pointer to its first byte
+#define F32_STREAM( tempFirst, tempLast, ... ) \
+  (F32Expr::Stream< decltype(( __VA_ARGS__ )), (tempFirst), (tempLast) >::type::data)
+
+
+/*
++------------------------------------------------------------------------------------------------------------------------------+
+|                                                   TERMS OF USE: MIT License                                                  |
++------------------------------------------------------------------------------------------------------------------------------+
+|Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation    |
+|files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy,    |
+|modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software|
+|is furnished to do so, subject to the following conditions:                                                                   |
+|                                                                                                                              |
+|The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.|
+|                                                                                                                              |
+|THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE          |
+|WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR         |
+|COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,   |
+|ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                         |
++------------------------------------------------------------------------------------------------------------------------------+
+*/
+
+#endif
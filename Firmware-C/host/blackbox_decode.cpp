@@ -0,0 +1,187 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Turns a blackbox log (what the firmware writes to serial port 3 on ENABLE_LOGGING builds - see
+// blackbox.h for the frame layout) into text, one line per frame, with the field names on the first line.
+//
+//   blackbox_decode [-q] < log.bin
+//
+// Frames with a bad checksum are skipped, and the reader looks for the next sync bytes.  Difference
+// frames are only decoded once there's a keyframe to apply them to, and after a gap in the sequence
+// numbers (frames dropped by the firmware, or lost on the way) it waits for the next keyframe again.
+// At the end it reports the frame counts, the gaps (which include any time spent disarmed, when nothing is
+// logged), and the average frame size.  -q just reports.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "blackbox.h"
+
+static const int MaxFields = offsetof(BLACKBOX_DATA, FlightMode) / sizeof(long);
+static const int FixedFields = MaxFields - 8;    // Everything before Motor[]
+
+static const char * FieldNames[] = {
+  "counter",
+  "temp", "gx", "gy", "gz", "ax", "ay", "az", "mx", "my", "mz", "alt", "altRate",
+  "thro", "aile", "elev", "rudd", "gear", "aux1", "aux2", "aux3",
+  "rollP", "rollI", "rollD", "rollOut",
+  "pitchP", "pitchI", "pitchD", "pitchOut",
+  "yawP", "yawI", "yawD", "yawOut",
+  "altP", "altI", "altD", "altOut",
+  "ascentP", "ascentI", "ascentD", "ascentOut",
+  "roll", "pitch", "pitchDiff", "rollDiff", "yawDiff",
+  "altiEst", "ascentEst", "desiredAlt", "desiredAscent",
+  "m0", "m1", "m2", "m3", "m4", "m5", "m6", "m7",
+};
+
+
+// Reads one zig-zag value, or returns 0 if it runs past the end
+static const unsigned char * GetValue( const unsigned char * p, const unsigned char * end, int & v )
+{
+  unsigned int z = 0;
+  for( int shift = 0; shift < 35; shift += 7 ) {
+    if( p == end ) return 0;
+    unsigned char b = *p++;
+    z |= (unsigned int)(b & 0x7f) << shift;
+    if( (b & 0x80) == 0 ) {
+      v = (int)(z >> 1) ^ -(int)(z & 1);
+      return p;
+    }
+  }
+  return 0;
+}
+
+
+int main( int argc, char ** argv )
+{
+  bool quiet = false;
+
+  for( int i=1; i<argc; i++ )
+  {
+    if( strcmp( argv[i], "-q" ) == 0 ) {
+      quiet = true;
+    }
+    else {
+      fprintf( stderr, "usage: blackbox_decode [-q] < log.bin\n" );
+      return 1;
+    }
+  }
+
+  // Logs are small enough to read in whole - an hour at 250Hz is around 60mb
+  size_t size = 0, room = 1 << 20;
+  unsigned char * buf = (unsigned char *)malloc( room );
+  size_t n;
+  while( (n = fread( buf + size, 1, room - size, stdin )) > 0 ) {
+    size += n;
+    if( size == room ) {
+      room *= 2;
+      buf = (unsigned char *)realloc( buf, room );
+    }
+  }
+
+  if( !quiet ) {
+    printf( "# seq key mode" );
+    for( int i=0; i<MaxFields; i++ ) printf( " %s", FieldNames[i] );
+    printf( "\n" );
+  }
+
+  int Values[MaxFields];
+  bool HaveKey = false;
+  int LastSeq = -1;
+  int Frames = 0, Keyframes = 0, Printed = 0, BadSums = 0, Gaps = 0, Missing = 0, Skipped = 0;
+  size_t FrameBytes = 0;
+
+  const unsigned char * end = buf + size;
+  const unsigned char * p = buf;
+
+  while( end - p >= 6 )
+  {
+    if( p[0] != 0xE8 || p[1] != 0xB8 ) {
+      p++;
+      Skipped++;
+      continue;
+    }
+
+    int seq = p[2];
+    int flags = p[3];
+    int motors = flags >> 4;
+    int count = FixedFields + (motors <= 8 ? motors : 8);
+    bool key = (flags & 1) != 0;
+
+    int v[MaxFields];
+    const unsigned char * q = p + 4;
+    for( int i=0; i<count && q; i++ ) {
+      q = GetValue( q, end, v[i] );
+    }
+
+    unsigned char sum1 = 0, sum2 = 0;
+    if( q && end - q >= 2 ) {
+      for( const unsigned char * s = p + 2; s < q; s++ ) {
+        sum1 += *s;
+        sum2 += sum1;
+      }
+    }
+
+    if( motors > 8 || !q || end - q < 2 || q[0] != sum1 || q[1] != sum2 ) {
+      BadSums++;
+      HaveKey = false;      // Whatever this was, the next good frame can't be applied to the last one
+      p++;
+      Skipped++;
+      continue;
+    }
+
+    Frames++;
+    FrameBytes += q + 2 - p;
+
+    if( LastSeq >= 0 && seq != ((LastSeq + 1) & 255) ) {
+      Gaps++;
+      Missing += (seq - LastSeq - 1) & 255;
+      HaveKey = false;
+    }
+    LastSeq = seq;
+
+    if( key ) {
+      Keyframes++;
+      memcpy( Values, v, count * sizeof(int) );
+      HaveKey = true;
+    }
+    else if( HaveKey ) {
+      for( int i=0; i<count; i++ ) Values[i] += v[i];
+    }
+
+    if( HaveKey && !quiet ) {
+      printf( "%d %d %d", seq, key ? 1 : 0, (flags >> 1) & 7 );
+      for( int i=0; i<count; i++ ) printf( " %d", Values[i] );
+      printf( "\n" );
+    }
+    if( HaveKey ) Printed++;
+
+    p = q + 2;
+  }
+
+  fprintf( stderr, "%d frames (%d keyframes), %d decoded, %.1f bytes per frame\n", Frames, Keyframes, Printed,
+           Frames ? (double)FrameBytes / Frames : 0.0 );
+  fprintf( stderr, "%d sequence gaps (about %d frames missing), %d bad checksums, %d bytes skipped\n", Gaps, Missing, BadSums, Skipped );
+
+  free( buf );
+  return 0;
+}
@@ -0,0 +1,972 @@
+/*
+  Elev8 Flight Controller
+
+  F32 - Concise floating point code for the Propeller
+
+  Copyright (c) 2011 Jonathan "lonesock" Dummer
+  Ported to C++, modified for stream processing, and new instructions added by Jason Dorie
+
+  C++ API Copyright 2015 Parallax Inc
+
+  Released under the MIT License (see the end of f32_driver.spin for details)
+*/
+
+// Host (PC) version of the F32 module.  Rather than re-implementing the math with the host FPU,
+// this emulates the PASM in f32_driver.spin one instruction at a time, using the same registers,
+// flags, and ROM tables, so results match the cog bit for bit.  The function and register names
+// below are the labels from f32_driver.spin - keep the two in sync when changing either.
+
+#include <math.h>
+#include <stdio.h>
+
+#include <propeller.h>
+#include "f32.h"
+#include "f32_host.h"
+
+
+typedef uint32_t u32;
+
+// Constants from the end of the PASM code
+static const u32 SignFlag       = 0x1;
+static const u32 ZeroFlag       = 0x2;
+static const u32 NaNFlag        = 0x8;
+
+static const u32 One            = 0x3F800000;   // 1.0
+static const u32 NaN            = 0x7FFFFFFF;
+static const u32 Minus23        = (u32)-23;
+static const u32 Mask23         = 0x007FFFFF;
+static const u32 TableMask      = 0x0FFE;
+static const u32 Bit16          = 0x00010000;
+static const u32 Bit29          = 0x20000000;
+static const u32 Bit30          = 0x40000000;
+static const u32 Bit31          = 0x80000000;
+static const u32 LogTable       = 0xC000;
+static const u32 ALogTable      = 0xD000;
+static const u32 SineTable      = 0xE000;
+static const u32 OneOver2Pi     = 0x3E22F983;   // 1.0 / (2.0 * pi), as compiled into the DAT block
+
+static const u32 CORDIC_Pi      = 0x3243f6a8;
+static const u32 CORDIC_Angles[25] = {
+  0xc90fdaa, 0x76b19c1, 0x3eb6ebf, 0x1fd5ba9, 0xffaadd,
+  0x7ff556,  0x3ffeaa,  0x1fffd5,  0xffffa,   0x7ffff,
+  0x3ffff,   0x20000,   0x10000,   0x8000,    0x4000,
+  0x2000,    0x1000,    0x800,     0x400,     0x200,
+  0x100,     0x80,      0x40,      0x20,      0x10,
+};
+
+
+// Cog registers and flags.  These persist between commands, just like on the cog.
+static u32 t1, t2, t3, t4, t5, t6, t7;
+static u32 fnumA, flagA, expA, manA;
+static u32 fnumB, flagB, expB, manB;
+static bool C, Z;
+
+// Hub addresses of the operands while a stream runs (null for F32_Host_Op, except SinCos' B)
+static u32 * AAddr;             // t1 on the cog, used by _Dot
+static u32 * BAddr;             // t2 on the cog, used by _SinCos and _Dot
+static u32 * OutAddr;           // dstAddr on the cog, used by _FMA
+
+
+// Propeller ROM tables, $C000 to $FFFF, as 16 bit words
+static unsigned short Rom[0x2000];
+static bool RomLoaded;
+
+
+static void GenerateRom(void)
+{
+  memset( Rom, 0, sizeof(Rom) );
+
+  for( int i=0; i<2048; i++ ) {
+    Rom[(LogTable  - 0xC000)/2 + i] = (unsigned short)floor( log2( 1.0 + i / 2048.0 ) * 65536.0 + 0.5 );
+    Rom[(ALogTable - 0xC000)/2 + i] = (unsigned short)floor( (pow( 2.0, i / 2048.0 ) - 1.0) * 65536.0 + 0.5 );
+  }
+  for( int i=0; i<=2048; i++ ) {
+    Rom[(SineTable - 0xC000)/2 + i] = (unsigned short)floor( sin( i * M_PI / 4096.0 ) * 65535.0 + 0.5 );
+  }
+  RomLoaded = true;
+}
+
+
+int F32_Host_LoadRom( const char * filename )
+{
+  FILE * f = fopen( filename, "rb" );
+  if( f == 0 ) return 0;
+
+  unsigned char buf[0x8000];
+  size_t len = fread( buf, 1, sizeof(buf), f );
+  fclose(f);
+  if( len != sizeof(buf) ) return 0;
+
+  for( int i=0; i<0x2000; i++ ) {
+    Rom[i] = buf[0x4000 + i*2] | (buf[0x4000 + i*2 + 1] << 8);    // hub memory is little-endian
+  }
+  RomLoaded = true;
+  return 1;
+}
+
+
+// P1 instruction helpers - shift counts only use the low 5 bits of the source
+
+static inline u32 Shl( u32 d, u32 s ) { return d << (s & 31); }
+static inline u32 Shr( u32 d, u32 s ) { return d >> (s & 31); }
+static inline u32 Sar( u32 d, u32 s ) { return (u32)((int32_t)d >> (s & 31)); }
+static inline u32 Ror( u32 d, u32 s ) { s &= 31;  return s ? (d >> s) | (d << (32-s)) : d; }
+static inline u32 Neg( u32 s ) { return 0u - s; }
+static inline u32 Abs( u32 s ) { return (s & Bit31) ? Neg(s) : s; }
+static inline bool Parity( u32 v ) { return __builtin_parity(v) != 0; }
+
+static inline u32 Rev( u32 d, u32 s )
+{
+  u32 r = 0;
+  for( int i=0; i<32; i++ ) {
+    r = (r << 1) | (d & 1);
+    d >>= 1;
+  }
+  return r >> (s & 31);
+}
+
+static inline u32 RdWord( u32 addr )
+{
+  addr &= 0xFFFE;                             // rdword ignores the low address bit
+  if( addr < 0xC000 ) return 0;
+  return Rom[(addr - 0xC000) / 2];
+}
+
+
+static void _Unpack(void);
+static void _Pack(void);
+
+
+//----------------------------
+// addition and subtraction
+// fnumA = fnumA +- fnumB
+//----------------------------
+
+static void _Unpack2(void)
+{
+  t1 = fnumA;                                 // save A
+  fnumA = fnumB;                              // unpack B to A
+  _Unpack();
+  if( C ) return;                             // check for NaN
+
+  fnumB = fnumA;                              // save B variables
+  flagB = flagA;
+  expB = expA;
+  manB = manA;
+
+  fnumA = t1;                                 // unpack A
+  _Unpack();
+  Z = (manB == 0);                            // set Z flag
+}
+
+
+static void _FAdd(void)
+{
+  _Unpack2();
+  if( C || Z ) return;                        // check for NaN or B = 0
+
+  if( flagA & SignFlag ) manA = Neg(manA);    // negate A mantissa if negative
+  if( flagB & SignFlag ) manB = Neg(manB);    // negate B mantissa if negative
+
+  t1 = expA - expB;                           // align mantissas
+  C = (t1 & Bit31) != 0;
+  t1 = Abs(t1);
+  if( t1 > 31 ) t1 = 31;
+  if( !C ) manB = Sar( manB, t1 );
+  if( C ) {
+    manA = Sar( manA, t1 );
+    expA = expB;
+  }
+
+  manA += manB;                               // add the two mantissas
+  C = (manA & Bit31) != 0;                    // store the absolute value,
+  manA = Abs(manA);
+  flagA = C ? (flagA | SignFlag) : (flagA & ~SignFlag);   // and flag if it was negative
+
+  _Pack();
+}
+
+static void _FSub(void)
+{
+  fnumB ^= Bit31;                             // negate B
+  _FAdd();
+}
+
+
+//----------------------------
+// multiplication
+// fnumA *= fnumB
+//----------------------------
+static void _FMul(void)
+{
+  _Unpack2();
+  if( C ) return;                             // check for NaN
+
+  flagA ^= flagB;                             // get sign of result
+  expA += expB;                               // add exponents
+
+  t1 = manA;                                  // the first argument is the multiplier
+  Z = (t1 == 0);
+
+  manA = 0;                                   // manA is the accumulator
+  manB = Rev( manB, 32-30 );                  // right align the reverse of the B mantissa
+
+  do {
+    if( !Z ) {
+      C = (manB & 1) != 0;                    // get multiplier bit, and note if we hit 0
+      manB >>= 1;
+      Z = (manB == 0);
+    }
+    if( C ) manA += t1;                       // if the bit was set, add in the multiplicand
+    t1 >>= 1;
+  } while( !Z );
+
+  _Pack();
+}
+
+
+//----------------------------
+// division
+// fnumA /= fnumB
+//----------------------------
+static void _FDiv(void)
+{
+  _Unpack2();
+  if( C || Z ) {                              // check for NaN or divide by 0
+    fnumA = NaN;
+    return;
+  }
+
+  flagA ^= flagB;                             // get sign of result
+  expA -= expB;                               // subtract exponents
+
+  t1 = 0;                                     // clear quotient
+  for( t2 = 26; t2 != 0; t2-- ) {             // 26 passes (24, plus 2 for rounding)
+    C = (manA >= manB);
+    if( C ) manA -= manB;
+    t1 = (t1 << 1) | (C ? 1 : 0);
+    manA <<= 1;
+  }
+  t1 <<= 4;                                   // align the result (26 instead of 30 iterations)
+
+  manA = t1;
+  _Pack();
+}
+
+
+//------------------------------------------------------------------------------
+// fnumA = float(fnumA)
+//------------------------------------------------------------------------------
+static void _FFloat(void)
+{
+  C = (fnumA & Bit31) != 0;
+  manA = Abs(fnumA);
+  Z = (manA == 0);
+  if( Z ) return;                             // if zero, exit
+
+  flagA = C ? (flagA | SignFlag) : (flagA & ~SignFlag);
+  expA = 29;
+  _Pack();
+}
+
+
+//------------------------------------------------------------------------------
+// rounding and truncation
+// fnumB controls the output format:
+//       %00 = integer, truncate
+//       %01 = integer, round
+//       %10 = float, truncate
+//       %11 = float, round
+//------------------------------------------------------------------------------
+static void _FTruncRound(void)
+{
+  t1 = fnumA;                                 // grab a copy of the input
+  _Unpack();
+
+  C = (fnumB >= 2);                           // clear bit 1 and set C if it was a 1
+  if( C ) fnumB -= 2;
+  t2 = (t2 << 1) | (C ? 1 : 0);
+  t2 &= 1;
+  Z = (t2 == 0);                              // Z now signifies integer output
+
+  manA <<= 2;                                 // left justify mantissa
+  expA -= 30;                                 // our target exponent is 30
+  C = (expA & Bit31) != 0;
+  expA = Abs(expA);
+
+  if( Z && !C ) {                             // integer output, and it's too large for us to handle
+    manA = NaN;
+    goto check_sign;
+  }
+  if( !Z && !C ) {                            // float output, and we're already all integer
+    fnumA = t1;
+    return;
+  }
+
+  C = (expA < 32);
+  if( expA > 31 ) expA = 31;
+  manA = Shr( manA, expA );
+  if( C ) manA += fnumB;                      // round up 1/2 lsb if desired
+  manA >>= 1;
+
+  if( Z ) goto check_sign;                    // integer output?
+
+  expA = 29;
+  _Pack();
+  return;
+
+check_sign:
+  Z = (flagA & SignFlag) == 0;                // check sign and exit
+  fnumA = Z ? manA : Neg(manA);
+}
+
+
+//------------------------------------------------------------------------------
+// square root
+// fnumA = sqrt(fnumA)
+//------------------------------------------------------------------------------
+static void _FSqrt(void)
+{
+  _Unpack();
+  if( C || Z ) return;                        // check for NaN or zero
+  if( flagA & SignFlag ) {                    // negative, so return NaN
+    fnumA = NaN;
+    return;
+  }
+
+  C = (expA & 1) != 0;                        // if odd exponent, shift mantissa
+  expA = Sar( expA, 1 );
+  if( C ) manA <<= 1;
+  expA += 1;
+
+  fnumA = 0;
+  for( t2 = 29; t2 != 0; t2-- ) {
+    t3 = Shl( (fnumA << 2) + 1, t2 );         // what is the delta root^2 if we add in this bit?
+    C = (manA >= t3);                         // is the remainder >= delta?
+    if( C ) manA -= t3;
+    fnumA = (fnumA << 1) | (C ? 1 : 0);
+    manA <<= 1;
+  }
+
+  manA = fnumA;
+  _Pack();
+}
+
+
+//------------------------------------------------------------------------------
+// compare fnumA , fnumB
+// fnumA = 1 if fnumA > fnumB, -1 if fnumA < fnumB, 0 if fnumA = fnumB
+//------------------------------------------------------------------------------
+static void _FCmp(void)
+{
+  C = ((uint64_t)fnumA + fnumB) > 0xFFFFFFFFu;  // if both values are negative...
+  t1 = C ? Neg(1) : 1;                        // then the comparison will be reversed
+  C = (int32_t)fnumA < (int32_t)fnumB;
+  Z = (fnumA == fnumB);
+  if( Z ) t1 = 0;
+  fnumA |= fnumB;                             // +0 == -0, so compare for both being 0
+  fnumA &= ~Bit31;
+  Z = (fnumA == 0);
+  if( !Z ) fnumA = C ? Neg(t1) : t1;
+}
+
+
+//------------------------------------------------------------------------------
+// FMin (a,b) = minimum of(fnumA, fnumB)
+//------------------------------------------------------------------------------
+static void _FMin(void)
+{
+  bool reversed = ((uint64_t)fnumA + fnumB) > 0xFFFFFFFFu;
+
+  C = (int32_t)fnumA < (int32_t)fnumB;
+  if( reversed ? C : !C ) fnumA = fnumB;      // CompareReversed / CompareNormal
+}
+
+
+//------------------------------------------------------------------------------
+// table lookup
+// t1 = 31-bit number: 1-bit 0, then 11-bits real, then 20-bits fraction
+// t2 = table base address
+// returns t1 = 30-bit interpolated number
+//------------------------------------------------------------------------------
+static void _Table_Interp(void)
+{
+  t4 = Rev( t1, 12 );                         // store the fractional part, reversed
+  t1 >>= 19;                                  // table offset, multiplied by 2
+  C = Parity( t2 & SineTable );               // C = 1 if we're doing a SINE table lookup
+  t2 += t1;
+  t1 = RdWord( t2 ) << 14;
+
+  t2 += 2;
+
+  Z = (t2 & TableMask) == 0;                  // table address has overflowed
+  if( Z && !C )
+    t2 = Bit16;
+  else
+    t2 = RdWord( t2 );
+  t2 <<= 14;
+
+  t2 -= t1;                                   // change from 2 points to delta
+  t2 = (t2 & ~0x1FFu) | (t4 & 0x1FF);         // make the low 9 bits the multiplier (reversed)
+  for( t3 = 9; t3 != 0; t3-- ) {
+    C = (t2 & 1) != 0;                        // divide the delta by 2, and get the multiplier bit
+    t2 = Sar( t2, 1 );
+    if( C ) t1 += t2;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// sine and cosine
+// fnumA = sin(fnumA) for sine
+// fnumA = sin(fnumA+pi/2) for cosine
+//------------------------------------------------------------------------------
+static void _resume_Tan(void)
+{
+  Z = (manA & Bit29) == 0;
+  t1 = Z ? manA : Neg(manA);
+  t1 <<= 2;
+
+  t2 = SineTable;
+  _Table_Interp();
+
+  Z = (manA & Bit30) == 0;                    // check if we're in quadrant 3 or 4
+  manA = Abs(t1);                             // move my number into the mantissa
+  manA >>= 16;                                // the table went to $FFFF, so scale up a bit to
+  manA += Abs(t1);                            // get to $10000
+  if( !Z ) flagA ^= SignFlag;                 // invert the sign in quadrant 3 or 4
+  expA = Neg(1);
+  _Pack();
+}
+
+static void _SinCos_cont(void)
+{
+  fnumB = OneOver2Pi;
+  _FMul();                                    // rescale angle from [0..2pi] to [0..1]
+
+  _Unpack();
+
+  expA += 2;                                  // bias the exponent so the result is 31-bit aligned
+  C = (expA & Bit31) != 0;
+  expA = Abs(expA);
+  if( expA > 31 ) expA = 31;
+  if( C ) manA = Shr( manA, expA );
+  else    manA = Shl( manA, expA );
+
+  t6 = manA;                                  // store the angle in case Tan needs it
+  manA += t4;                                 // adjust for cosine?
+
+  _resume_Tan();
+}
+
+static void _Sin(void)
+{
+  t4 = 0;
+  _SinCos_cont();
+}
+
+static void _Cos(void)
+{
+  t4 = Bit29;                                 // add 90 degrees
+  fnumA &= ~Bit31;
+  _SinCos_cont();
+}
+
+
+//------------------------------------------------------------------------------
+// SinCos - sin(fnumA) is written to the B operand, cos(fnumA) is the result
+//------------------------------------------------------------------------------
+static void _SinCos(void)
+{
+  u32 * dest = BAddr;                         // t7 on the cog
+  _Sin();
+  if( dest ) *dest = fnumA;
+
+  manA = t6 + Bit29;                          // add in 90 degrees
+  _resume_Tan();
+}
+
+
+//------------------------------------------------------------------------------
+// log2
+// fnumA = log2(fnumA), divided by fnumB to change bases if fnumB is non-zero
+//------------------------------------------------------------------------------
+static void _Log2(void)
+{
+  _Unpack();
+  if( !Z && !C ) C = Parity( flagA & SignFlag );
+  if( Z || C ) {                              // if NaN or <= 0, return NaN
+    fnumA = NaN;
+    return;
+  }
+
+  t1 = manA << 3;
+  t1 >>= 1;
+  t2 = LogTable;
+  _Table_Interp();
+
+  manA = t1 >> 5;                             // store the interpolated table lookup
+
+  C = (expA & Bit31) != 0;                    // process the exponent
+  expA = Abs(expA);
+  flagA = C ? (flagA | SignFlag) : (flagA & ~SignFlag);
+
+  expA <<= 25;                                // recombine exponent into the mantissa
+  manA = C ? Neg(manA) : manA;
+  manA += expA;
+  expA = 4;
+  _Pack();
+
+  Z = (fnumB == 0);                           // convert the base (unless fnumB was 0)
+  if( !Z ) _FDiv();
+}
+
+
+//------------------------------------------------------------------------------
+// exp2
+// fnumA = 2 ** fnumA, multiplied by fnumB first to change bases if fnumB is non-zero
+//------------------------------------------------------------------------------
+static void _Exp2(void)
+{
+  Z = (fnumB == 0);
+  if( !Z ) _FMul();
+
+  _Unpack();
+  manA <<= 2;                                 // left justify mantissa
+  t1 = expA;
+
+  t1 -= 30;                                   // get the whole number
+  C = (t1 & Bit31) != 0;
+  expA = Abs(t1);
+  if( !C ) {
+    Z = (flagA & SignFlag) == 0;              // too large - NaN if positive, 0 if negative
+    fnumA = Z ? NaN : 0;
+    return;
+  }
+
+  t2 = manA;
+  if( expA > 31 ) expA = 31;
+  t2 = Shr( t2, expA );
+  t2 >>= 1;
+  expA = t2;
+
+  t1 += 31;                                   // get the fractional part
+  C = (t1 & Bit31) != 0;
+  t2 = Abs(t1);
+  if( C ) manA = Shr( manA, t2 );
+  else    manA = Shl( manA, t2 );
+
+  t1 = manA >> 1;                             // do the table lookup
+  t2 = ALogTable;
+  _Table_Interp();
+
+  t6 = flagA;                                 // store a copy of the sign
+
+  manA = t1 | Bit30;                          // combine
+  expA -= 1;
+  flagA = 0;
+  _Pack();
+
+  if( (t6 & SignFlag) == 0 ) return;          // negative, so invert
+  fnumB = fnumA;
+  fnumA = One;
+  _FDiv();
+}
+
+
+//------------------------------------------------------------------------------
+// Conditional negate
+// fnumA = (fnumB < 0) ? -fnumA : fnumA
+//------------------------------------------------------------------------------
+static void _CNeg(void)
+{
+  if( fnumB & Bit31 ) fnumA ^= Bit31;
+}
+
+
+//------------------------------------------------------------------------------
+// fused multiply-add
+// fnumA = (fnumA * fnumB) + current value of the output
+//------------------------------------------------------------------------------
+static void _FMA(void)
+{
+  _FMul();
+  if( !OutAddr ) return;                      // stream only
+  fnumB = *OutAddr;
+  _FAdd();
+}
+
+
+//------------------------------------------------------------------------------
+// dot product of 3 or 4 consecutive values
+// fnumA = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] ( + a[3]*b[3] )
+//------------------------------------------------------------------------------
+static void _Dot(void)
+{
+  if( !AAddr || !BAddr ) return;              // stream only
+  u32 * pa = AAddr;                           // t5 on the cog
+  u32 * pb = BAddr;                           // t6 on the cog
+  t7 = 0;                                     // clear the accumulator (0.0)
+
+  do {
+    fnumA = *pa++;
+    fnumB = *pb++;
+    _FMul();
+    fnumB = t7;
+    _FAdd();
+    t7 = fnumA;
+  } while( --t3 != 0 );
+}
+
+static void _Dot3(void) { t3 = 3; _Dot(); }
+static void _Dot4(void) { t3 = 4; _Dot(); }
+
+
+//------------------------------------------------------------------------------
+// reciprocal square root
+// fnumA = 1.0 / sqrt(fnumA)
+//------------------------------------------------------------------------------
+static void _RSqrt(void)
+{
+  _FSqrt();
+  fnumB = fnumA;
+  fnumA = One;
+  _FDiv();
+}
+
+
+//------------------------------------------------------------------------------
+// arctan2
+// fnumA = atan2( fnumA, fnumB )
+//------------------------------------------------------------------------------
+static void _ATan2(void)
+{
+  _Unpack2();
+  fnumA = 0;                                  // clear my accumulator
+
+  expA -= expB;                               // which is the larger exponent?
+  C = (expA & Bit31) != 0;
+  expA = Abs(expA);
+
+  manA >>= 1;                                 // decrease resolution to avoid overflow
+  manB >>= 1;
+
+  if( C ) manA = Shr( manA, expA );           // make the exponents equal
+  else    manB = Shr( manB, expA );
+
+  C = Parity( flagA & SignFlag );             // correct signs based on the Quadrant
+  Z = (flagB & SignFlag) == 0;
+  if( Z == C ) manA = Neg(manA);
+  if( !Z ) fnumA = C ? fnumA - CORDIC_Pi : fnumA + CORDIC_Pi;
+
+  for( t1 = 0; t1 < 25; t1++ ) {              // do the CORDIC thing
+    C = (manA & Bit31) != 0;                  // mark whether our Y component is negative or not
+    t3 = Sar( manA, t1 );
+    t4 = Sar( manB, t1 );
+    manB = C ? manB - t3 : manB + t3;         // C determines the direction of the rotation
+    manA = C ? manA + t4 : manA - t4;
+    fnumA = C ? fnumA - CORDIC_Angles[t1] : fnumA + CORDIC_Angles[t1];
+  }
+
+  expA = 1;                                   // convert to a float
+  C = (fnumA & Bit31) != 0;
+  manA = Abs(fnumA);
+  flagA = C ? (flagA | SignFlag) : (flagA & ~SignFlag);
+  _Pack();
+}
+
+
+//------------------------------------------------------------------------------
+// arcsine or arccosine
+// asin( x ) = atan2( x, sqrt( 1 - x*x ) )
+// acos( x ) = atan2( sqrt( 1 - x*x ), x )
+//------------------------------------------------------------------------------
+static void _ASinCos(void)
+{
+  t5 = fnumA;                                 // grab a copy of both operands
+  t6 = fnumB;
+
+  fnumB = fnumA;                              // square fnumA
+  _FMul();
+  fnumB = fnumA;
+  fnumA = One;
+  _FSub();
+
+  if( fnumA & Bit31 ) {                       // quick error check
+    fnumA = NaN;
+    return;
+  }
+  _FSqrt();
+
+  Z = (t6 == 0);                              // sine or cosine?
+  if( Z ) fnumB = t5;
+  else {
+    fnumB = fnumA;
+    fnumA = t5;
+  }
+  _ATan2();
+}
+
+
+//------------------------------------------------------------------------------
+// _Shift fnumA, fnumB = fnumA * (2.0 ^ fnumB)
+//------------------------------------------------------------------------------
+static void _Shift(void)
+{
+  _Unpack();
+  if( C || Z ) return;                        // check for NaN or zero
+
+  expA += fnumB;
+  _Pack();
+}
+
+
+//------------------------------------------------------------------------------
+// _FltNeg fnumA = -fnumA
+//------------------------------------------------------------------------------
+static void _FltNeg(void)
+{
+  t1 = fnumA;
+  if( Z ) return;                             // Z is always clear coming from the dispatcher
+  fnumA ^= Bit31;
+}
+
+
+//------------------------------------------------------------------------------
+// _FltAbs fnumA = Abs(fnumA)
+//------------------------------------------------------------------------------
+static void _FltAbs(void)
+{
+  t1 = fnumA;
+  fnumA &= NaN;
+}
+
+
+//------------------------------------------------------------------------------
+// input:   fnumA        32-bit floating point value
+// output:  flagA        fnumA flag bits (Nan, Infinity, Zero, Sign)
+//          expA         fnumA exponent (no bias)
+//          manA         fnumA mantissa (aligned to bit 29)
+//          C flag       set if fnumA is NaN
+//          Z flag       set if fnumA is zero
+//------------------------------------------------------------------------------
+static void _Unpack(void)
+{
+  flagA = fnumA >> 31;                        // get sign
+  manA = fnumA & Mask23;                      // get mantissa
+  expA = (fnumA << 1) >> 24;                  // get exponent
+
+  if( expA == 0 ) {                           // zero or subnormal
+    if( (manA | expA) == 0 ) {
+      flagA |= ZeroFlag;
+      expA = Neg(150);
+      goto exit2;
+    }
+    manA <<= 7;                               // fix justification for subnormals
+    while( (manA & Bit29) == 0 ) {
+      manA <<= 1;
+      expA -= 1;
+    }
+  }
+  else if( expA == 255 ) {                    // not finite, so return NaN
+    fnumA = NaN;
+    flagA = NaNFlag;
+    goto exit2;
+  }
+  else {
+    manA <<= 6;                               // justify mantissa to bit 29
+    manA |= Bit29;                            // add leading one bit
+  }
+  expA -= 127;                                // remove bias from exponent
+
+exit2:
+  C = (flagA & NaNFlag) != 0;
+  Z = (manA == 0);
+}
+
+
+//------------------------------------------------------------------------------
+// input:   flagA        fnumA flag bits (Nan, Infinity, Zero, Sign)
+//          expA         fnumA exponent (no bias)
+//          manA         fnumA mantissa (aligned to bit 29)
+// output:  fnumA        32-bit floating point value
+//------------------------------------------------------------------------------
+static void _Pack(void)
+{
+  Z = (manA == 0);
+  if( Z ) expA = 0;                           // zero
+  else {
+    expA -= 380;                              // take us out of the danger range for djnz
+    for(;;) {                                 // normalize the mantissa
+      C = (manA & Bit31) != 0;
+      manA <<= 1;
+      if( C ) break;
+      if( --expA == 0 ) break;
+    }
+
+    u32 prev = manA;
+    manA += 0x100;                            // round up by 1/2 lsb
+    C = (manA < prev);
+
+    expA += 380 + 127 + 2 + (C ? 1 : 0);      // add bias to exponent, account for rounding
+    if( (int32_t)expA < (int32_t)Minus23 ) expA = Minus23;
+    if( (int32_t)expA > 255 ) expA = 255;
+
+    C = (expA & Bit31) != 0;                  // check for subnormals
+    expA = Abs(expA);
+    Z = (expA == 0);
+    if( C || Z ) {
+      manA |= 1;                              // adjust mantissa
+      manA = Ror( manA, 1 );
+      manA = Shr( manA, expA );
+      expA = 0;                               // biased exponent = 0
+    }
+  }
+
+  fnumA = manA >> 9;                          // bits 22:0 mantissa
+  fnumA = (fnumA & 0x007FFFFF) | ((expA & 0x1FF) << 23);   // bits 23:30 exponent
+  flagA <<= 31;
+  fnumA |= flagA;                             // bit 31 sign
+}
+
+
+//------------------------------------------------------------------------------
+// Command dispatch - index matches cmdCallTable / F32_op* values
+//------------------------------------------------------------------------------
+typedef void (*F32_FUNC)(void);
+
+static void _Nop(void) { }
+
+static const F32_FUNC cmdCallTable[] = {
+  _Nop,             // cmdNOP
+  _FAdd,            // cmdFAdd
+  _FSub,            // cmdFSub
+  _FMul,            // cmdFMul
+  _FDiv,            // cmdFDiv
+  _FFloat,          // cmdFFloat
+  _FTruncRound,     // cmdFTruncRound
+  _FSqrt,           // cmdFSqrt
+  _FCmp,            // cmdFCmp
+  _Sin,             // cmdFSin
+  _Cos,             // cmdFCos
+  _Nop,             // cmdFTan   (removed from the cog)
+  _Log2,            // cmdFLog2
+  _Exp2,            // cmdFExp2
+  _Nop,             // cmdFPow   (removed from the cog)
+  _ASinCos,         // cmdASinCos
+  _ATan2,           // cmdATan2
+  _Shift,           // cmdShift
+  _FltNeg,          // cmdNeg
+  _SinCos,          // cmdSinCos
+  _FltAbs,          // cmdFAbs
+  _FMin,            // cmdFMin
+  _Nop,             // cmdFrac   (removed from the cog)
+  _CNeg,            // cmdCNeg
+  _Nop,             // cmdMov
+  0,                // cmdRunCommandStream (handled by F32::RunStream)
+  _FMA,             // cmdFMA
+  _Dot3,            // cmdDot3
+  _Dot4,            // cmdDot4
+  _RSqrt,           // cmdRSqrt
+  0,                // cmdRunQueue (handled by F32::RunStream)
+};
+
+static const int cmdCallTableSize = sizeof(cmdCallTable) / sizeof(cmdCallTable[0]);
+
+
+static void Execute( int op )
+{
+  Z = false;                                  // the dispatcher always arrives with Z clear (non-zero command)
+  if( op > 0 && op < cmdCallTableSize && cmdCallTable[op] )
+    cmdCallTable[op]();
+}
+
+
+static void _RunCommandStream( const unsigned char * cmdAddr, u32 * varBase )
+{
+  while( cmdAddr[0] != 0 )
+  {
+    int op = cmdAddr[0] >> 2;                 // stream ops are pre-shifted by QuatIMU_AdjustStreamPointers
+
+    u32 * aAddr = varBase + cmdAddr[1];
+    u32 * bAddr = varBase + cmdAddr[2];
+
+    fnumA = *aAddr;
+    fnumB = *bAddr;
+    AAddr = aAddr;
+    BAddr = bAddr;
+    OutAddr = varBase + cmdAddr[3];
+
+    Execute( op );
+
+    varBase[ cmdAddr[3] ] = fnumA;            // store the result
+    cmdAddr += 4;
+  }
+  AAddr = BAddr = OutAddr = 0;
+}
+
+
+unsigned int F32_Host_Op( int op, unsigned int a, unsigned int b, unsigned int * pSinOut )
+{
+  if( !RomLoaded ) GenerateRom();
+
+  fnumA = a;
+  fnumB = b;
+  BAddr = pSinOut;
+  Execute( op );
+  BAddr = 0;
+  return fnumA;
+}
+
+
+//------------------------------------------------------------------------------
+// F32 API - streams run to completion inside RunStream, so there is never anything to wait for
+//------------------------------------------------------------------------------
+
+static int StreamSeq;
+
+int F32::Start(void)
+{
+  if( !RomLoaded ) GenerateRom();
+  return 1;
+}
+
+void F32::Stop(void)
+{
+}
+
+int F32::RunStream( unsigned char * a , float * b )
+{
+  if( !RomLoaded ) GenerateRom();
+  _RunCommandStream( a, (u32 *)b );
+  return ++StreamSeq;
+}
+
+void F32::WaitStream(void)
+{
+}
+
+void F32::WaitStream( int )
+{
+}
+
+bool F32::StreamDone( int )
+{
+  return true;
+}
+
+float F32::FFloat( int n )
+{
+  union { u32 i; float f; } r;
+  r.i = F32_Host_Op( F32_opFloat, (u32)n, 0 );
+  return r.f;
+}
+
+float F32::FDiv( float a, float b )
+{
+  union { u32 i; float f; } ua, ub, r;
+  ua.f = a;
+  ub.f = b;
+  r.i = F32_Host_Op( F32_opDiv, ua.i, ub.i );
+  return r.f;
+}
@@ -0,0 +1,31 @@
+#ifndef __F32_HOST_H__
+#define __F32_HOST_H__
+
+/*
+  Elev8 Flight Controller
+
+  F32 - Concise floating point code for the Propeller
+
+  Copyright (c) 2011 Jonathan "lonesock" Dummer
+  Ported to C++, modified for stream processing, and new instructions added by Jason Dorie
+
+  C++ API Copyright 2015 Parallax Inc
+
+  Released under the MIT License (see the end of f32_driver.spin for details)
+*/
+
+// Host (PC) only additions to the F32 API.  f32_host.cpp implements the normal F32 class from f32.h
+// by emulating f32_driver.spin instruction for instruction, so streams run synchronously on the PC
+// and produce the same bits the cog would.
+
+
+// Execute a single F32_op on raw 32 bit values, exactly as a one-entry command stream would.
+// For F32_opSinCos the sine result is written to *pSinOut (if non-null), and the cosine is returned.
+unsigned int F32_Host_Op( int op, unsigned int a, unsigned int b, unsigned int * pSinOut = 0 );
+
+// The log, anti-log, and sine tables normally come from the Propeller ROM ($C000 - $F001).
+// F32::Start() generates them from the formulas in the Propeller manual.  For bit-exact table
+// contents, load a 32kb dump of the ROM ($8000 - $FFFF) here instead.  Returns non-zero on success.
+int F32_Host_LoadRom( const char * filename );
+
+#endif
@@ -0,0 +1,327 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Replays recorded sensor and radio frames through the actual flight code - elev8-main.cpp (Initialize,
+// DoFlightUpdate, UpdateFlightLoop, the scheduled tasks, the PIDs), biquad.cpp, mixer.cpp, prefs.cpp, sched.cpp,
+// and quatimu.cpp on the emulated F32 cog (or quatimu_fixed.cpp) - and prints what the estimator, PIDs, and motors
+// did on every frame.  Nothing waits on the clock, so a long log replays as fast as the PC can run it.
+//
+//   flight_replay [-eeprom file] [-q] [-o out.bin] [-blackbox log.bin] < frames.bin
+//   flight_replay [-eeprom file] [-q] [-o out.bin] [-blackbox log.bin] -text < frames.txt
+//
+// frames.bin is a run of frames, each one a SENS struct (as the Sensors cog writes it, 32 bit longs)
+// followed by a RADIO struct (the normalized channels, 16 bit each), little endian, no padding.
+//
+// -text reads frames in the form imu_run takes, one per line, with the radio channels extended:
+//   gx gy gz ax ay az mx my mz alt altRate [thro aile elev rudd gear aux1 aux2 aux3]
+// Each line is one gyro reading, so the gyro sums just count them up.  -o writes the frames that were
+// read back out in binary form, to turn a text file into a binary one.
+//
+// -eeprom loads a 64kb EEPROM dump, so the prefs are read from it the same way the firmware reads them.
+// Without one the EEPROM is blank, the checksum fails, and the defaults from prefs.cpp are used.
+//
+// The first frame is also what the firmware sees at power up, so the gyro zero and starting altitude come
+// from it.  After that, the gyro zero follows the frames while disarmed, the same as on the craft.  Things that aren't recorded are
+// stubbed: the battery always reads 12.00v, the serial ports never receive anything, and motor, LED, and
+// beeper output goes nowhere.  The comms cog never starts - the telemetry snapshot is still published
+// every frame, but nothing reads it, and no commands arrive.
+//
+// Each output line is:
+//   frame armed mode  pitchDiff rollDiff yawDiff altiEst ascentEst  rollPID pitchPID yawPID altPID ascentPID  FL FR BR BL
+//
+// -q skips the per-frame output, and just reports how long the replay took against real time.
+//
+// -blackbox writes what the blackbox logger would have sent to serial port 3, for host/blackbox_decode.cpp.
+// Build with -DENABLE_LOGGING to use it.  The logger is run on every published snapshot, the way the comms
+// cog does it, and the port never fills up, so no frames are dropped.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <propeller.h>
+
+
+// The firmware is built with 32 bit longs.  Match that, so SENS lines up with the recorded frames,
+// and the flight code overflows and truncates the way it does on the Propeller.
+#define long int
+
+// Initialize() hands the Sensors cog the LED array as a hub address in an int, which a PC pointer doesn't
+// fit in.  There's no Sensors cog to start here anyway, so the call is dropped.
+#include "sensors.h"
+#define Sensors_Start(...)  ((void)0)
+
+// elev8-main.cpp has its own static abs(), which would clash with the C library, so it's renamed as
+// it's pulled in.  The firmware main() is renamed too - it never runs here, the frames are fed to
+// DoFlightUpdate() instead.
+#define abs   Elev8_abs
+#define main  Elev8_main
+#include "elev8-main.cpp"
+#undef main
+#undef abs
+
+#include "biquad.cpp"
+#include "mixer.cpp"
+#include "prefs.cpp"
+#include "commlink.cpp"
+#include "comms.cpp"
+#include "sched.cpp"
+#include "blackbox.cpp"
+
+
+//-----------------------------------------------------------------------------------------------
+// Stubs for the drivers - the sensor and radio "cogs" just hold the current frame
+
+static SENS  ReplaySens;
+static RADIO ReplayRadio;
+
+void Sensors_Stop(void) {}
+
+int  Sensors_In(int channel) { return ((int*)&ReplaySens)[channel]; }
+int* Sensors_Address(void)   { return (int*)&ReplaySens; }
+
+int Sensors_GyroSum( int * dest )
+{
+  // Same as sensors.cpp, without the torn read check - the sums can't change under us here
+  static int GyroSumPrev[4];
+  int * sums = (int*)&ReplaySens.GyroSumX;
+
+  for( int i=0; i<3; i++ ) {
+    dest[i] = sums[i] - GyroSumPrev[i];
+  }
+  int count = sums[3] - GyroSumPrev[3];
+  memcpy( GyroSumPrev, sums, sizeof(GyroSumPrev) );
+  return count;
+}
+
+void Sensors_TempZeroDriftValues(void) {}
+void Sensors_ResetDriftValues(void) {}
+void Sensors_TempZeroAccelOffsetValues(void) {}
+void Sensors_ResetAccelOffsetValues(void) {}
+void Sensors_SetDriftValues( int * ) {}
+void Sensors_SetAccelOffsetValues( int * ) {}
+void Sensors_ZeroMagnetometerScaleOffsets(void) {}
+void Sensors_SetMagnetometerScaleOffsets( int * ) {}
+
+// The radio is recorded after normalization, so the channel map is ignored and it's passed straight through
+void RC::Start(char) {}
+void RC::Stop(void) {}
+int  RC::GetRC(int _pin) { return ReplayRadio.Channel(_pin); }
+void RC::SetChannelMap( const char *, const short *, const short * ) {}
+const short * RC::GetRadio(void) { return &ReplayRadio.Thro; }
+
+void  SBUS::Start( int, bool ) {}
+void  SBUS::Stop(void) {}
+short SBUS::GetRC( int i ) { return ReplayRadio.Channel(i); }
+void  SBUS::SetChannelMap( const char *, const short *, const short * ) {}
+const short * SBUS::GetRadio(void) { return &ReplayRadio.Thro; }
+
+void Servo32_Init( int ) {}
+void Servo32_AddFastPin(int) {}
+void Servo32_SetPingPin(int) {}
+void Servo32_Start(void) {}
+void Servo32_Set(int, int) {}
+int  Servo32_GetPing(void) { return 0; }
+
+void Battery::Init( int ) {}
+void Battery::DischargePin(void) {}
+void Battery::ChargePin(void) {}
+int  Battery::ReadResult(void) { return 0; }
+int  Battery::ComputeVoltage( int ) { return 1200; }
+
+void BeepHz( int, int ) {}
+void BeepTune(void) {}
+void Beep(void) {}
+void Beep2(void) {}
+void Beep3(void) {}
+void BeepOn(int, int, int) {}
+void BeepOff(int) {}
+void BeepQueue( int, int ) {}
+void Beep_Tick(void) {}
+int  Beep_Playing(void) { return 0; }
+
+void S4_Initialize(void) {}
+void S4_Define_Port(char, int, char, char *, int, char, char *, int) {}
+void S4_Start(void) {}
+void S4_Put(char, char) {}
+void S4_Put_Bytes(char, void *, int) {}
+static char S4_Scratch[256];
+int  S4_Reserve(char, int The_Count, S4_SPAN * The_Span) {
+  if( The_Count > (int)sizeof(S4_Scratch) ) The_Count = sizeof(S4_Scratch);
+  The_Span->Ptr[0] = The_Span->Ptr[1] = S4_Scratch;
+  The_Span->Count[0] = The_Count;  The_Span->Count[1] = 0;
+  return The_Count;
+}
+void S4_Commit(char, int) {}
+static FILE * BlackboxOut;
+char S4_Try_Put_Bytes(char The_Port, void * The_Bytes, int The_Count) {
+  if( The_Port == 3 && BlackboxOut ) fwrite( The_Bytes, 1, The_Count, BlackboxOut );
+  return 1;
+}
+char S4_Try_Reserve(char The_Port, int The_Count, S4_SPAN * The_Span) { return S4_Reserve( The_Port, The_Count, The_Span ) == The_Count; }
+int  S4_Tx_Dropped(char) { return 0; }
+int  S4_Rx_Overruns(char) { return 0; }
+int  S4_Rx_Framing(char) { return 0; }
+int  S4_Check(char) { return -1; }
+char S4_Get(char) { return 0; }
+int  S4_Get_Timed(char, int) { return -1; }
+
+static unsigned char EEPROMImage[65536];
+
+void EEPROM::ToRam(void * startAddr, void * endAddr, int eeStart)   { memcpy( startAddr, EEPROMImage + eeStart, (char*)endAddr - (char*)startAddr + 1 ); }
+void EEPROM::FromRam(void * startAddr, void * endAddr, int eeStart) { memcpy( EEPROMImage + eeStart, startAddr, (char*)endAddr - (char*)startAddr + 1 ); }
+int  EEPROM::Ready(void) { return 1; }
+
+#undef long
+
+
+//-----------------------------------------------------------------------------------------------
+
+static const int FrameSize = sizeof(SENS) + sizeof(RADIO);
+
+static bool ReadFrame( FILE * f, bool text )
+{
+  if( !text ) {
+    char buf[FrameSize];
+    if( fread( buf, 1, FrameSize, f ) != FrameSize ) return false;
+    memcpy( &ReplaySens, buf, sizeof(SENS) );
+    memcpy( &ReplayRadio, buf + sizeof(SENS), sizeof(RADIO) );
+    return true;
+  }
+
+  char line[512];
+  while( fgets( line, sizeof(line), f ) )
+  {
+    int v[20];
+    int n = 0;
+    char * p = line;
+    char * end;
+    while( n < 20 ) {
+      long x = strtol( p, &end, 10 );
+      if( end == p ) break;
+      v[n++] = (int)x;
+      p = end;
+    }
+    if( n < 11 ) continue;    // blank or comment line
+
+    ReplaySens.GyroX = v[0];   ReplaySens.GyroY = v[1];   ReplaySens.GyroZ = v[2];
+    ReplaySens.AccelX = v[3];  ReplaySens.AccelY = v[4];  ReplaySens.AccelZ = v[5];
+    ReplaySens.MagX = v[6];    ReplaySens.MagY = v[7];    ReplaySens.MagZ = v[8];
+    ReplaySens.Alt = v[9];     ReplaySens.AltRate = v[10];
+
+    ReplaySens.GyroSumX += v[0];
+    ReplaySens.GyroSumY += v[1];
+    ReplaySens.GyroSumZ += v[2];
+    ReplaySens.GyroSamples++;
+
+    for( int i=0; i<9; i++ ) {
+      ReplayRadio.Channel(i) = (11+i < n) ? v[11+i] : 0;
+    }
+    return true;
+  }
+  return false;
+}
+
+
+int main( int argc, char ** argv )
+{
+  bool text = false, quiet = false;
+  FILE * out = 0;
+
+  for( int i=1; i<argc; i++ )
+  {
+    if( strcmp( argv[i], "-text" ) == 0 ) {
+      text = true;
+    }
+    else if( strcmp( argv[i], "-q" ) == 0 ) {
+      quiet = true;
+    }
+    else if( strcmp( argv[i], "-o" ) == 0 && i+1 < argc ) {
+      out = fopen( argv[++i], "wb" );
+      if( !out ) { fprintf( stderr, "can't write %s\n", argv[i] ); return 1; }
+    }
+    else if( strcmp( argv[i], "-blackbox" ) == 0 && i+1 < argc ) {
+#ifdef ENABLE_LOGGING
+      BlackboxOut = fopen( argv[++i], "wb" );
+      if( !BlackboxOut ) { fprintf( stderr, "can't write %s\n", argv[i] ); return 1; }
+#else
+      fprintf( stderr, "-blackbox needs a build with -DENABLE_LOGGING\n" );
+      return 1;
+#endif
+    }
+    else if( strcmp( argv[i], "-eeprom" ) == 0 && i+1 < argc ) {
+      FILE * f = fopen( argv[++i], "rb" );
+      if( !f || fread( EEPROMImage, 1, sizeof(EEPROMImage), f ) != sizeof(EEPROMImage) ) {
+        fprintf( stderr, "can't read a 64kb EEPROM image from %s\n", argv[i] );
+        return 1;
+      }
+      fclose( f );
+    }
+    else {
+      fprintf( stderr, "usage: flight_replay [-eeprom file] [-q] [-o out.bin] [-blackbox log.bin] [-text] < frames\n" );
+      return 1;
+    }
+  }
+
+  if( !ReadFrame( stdin, text ) ) {
+    fprintf( stderr, "no frames\n" );
+    return 1;
+  }
+
+  Initialize();
+
+  clock_t start = clock();
+  int frames = 0;
+
+  do {
+    if( out ) {
+      fwrite( &ReplaySens, sizeof(SENS), 1, out );
+      fwrite( &ReplayRadio, sizeof(RADIO), 1, out );
+    }
+
+    DoFlightUpdate();
+    PublishTelemetry();
+#ifdef ENABLE_LOGGING
+    Blackbox_Write( 3, &Snapshot[PublishSeq & 1].Log, MotorCount, FlightEnabled );
+#endif
+    CheckDebugInput();
+    Sched_Run( Tasks, TaskCount, counter );
+    ++counter;
+
+    if( !quiet ) {
+      printf( "%d %d %d  %d %d %d %d %d  %d %d %d %d %d  %d %d %d %d\n", frames, FlightEnabled, FlightMode,
+              PitchDifference, RollDifference, YawDifference, AltiEst, AscentEst,
+              RollPID.Output, PitchPID.Output, YawPID.Output, AltPID.Output, AscentPID.Output,
+              Motor[OUT_FL], Motor[OUT_FR], Motor[OUT_BR], Motor[OUT_BL] );
+    }
+    frames++;
+  } while( ReadFrame( stdin, text ) );
+
+  double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+  double flown = (double)frames / Const_UpdateRate;
+
+  if( out ) fclose( out );
+  if( BlackboxOut ) fclose( BlackboxOut );
+
+  fprintf( stderr, "%d frames (%.1f sec of flight) in %.2f sec, %.0fx real time\n", frames, flown, secs, secs > 0.0 ? flown / secs : 0.0 );
+  return 0;
+}
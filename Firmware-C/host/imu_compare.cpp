@@ -0,0 +1,456 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Runs the float IMU (quatimu.cpp on the emulated F32 cog) and the fixed point IMU (quatimu_fixed.cpp)
+// side by side on the same frames, along with the same math done in doubles, and checks that the fixed
+// point outputs are as close to the double results as the float ones are (or within a set tolerance).
+//
+//   imu_compare [-manual] [-v] < frames.txt      frames in the same form imu_run reads
+//   imu_compare [-manual] [-v] -synth count      generated frames - the craft swings around while the sticks move,
+//                                                with the gyro read 3 or 4 times per update and summed
+//
+// The F32 math isn't exact either - it rounds differently - so over a long run the float orientation
+// wanders off by itself, mostly in yaw, which nothing corrects.  That's why both are measured against the
+// double version, rather than just against each other.
+//
+// Prints the largest error seen for each output and returns non-zero if the fixed point one fails.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <propeller.h>
+#include "constants.h"
+#include "f32.h"
+#include "quatimu.h"
+
+
+// The fixed point version defines the same QuatIMU_ functions, so it's pulled in here, in its own namespace,
+// instead of being linked.  Every header it uses has already been included above.
+#define QUATIMU_FIXED
+namespace Fixed {
+#include "quatimu_fixed.cpp"
+}
+
+
+// The QuatUpdateCommands and UpdateControls streams from quatimu.cpp, in doubles
+namespace Exact {
+
+  static double qx, qy, qz, qw = 1.0;
+  static double m[3][3];
+  static double errCorrX, errCorrY, errCorrZ;
+  static double prx, pry, prz;
+  static double HalfYaw, Heading;
+  static double cqx, cqy, cqz, cqw;
+  static double qrw;
+  static double velocityEstimate, altitudeEstimate;
+  static double ErrScale, AutoBankScale, YawRateScale, ManualBankScale, ManualYawScale;
+  static int    Pitch, Roll, ThrustFactor, PitchDiff, RollDiff, YawDiff;
+
+  static int Round( double v ) { return (int)floor( v + 0.5 ); }
+
+  static void Normalize( double & w, double & x, double & y, double & z )
+  {
+    double r = 1.0 / sqrt( w*w + x*x + y*y + z*z );
+    w *= r;  x *= r;  y *= r;  z *= r;
+  }
+
+  static void Update( int * s, int * gyroSum, int gyroSamples )
+  {
+    const double GyroUnits = (1000.0 / 70.0) * (180.0 / M_PI) * Const_UpdateRate * gyroSamples;
+    double rx =  gyroSum[0] / GyroUnits;
+    double ry = -gyroSum[2] / GyroUnits;
+    double rz = -gyroSum[1] / GyroUnits;
+
+    double conex = pry*rz - prz*ry, coney = prz*rx - prx*rz, conez = prx*ry - pry*rx;
+    prx = rx / 12.0;  pry = ry / 12.0;  prz = rz / 12.0;
+
+    rx += conex + errCorrX;
+    ry += coney + errCorrY;
+    rz += conez + errCorrZ;
+
+    double rmag = sqrt( rx*rx + ry*ry + rz*rz + 1e-20 ) * 0.5;
+    double cosr = cos( rmag ), sinr = sin( rmag ) / rmag;
+
+    double qdw = -(rx*qx + ry*qy + rz*qz) * 0.5;
+    double qdx =  (rx*qw + rz*qy - ry*qz) * 0.5;
+    double qdy =  (ry*qw - rz*qx + rx*qz) * 0.5;
+    double qdz =  (rz*qw + ry*qx - rx*qy) * 0.5;
+
+    qw = cosr*qw + sinr*qdw;
+    qx = cosr*qx + sinr*qdx;
+    qy = cosr*qy + sinr*qdy;
+    qz = cosr*qz + sinr*qdz;
+    Normalize( qw, qx, qy, qz );
+
+    m[0][0] = 1.0 - 2.0*(qy*qy + qz*qz);  m[0][1] = 2.0*(qx*qy - qw*qz);        m[0][2] = 2.0*(qx*qz + qw*qy);
+    m[1][0] = 2.0*(qx*qy + qw*qz);        m[1][1] = 1.0 - 2.0*(qx*qx + qz*qz);  m[1][2] = 2.0*(qy*qz - qw*qx);
+    m[2][0] = 2.0*(qx*qz - qw*qy);        m[2][1] = 2.0*(qy*qz + qw*qx);        m[2][2] = 1.0 - 2.0*(qx*qx + qy*qy);
+
+    double fax = -s[3] / (double)Const_OneG, fay = s[5] / (double)Const_OneG, faz = s[4] / (double)Const_OneG;
+    double len = sqrt( fax*fax + fay*fay + faz*faz );
+    double accWeight = (1.0 - fmin( fabs( 2.0 - len * 2.0 ), 1.0 )) * ErrScale;
+    double temp = len > 0.0 ? accWeight / len : 0.0;
+
+    errCorrX = (fay*m[1][2] - faz*m[1][1]) * temp;
+    errCorrY = (faz*m[1][0] - fax*m[1][2]) * temp;
+    errCorrZ = (fax*m[1][1] - fay*m[1][0]) * temp;
+
+    HalfYaw = -atan2( m[2][0], m[2][2] ) * 0.5;
+    Pitch = Round(  asin( m[1][2] ) * 65536.0 / M_PI );
+    Roll  = Round( -asin( m[1][0] ) * 65536.0 / M_PI );
+    ThrustFactor = Round( fmax( fmin( 256.0 / m[1][1], 16384.0 ), -16384.0 ) );
+
+    double forceWY = fax*m[1][0] + fay*m[1][1] + faz*m[1][2] - 1.0;
+    velocityEstimate += forceWY * 9806.65 / Const_UpdateRate;
+    velocityEstimate = velocityEstimate * 0.9995 + s[10] * 0.0005;
+    altitudeEstimate += velocityEstimate / Const_UpdateRate;
+    altitudeEstimate = altitudeEstimate * 0.9993 + s[9] * 0.0007;
+  }
+
+  static int Deadband( int v, int db ) { return v > db ? v - db : (v < -db ? v + db : 0); }
+
+  static void UpdateControls( RADIO * Radio, bool ManualMode )
+  {
+    int In_Elev = Deadband( Radio->Elev, 24 ), In_Aile = Deadband( Radio->Aile, 24 ), In_Rudd = Deadband( Radio->Rudd, 24 );
+
+    if( ManualMode ) {
+      double rx = In_Elev * ManualBankScale, rz = -In_Aile * ManualBankScale, ry = In_Rudd * ManualYawScale;
+      double qrx =  cqy*rz - cqz*ry + cqw*rx;
+      double qry = -cqx*rz + cqz*rx + cqw*ry;
+      double qrz =  cqx*ry - cqy*rx + cqw*rz;
+      double qrw = -cqx*rx - cqy*ry - cqz*rz;
+      cqw += qrw;  cqx += qrx;  cqy += qry;  cqz += qrz;
+      Normalize( cqw, cqx, cqy, cqz );
+    }
+    else {
+      double rx = In_Elev * AutoBankScale, rz = -In_Aile * AutoBankScale;
+      Heading = remainder( Heading + In_Rudd * YawRateScale, 2.0 * M_PI );
+
+      double csx = cos(rx), snx = sin(rx), csy = cos(Heading), sny = sin(Heading), csz = cos(rz), snz = sin(rz);
+      cqx = sny*csx*snz + csy*csz*snx;
+      cqy = sny*csx*csz + csy*snz*snx;
+      cqz = csy*snz*csx - sny*snx*csz;
+      cqw = csy*csz*csx - sny*snx*snz;
+    }
+
+    double qrx = -cqx*qw - cqy*qz + cqz*qy + cqw*qx;
+    double qry =  cqx*qz - cqy*qw - cqz*qx + cqw*qy;
+    double qrz = -cqx*qy + cqy*qx - cqz*qw + cqw*qz;
+    qrw =  cqx*qx + cqy*qy + cqz*qz + cqw*qw;
+    if( qrw < 0.0 ) {
+      qrw = -qrw;  qrx = -qrx;  qry = -qry;  qrz = -qrz;
+    }
+    qrw = fmin( qrw, 1.0 );
+
+    double diffAngle = 2.0 * acos( qrw );
+    double scale = diffAngle / (sqrt( 1.0 - qrw*qrw ) + 1e-8) * 4096.0;
+    PitchDiff = Round( qrx * scale );
+    RollDiff  = Round( qrz * scale );
+    YawDiff   = Round( qry * scale );
+  }
+}
+
+
+enum {
+  Out_Q, Out_CQ, Out_PitchDiff, Out_RollDiff, Out_YawDiff,
+  Out_Pitch, Out_Roll, Out_Thrust, Out_Alt, Out_Vel,
+  Out_Count
+};
+
+struct OUTPUT {
+  const char * name;
+  double tolerance;                // the fixed point error is allowed to reach this even if the float one doesn't
+};
+
+static const OUTPUT Outputs[Out_Count] = {
+  { "Quaternion",    0.0001 },     // largest component difference
+  { "DesiredQ",      0.0001 },
+  { "PitchDiff",     4 },          // control outputs, 4096 per radian
+  { "RollDiff",      4 },
+  { "YawDiff",       4 },
+  { "Pitch",         2 },          // 65536 per PI
+  { "Roll",          2 },
+  { "ThrustFactor",  1 },          // 256 == level, limited to +/- 16384 (F32 gives infinity at 90 degrees)
+  { "AltitudeEst",   1 },          // mm
+  { "VelocityEst",   1 },          // mm/sec
+};
+
+// The largest difference seen in each output
+struct ERRORS {
+  double fixedVsFloat, floatErr, fixedErr;
+};
+
+static ERRORS Errors[Out_Count];
+
+static int SkippedFrames;
+
+
+// One set of outputs
+struct RESULT {
+  float  q[4], cq[4];
+  double v[Out_Count];
+};
+
+static void Check( int out, const RESULT & flt, const RESULT & fix, const RESULT & ex )
+{
+  ERRORS & o = Errors[out];
+  o.fixedVsFloat = fmax( o.fixedVsFloat, fabs( fix.v[out] - flt.v[out] ) );
+  o.floatErr = fmax( o.floatErr, fabs( flt.v[out] - ex.v[out] ) );
+  o.fixedErr = fmax( o.fixedErr, fabs( fix.v[out] - ex.v[out] ) );
+}
+
+// q and -q are the same orientation, so compare against whichever sign is closer
+static double QuatDiff( const float * a, const float * b )
+{
+  double sign = (a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3]) < 0.0 ? -1.0 : 1.0;
+  double d = 0.0;
+  for( int i=0; i<4; i++ )
+    d = fmax( d, fabs( a[i] - sign * b[i] ) );
+  return d;
+}
+
+static void CheckQuat( int out, const float * flt, const float * fix, const float * ex )
+{
+  ERRORS & o = Errors[out];
+  o.fixedVsFloat = fmax( o.fixedVsFloat, QuatDiff( fix, flt ) );
+  o.floatErr = fmax( o.floatErr, QuatDiff( flt, ex ) );
+  o.fixedErr = fmax( o.fixedErr, QuatDiff( fix, ex ) );
+}
+
+
+static void RunFrame( int * sensors, int * gyroSum, int gyroSamples, RADIO * radio, bool ManualMode, int frame, bool verbose )
+{
+  RESULT flt, fix, ex;
+
+  QuatIMU_Update( sensors, gyroSum, gyroSamples );
+  QuatIMU_UpdateControls( radio, ManualMode, false );
+  QuatIMU_WaitForCompletion();
+
+  memcpy( flt.q, QuatIMU_GetQuaternion(), sizeof(flt.q) );
+  QuatIMU_GetDesiredQ( flt.cq );
+  flt.v[Out_PitchDiff] = QuatIMU_GetPitchDifference();
+  flt.v[Out_RollDiff]  = QuatIMU_GetRollDifference();
+  flt.v[Out_YawDiff]   = QuatIMU_GetYawDifference();
+  flt.v[Out_Pitch]     = QuatIMU_GetPitch();
+  flt.v[Out_Roll]      = QuatIMU_GetRoll();
+  flt.v[Out_Thrust]    = fmax( fmin( QuatIMU_GetThrustFactor(), 16384 ), -16384 );
+  flt.v[Out_Alt]       = QuatIMU_GetAltitudeEstimate();
+  flt.v[Out_Vel]       = QuatIMU_GetVerticalVelocityEstimate();
+
+  Fixed::QuatIMU_Update( sensors, gyroSum, gyroSamples );
+  Fixed::QuatIMU_UpdateControls( radio, ManualMode, false );
+
+  memcpy( fix.q, Fixed::QuatIMU_GetQuaternion(), sizeof(fix.q) );
+  Fixed::QuatIMU_GetDesiredQ( fix.cq );
+  fix.v[Out_PitchDiff] = Fixed::QuatIMU_GetPitchDifference();
+  fix.v[Out_RollDiff]  = Fixed::QuatIMU_GetRollDifference();
+  fix.v[Out_YawDiff]   = Fixed::QuatIMU_GetYawDifference();
+  fix.v[Out_Pitch]     = Fixed::QuatIMU_GetPitch();
+  fix.v[Out_Roll]      = Fixed::QuatIMU_GetRoll();
+  fix.v[Out_Thrust]    = Fixed::QuatIMU_GetThrustFactor();
+  fix.v[Out_Alt]       = Fixed::QuatIMU_GetAltitudeEstimate();
+  fix.v[Out_Vel]       = Fixed::QuatIMU_GetVerticalVelocityEstimate();
+
+  if( gyroSum )
+    Exact::Update( sensors, gyroSum, gyroSamples );
+  else
+    Exact::Update( sensors, sensors, 1 );
+  Exact::UpdateControls( radio, ManualMode );
+
+  float eq[4] = { (float)Exact::qx, (float)Exact::qy, (float)Exact::qz, (float)Exact::qw };
+  float ecq[4] = { (float)Exact::cqx, (float)Exact::cqy, (float)Exact::cqz, (float)Exact::cqw };
+  ex.v[Out_PitchDiff] = Exact::PitchDiff;
+  ex.v[Out_RollDiff]  = Exact::RollDiff;
+  ex.v[Out_YawDiff]   = Exact::YawDiff;
+  ex.v[Out_Pitch]     = Exact::Pitch;
+  ex.v[Out_Roll]      = Exact::Roll;
+  ex.v[Out_Thrust]    = Exact::ThrustFactor;
+  ex.v[Out_Alt]       = floor( Exact::altitudeEstimate + 0.5 );
+  ex.v[Out_Vel]       = floor( Exact::velocityEstimate + 0.5 );
+
+  CheckQuat( Out_Q, flt.q, fix.q, eq );
+  CheckQuat( Out_CQ, flt.cq, fix.cq, ecq );
+
+  // Near 180 degrees from the desired orientation, the short way around can flip sides between one
+  // version and the next, and the control outputs with it, so they're only compared away from there
+  if( Exact::qrw > 0.2 ) {
+    for( int i=Out_PitchDiff; i<=Out_YawDiff; i++ )
+      Check( i, flt, fix, ex );
+  }
+  else
+    SkippedFrames++;
+
+  for( int i=Out_Pitch; i<Out_Count; i++ )
+    Check( i, flt, fix, ex );
+
+  if( verbose ) {
+    printf( "%d  %.6f %.6f %.6f %.6f / %.6f %.6f %.6f %.6f  %d %d %d / %d %d %d\n", frame,
+            flt.q[0], flt.q[1], flt.q[2], flt.q[3], fix.q[0], fix.q[1], fix.q[2], fix.q[3],
+            (int)flt.v[Out_PitchDiff], (int)flt.v[Out_RollDiff], (int)flt.v[Out_YawDiff],
+            (int)fix.v[Out_PitchDiff], (int)fix.v[Out_RollDiff], (int)fix.v[Out_YawDiff] );
+  }
+}
+
+
+#define SynthGyroRate  952     // The gyro output rate the sensor cog is set up for - 3 or 4 readings per update
+
+static void SynthGyro( double t, int * g )
+{
+  g[0] = (int)( 400.0 * sin( t * 0.9 ) );
+  g[1] = (int)( 500.0 * sin( t * 1.3 + 1.0 ) );
+  g[2] = (int)( 600.0 * sin( t * 0.4 + 2.0 ) );
+}
+
+// One frame of a made-up flight: the body rates are slow sine waves that swing the craft through about
+// +/- 30 degrees of pitch and roll and +/- 100 of yaw, the accelerometer sees gravity tilted about as much
+// plus a little vibration, and the altimeter climbs and settles.  The gyro is read at SynthGyroRate, and
+// gyroSum gets every reading in the frame, like Sensors_GyroSum().  Returns the number of readings.
+static int SynthFrame( int i, int * s, int * gyroSum, RADIO * radio )
+{
+  double t = i / (double)Const_UpdateRate;
+
+  int first = (int)( (long long)i * SynthGyroRate / Const_UpdateRate ) + 1;
+  int last = (int)( (long long)(i+1) * SynthGyroRate / Const_UpdateRate );
+  gyroSum[0] = gyroSum[1] = gyroSum[2] = 0;
+  for( int r = first; r <= last; r++ ) {
+    SynthGyro( r / (double)SynthGyroRate, s );               // gyro x, y, z - the packet holds the last reading
+    gyroSum[0] += s[0];
+    gyroSum[1] += s[1];
+    gyroSum[2] += s[2];
+  }
+
+  double tiltX = 0.5 * cos( t * 0.9 ), tiltZ = 0.45 * cos( t * 1.3 + 1.0 );
+  s[3] = (int)( Const_OneG * sin( tiltX ) ) + (i % 7) - 3;      // accel x, y, z
+  s[4] = (int)( Const_OneG * sin( tiltZ ) ) + (i % 5) - 2;
+  s[5] = (int)( Const_OneG * cos( tiltX ) * cos( tiltZ ) ) + (i % 3) - 1;
+
+  s[6] = s[7] = s[8] = 0;                                       // mag (unused)
+
+  s[9]  = 100000 + (int)( 2000.0 * (1.0 - cos( t * 0.2 )) );   // alt, mm
+  s[10] = (int)( 400.0 * sin( t * 0.2 ) );                      // alt rate, mm/sec
+
+  memset( radio, 0, sizeof(RADIO) );
+  radio->Elev = (int)( 900.0 * sin( t * 0.7 ) );
+  radio->Aile = (int)( 700.0 * sin( t * 0.5 + 0.5 ) );
+  radio->Rudd = (int)( 100.0 * sin( t * 0.3 ) );
+  return last - first + 1;
+}
+
+
+int main( int argc, char ** argv )
+{
+  bool ManualMode = false;
+  bool verbose = false;
+  int synthCount = 0;
+
+  for( int i=1; i<argc; i++ )
+  {
+    if( strcmp(argv[i], "-manual") == 0 ) ManualMode = true;
+    else if( strcmp(argv[i], "-v") == 0 ) verbose = true;
+    else if( strcmp(argv[i], "-synth") == 0 && i+1 < argc ) synthCount = atoi( argv[++i] );
+    else {
+      fprintf( stderr, "usage: imu_compare [-manual] [-v] [-synth count]\n" );
+      return 1;
+    }
+  }
+
+  F32::Start();
+
+  // Use the same control rates in both, as InitializePrefs() does on the craft
+  float RollCorrect[2] = { 0.0f, 1.0f }, PitchCorrect[2] = { 0.0f, 1.0f };
+  float AutoBank = (35.0f / 1024.0f) * (3.141592654f / 180.0f) * 0.5f;
+  float AutoYaw = ((180.0f / Const_UpdateRate) / 1024.0f) * (3.141592654f / 180.0f) * 0.5f;
+  float ManualBank = ((120.0f / Const_UpdateRate) / 1024.0f) * (3.141592654f / 180.0f) * 0.5f;
+  float ManualYaw = ((180.0f / Const_UpdateRate) / 1024.0f) * (3.141592654f / 180.0f) * 0.5f;
+
+  Exact::ErrScale = 1.0 / 32.0;
+  Exact::AutoBankScale = AutoBank;
+  Exact::YawRateScale = AutoYaw;
+  Exact::ManualBankScale = ManualBank;
+  Exact::ManualYawScale = ManualYaw;
+  Exact::cqw = 1.0;
+
+  QuatIMU_Start();
+  QuatIMU_SetErrScaleMode(1);
+  QuatIMU_SetRollCorrection( RollCorrect );
+  QuatIMU_SetPitchCorrection( PitchCorrect );
+  QuatIMU_SetAutoLevelRates( AutoBank, AutoYaw );
+  QuatIMU_SetManualRates( ManualBank, ManualYaw );
+  QuatIMU_ResetDesiredOrientation();
+
+  Fixed::QuatIMU_Start();
+  Fixed::QuatIMU_SetErrScaleMode(1);
+  Fixed::QuatIMU_SetRollCorrection( RollCorrect );
+  Fixed::QuatIMU_SetPitchCorrection( PitchCorrect );
+  Fixed::QuatIMU_SetAutoLevelRates( AutoBank, AutoYaw );
+  Fixed::QuatIMU_SetManualRates( ManualBank, ManualYaw );
+  Fixed::QuatIMU_ResetDesiredOrientation();
+
+  int frame = 0;
+  int s[11], gyroSum[3];
+  RADIO radio;
+
+  if( synthCount > 0 ) {
+    QuatIMU_SetInitialAltitudeGuess( 100000 );
+    Fixed::QuatIMU_SetInitialAltitudeGuess( 100000 );
+    Exact::altitudeEstimate = 100000.0;
+
+    for( ; frame < synthCount; frame++ ) {
+      int count = SynthFrame( frame, s, gyroSum, &radio );
+      RunFrame( s, gyroSum, count, &radio, ManualMode, frame, verbose );
+    }
+  }
+  else {
+    char line[256];
+    while( fgets( line, sizeof(line), stdin ) )
+    {
+      int r[4] = { 0, 0, 0, 0 };
+      int count = sscanf( line, "%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d",
+                          &s[0], &s[1], &s[2], &s[3], &s[4], &s[5], &s[6], &s[7], &s[8], &s[9], &s[10],
+                          &r[0], &r[1], &r[2], &r[3] );
+      if( count < 11 ) continue;
+
+      memset( &radio, 0, sizeof(radio) );
+      radio.Thro = r[0];
+      radio.Aile = r[1];
+      radio.Elev = r[2];
+      radio.Rudd = r[3];
+
+      RunFrame( s, 0, 1, &radio, ManualMode, frame, verbose );
+      frame++;
+    }
+  }
+
+  int failed = 0;
+  printf( "%d frames, %s mode (control outputs skipped on %d frames near 180 degrees)\n\n", frame,
+          ManualMode ? "manual" : "auto-level", SkippedFrames );
+  printf( "                fixed-float  float error  fixed error  tolerance\n" );
+  for( int i=0; i<Out_Count; i++ ) {
+    const OUTPUT & o = Outputs[i];
+    const ERRORS & e = Errors[i];
+    bool ok = e.fixedErr <= fmax( e.floatErr, o.tolerance );
+    printf( "%-14s  %-11.4g  %-11.4g  %-11.4g  %-9g  %s\n", o.name, e.fixedVsFloat, e.floatErr, e.fixedErr,
+            o.tolerance, ok ? "ok" : "FAIL" );
+    if( !ok ) failed++;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Runs the QuatIMU command streams on a PC through the emulated F32 cog (f32_host.cpp).
+//
+//   imu_run [-rom file] [-manual] < frames.txt     one frame per line:
+//        gx gy gz ax ay az mx my mz alt altRate [thro aile elev rudd]
+//     prints the orientation quaternion, desired quaternion, and pitch/roll/yaw differences per frame
+//
+//   imu_run [-rom file] -bench count               times 'count' updates of a level, motionless frame
+//
+//   imu_run [-rom file] -ops                       compares each F32 op against the host math library
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <propeller.h>
+#include "constants.h"
+#include "f32.h"
+#include "f32_host.h"
+#include "quatimu.h"
+
+
+static void RunFrame( int * sensors, RADIO * radio, bool ManualMode )
+{
+  QuatIMU_Update( sensors, 0, 1 );
+  QuatIMU_WaitForCompletion();
+  QuatIMU_UpdateControls( radio, ManualMode, false );
+  QuatIMU_WaitForCompletion();
+}
+
+
+static int ReplayFrames( bool ManualMode )
+{
+  char line[256];
+  int frame = 0;
+
+  while( fgets( line, sizeof(line), stdin ) )
+  {
+    int s[11];
+    int r[4] = { 0, 0, 0, 0 };
+
+    int count = sscanf( line, "%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d",
+                        &s[0], &s[1], &s[2], &s[3], &s[4], &s[5], &s[6], &s[7], &s[8], &s[9], &s[10],
+                        &r[0], &r[1], &r[2], &r[3] );
+    if( count < 11 ) continue;
+
+    RADIO radio;
+    memset( &radio, 0, sizeof(radio) );
+    radio.Thro = r[0];
+    radio.Aile = r[1];
+    radio.Elev = r[2];
+    radio.Rudd = r[3];
+
+    RunFrame( s, &radio, ManualMode );
+
+    float * q = QuatIMU_GetQuaternion();
+    float cq[4];
+    QuatIMU_GetDesiredQ( cq );
+
+    printf( "%d  %.9g %.9g %.9g %.9g  %.9g %.9g %.9g %.9g  %d %d %d\n", frame,
+            q[0], q[1], q[2], q[3], cq[0], cq[1], cq[2], cq[3],
+            QuatIMU_GetPitchDifference(), QuatIMU_GetRollDifference(), QuatIMU_GetYawDifference() );
+    frame++;
+  }
+  return 0;
+}
+
+
+static int Benchmark( int count )
+{
+  int s[11] = { 0, 0, 0,  0, 0, Const_OneG,  0, 0, 0,  0, 0 };
+  RADIO radio;
+  memset( &radio, 0, sizeof(radio) );
+
+  clock_t start = clock();
+  for( int i=0; i<count; i++ ) {
+    s[0] = (i & 7) - 4;                       // a little gyro noise so the math isn't entirely static
+    RunFrame( s, &radio, false );
+  }
+  double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  float * q = QuatIMU_GetQuaternion();
+  printf( "%d updates in %.3f sec, %.0f updates/sec\n", count, secs, secs > 0 ? count / secs : 0.0 );
+  printf( "final q = %.9g %.9g %.9g %.9g\n", q[0], q[1], q[2], q[3] );
+  return 0;
+}
+
+
+static float AsFloat( unsigned int i ) { union { unsigned int i; float f; } u; u.i = i; return u.f; }
+static unsigned int AsInt( float f ) { union { unsigned int i; float f; } u; u.f = f; return u.i; }
+
+static int CheckOps(void)
+{
+  struct { const char * name; int op; double lo, hi; } ops[] = {
+    { "Add",  F32_opAdd,   -1000.0, 1000.0 },
+    { "Sub",  F32_opSub,   -1000.0, 1000.0 },
+    { "Mul",  F32_opMul,   -1000.0, 1000.0 },
+    { "Div",  F32_opDiv,   -1000.0, 1000.0 },
+    { "Sqrt", F32_opSqrt,      0.0, 1000.0 },
+    { "Sin",  F32_opSin,     -10.0,   10.0 },
+    { "Cos",  F32_opCos,     -10.0,   10.0 },
+    { "Log2", F32_opLog2,    0.001, 1000.0 },
+    { "Exp2", F32_opExp2,    -20.0,   20.0 },
+    { "ATan2",F32_opATan2,   -10.0,   10.0 },
+    { "ASin", F32_opASinCos,  -1.0,    1.0 },
+  };
+
+  srand(1);
+  for( unsigned i=0; i<sizeof(ops)/sizeof(ops[0]); i++ )
+  {
+    double maxErr = 0.0;
+    for( int n=0; n<100000; n++ )
+    {
+      float a = (float)(ops[i].lo + (ops[i].hi - ops[i].lo) * rand() / (double)RAND_MAX);
+      float b = (float)(ops[i].lo + (ops[i].hi - ops[i].lo) * rand() / (double)RAND_MAX);
+      unsigned int ib = AsInt(b);
+      double ref = 0.0;
+
+      switch( ops[i].op ) {
+        case F32_opAdd:  ref = (double)a + b; break;
+        case F32_opSub:  ref = (double)a - b; break;
+        case F32_opMul:  ref = (double)a * b; break;
+        case F32_opDiv:  ref = (double)a / b; break;
+        case F32_opSqrt: ref = sqrt(a); break;
+        case F32_opSin:  ref = sin(a); break;
+        case F32_opCos:  ref = cos(a); break;
+        case F32_opLog2: ref = log2(a); ib = 0; break;
+        case F32_opExp2: ref = exp2(a); ib = 0; break;
+        case F32_opATan2:ref = atan2(a, b); break;
+        case F32_opASinCos: ref = asin(a); ib = 1; break;
+      }
+
+      double r = AsFloat( F32_Host_Op( ops[i].op, AsInt(a), ib ) );
+      double err = fabs(r - ref) / (fabs(ref) > 1.0 ? fabs(ref) : 1.0);
+      if( err > maxErr ) maxErr = err;
+    }
+    printf( "%-6s max error %.3g\n", ops[i].name, maxErr );
+  }
+  return 0;
+}
+
+
+int main( int argc, char ** argv )
+{
+  bool ManualMode = false;
+  int benchCount = 0;
+  bool checkOps = false;
+
+  for( int i=1; i<argc; i++ )
+  {
+    if( strcmp(argv[i], "-rom") == 0 && i+1 < argc ) {
+      if( !F32_Host_LoadRom( argv[++i] ) ) {
+        fprintf( stderr, "unable to load ROM image %s\n", argv[i] );
+        return 1;
+      }
+    }
+    else if( strcmp(argv[i], "-manual") == 0 ) ManualMode = true;
+    else if( strcmp(argv[i], "-bench") == 0 && i+1 < argc ) benchCount = atoi( argv[++i] );
+    else if( strcmp(argv[i], "-ops") == 0 ) checkOps = true;
+    else {
+      fprintf( stderr, "usage: imu_run [-rom file] [-manual | -bench count | -ops]\n" );
+      return 1;
+    }
+  }
+
+  F32::Start();
+  if( checkOps ) return CheckOps();
+
+  QuatIMU_Start();
+  QuatIMU_SetErrScaleMode(1);
+  QuatIMU_ResetDesiredOrientation();              // start the control quaternion level, as arming does
+
+  if( benchCount > 0 ) return Benchmark( benchCount );
+  return ReplayFrames( ManualMode );
+}
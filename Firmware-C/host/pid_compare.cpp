@@ -0,0 +1,215 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Checks IntPIDT (the compile time version in intpid.h) against IntPID (intpid.cpp), and times the two.
+//
+//   pid_compare [-v]               runs every IntPIDT variant next to an IntPID set up the same way, on
+//                                  generated inputs, and compares Output, IError, DError and LastPError
+//                                  after every call.  Returns non-zero on any difference.
+//   pid_compare -bench count       times 'count' roll / pitch / yaw updates, set up the way the flight code
+//                                  does it - three IntPID::Calculate() calls against one CalculateAll()
+//
+// The timings are for the PC, so they only show which way a change goes, not what it's worth on the Propeller.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 32 bit longs, the same as the Propeller, so the math overflows the way it does on the cog
+#define long int
+
+#define abs   IntPID_abs
+#define clamp IntPID_clamp
+#include "intpid.cpp"
+#undef clamp
+#undef abs
+
+
+static unsigned int Seed = 12345;
+
+static int Rand( int range )   // -range to +range
+{
+  Seed = Seed * 1103515245 + 12345;
+  return (int)((Seed >> 8) % (unsigned)(range*2+1)) - range;
+}
+
+static int Verbose = 0;
+
+
+// One run: random gains and limits for the options the variant has, then a random walk of set point and
+// measurement, with the integrator switched on and off now and then.
+template<int Precision, bool UseI, bool UseDFilter, bool ClampP>
+static int CompareRun( int Run, int Steps )
+{
+  IntPID ref;
+  IntPIDT<Precision, UseI, UseDFilter, ClampP> pid;
+
+  int P = 400 + Rand(200);
+  int I = UseI ? (250 * (50 + Rand(49))) : 0;
+  int D = 250 * (500 + Rand(499));
+
+  ref.Init( P, I, D, 250 );
+  ref.SetPrecision( Precision );
+  pid.Init( P, I, D, 250 );
+
+  int MaxOut = 2000 + Rand(1000);
+  int PIMax = (Rand(1) > 0) ? 0 : 150 + Rand(50);   // PIMax of 0 leaves the I error unclamped
+  int MaxI = 3000 + Rand(1000);
+  ref.SetMaxOutput( MaxOut );   pid.SetMaxOutput( MaxOut );
+  ref.SetPIMax( PIMax );        pid.SetPIMax( PIMax );
+  ref.SetMaxIntegral( MaxI );   pid.SetMaxIntegral( MaxI );
+
+  if( UseDFilter ) {
+    int Filter = 128 + Rand(127);
+    ref.SetDervativeFilter( Filter );  pid.SetDervativeFilter( Filter );
+  }
+  if( ClampP ) {
+    int PMax = 350 + Rand(150);
+    ref.SetPMax( PMax );  pid.SetPMax( PMax );
+  }
+
+  int SetPoint = 0, Measured = 0;
+  char DoIntegrate = 1;
+
+  for( int i=0; i<Steps; i++ )
+  {
+    SetPoint += Rand(200);   SetPoint = SetPoint * 31 / 32;
+    Measured += Rand(400);   Measured = Measured * 31 / 32;
+    if( Rand(20) == 0 ) DoIntegrate = !DoIntegrate;
+
+    int a = ref.Calculate( SetPoint, Measured, DoIntegrate );
+    int b = pid.Calculate( SetPoint, Measured, DoIntegrate );
+
+    if( a != b || ref.IError != pid.IError || ref.DError != pid.DError || ref.LastPError != pid.LastPError )
+    {
+      printf( "IntPIDT<%d,%d,%d,%d> run %d step %d: Output %d / %d  IError %d / %d  DError %d / %d\n",
+              Precision, UseI, UseDFilter, ClampP, Run, i, a, b, ref.IError, pid.IError, ref.DError, pid.DError );
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+template<int Precision, bool UseI, bool UseDFilter, bool ClampP>
+static int CompareVariant( int Runs, int Steps )
+{
+  int Failed = 0;
+  for( int r=0; r<Runs; r++ ) {
+    Failed += CompareRun<Precision, UseI, UseDFilter, ClampP>( r, Steps );
+  }
+
+  if( Verbose || Failed ) {
+    printf( "IntPIDT<%d,%d,%d,%d>: %d of %d runs differ\n", Precision, UseI, UseDFilter, ClampP, Failed, Runs );
+  }
+  return Failed;
+}
+
+
+static int Compare( void )
+{
+  const int Runs = 200, Steps = 5000;
+  int Failed = 0;
+
+  Failed += CompareVariant<8, false, false, false>( Runs, Steps );
+  Failed += CompareVariant<8, false, false, true >( Runs, Steps );
+  Failed += CompareVariant<8, false, true,  false>( Runs, Steps );
+  Failed += CompareVariant<8, false, true,  true >( Runs, Steps );
+  Failed += CompareVariant<8, true,  false, false>( Runs, Steps );
+  Failed += CompareVariant<8, true,  false, true >( Runs, Steps );
+  Failed += CompareVariant<8, true,  true,  false>( Runs, Steps );
+  Failed += CompareVariant<8, true,  true,  true >( Runs, Steps );
+  Failed += CompareVariant<6, true,  true,  true >( Runs, Steps );
+  Failed += CompareVariant<10, false, true, false>( Runs, Steps );
+
+  printf( Failed ? "FAILED - %d runs differ\n" : "All variants match IntPID\n", Failed );
+  return Failed ? 1 : 0;
+}
+
+
+// Roll, pitch and yaw, set up as Initialize() does with default gains
+template<class PID>
+static void SetupAxes( PID * Axis )
+{
+  Axis[0].Init( 500, 0, 1560 * 250, 250 );  Axis[0].SetMaxOutput( 3000 );  Axis[0].SetPIMax( 100 );
+  Axis[0].SetMaxIntegral( 1900 );  Axis[0].SetDervativeFilter( 224 );
+  Axis[1] = Axis[0];
+  Axis[2].Init( 1200, 0, 625 * 250, 250 );  Axis[2].SetMaxOutput( 5000 );  Axis[2].SetPIMax( 100 );
+  Axis[2].SetMaxIntegral( 2000 );  Axis[2].SetDervativeFilter( 192 );
+}
+
+static int Benchmark( int Count )
+{
+  static long SetPoint[1024][3], Measured[1024][3];
+  for( int i=0; i<1024; i++ ) {
+    for( int a=0; a<3; a++ ) {
+      SetPoint[i][a] = Rand(2000);
+      Measured[i][a] = Rand(4000);
+    }
+  }
+
+  IntPID Ref[3];
+  SetupAxes( Ref );
+
+  volatile int Sink = 0;
+  clock_t start = clock();
+  for( int i=0; i<Count; i++ ) {
+    const long * sp = SetPoint[i & 1023], * m = Measured[i & 1023];
+    Sink += Ref[0].Calculate( sp[0], m[0], 0 );
+    Sink += Ref[1].Calculate( sp[1], m[1], 0 );
+    Sink += Ref[2].Calculate( sp[2], m[2], 0 );
+  }
+  double refSecs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  typedef IntPIDT<8, false, true, false> AxisPID_t;   // as in elev8-main.cpp
+  AxisPID_t Axis[3];
+  SetupAxes( Axis );
+
+  start = clock();
+  for( int i=0; i<Count; i++ ) {
+    AxisPID_t::CalculateAll( Axis, 3, SetPoint[i & 1023], Measured[i & 1023], 0 );
+    Sink += Axis[0].Output + Axis[1].Output + Axis[2].Output;
+  }
+  double newSecs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  printf( "IntPID x3:            %.1f ns per update\n", refSecs * 1e9 / Count );
+  printf( "IntPIDT CalculateAll: %.1f ns per update\n", newSecs * 1e9 / Count );
+  return 0;
+}
+
+
+int main( int argc, char ** argv )
+{
+  int benchCount = 0;
+
+  for( int i=1; i<argc; i++ )
+  {
+    if( strcmp(argv[i], "-v") == 0 ) Verbose = 1;
+    else if( strcmp(argv[i], "-bench") == 0 && i+1 < argc ) benchCount = atoi( argv[++i] );
+    else {
+      fprintf( stderr, "usage: pid_compare [-v] [-bench count]\n" );
+      return 1;
+    }
+  }
+
+  if( benchCount > 0 ) return Benchmark( benchCount );
+  return Compare();
+}
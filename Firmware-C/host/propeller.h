@@ -0,0 +1,60 @@
+#ifndef __HOST_PROPELLER_H__
+#define __HOST_PROPELLER_H__
+
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Stand-in for the PropGCC <propeller.h> header, used when building firmware modules on a PC
+// (see host/readme.txt).  Only the pieces the host-buildable modules actually touch are here.
+
+#include <stdint.h>
+#include <string.h>
+
+
+// Cog registers, for the modules that drive pins or time things off the system counter (elev8-main.cpp
+// in flight_replay).  Pin writes go nowhere.  CNT moves on a little every time it's read, so a loop
+// spinning on it still finishes, and waitcnt() just sets it to the target.
+
+inline volatile unsigned int & Host_Reg( int r ) {
+  static volatile unsigned int Regs[16];
+  return Regs[r];
+}
+
+#define INA   Host_Reg(0)
+#define OUTA  Host_Reg(1)
+#define DIRA  Host_Reg(2)
+#define CTRA  Host_Reg(3)
+#define CTRB  Host_Reg(4)
+#define FRQA  Host_Reg(5)
+#define FRQB  Host_Reg(6)
+#define PHSA  Host_Reg(7)
+#define PHSB  Host_Reg(8)
+
+inline unsigned int Host_CNT(void) { return Host_Reg(15) += 16; }
+#define CNT   Host_CNT()
+
+inline void waitcnt( unsigned int t ) { Host_Reg(15) = t; }
+
+
+// There are no other cogs to start - the thread never runs, and -1 is what cogstart() returns when
+// the cogs have all been taken.
+inline int cogstart( void (*)(void *), void *, void *, unsigned int ) { return -1; }
+
+#endif
@@ -0,0 +1,360 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Checks the serial_4x.cpp ring buffers on the PC, at buffer sizes from 2 bytes to several kb.
+//
+//   ring_test [-v]
+//
+// The driver cog is emulated by stepping its buffer handling the way the PASM in serial_4x_driver.spin
+// does it (read or write a byte at the index, add 1, cmpsub the size, drop and count a received byte
+// that would overrun the buffer).  Random mixes of S4_Put, S4_Put_Bytes, S4_Try_Put_Bytes, S4_Reserve /
+// S4_Try_Reserve / S4_Commit and S4_Can_Put on the transmit side, and S4_Check, S4_Peek and
+// S4_Get_Bytes_Timed on the receive side, are run against a plain queue, interleaved with the emulated
+// cog sending and receiving, on all four ports at once.  Fails if any byte comes out different, or out of
+// order, if S4_Can_Put is wrong about the free space, if an error count is off, or if an index ever
+// leaves 0 .. Size-1.  Only calls that won't wait are made, since nothing runs the "cog" while the test
+// is waiting.  Last, it checks that each telemetry stream's packet fits in the USB / XBee transmit ring.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <propeller.h>
+
+// The driver image the C side finds its shared variables in - the signature, then S4_COGVARS
+static uint32_t DriverImage[128];
+
+#define use_cog_driver(name)
+#define get_cog_driver(name)        DriverImage
+#define load_cog_driver(name, par)  1
+#define cogstop(cog)
+#define CLKFREQ                     80000000
+
+#include "serial_4x.cpp"
+#include "comms.h"
+
+
+static unsigned int Seed = 12345;
+
+static int Rand( int range )   // 0 to range-1
+{
+  Seed = Seed * 1103515245 + 12345;
+  return (int)((Seed >> 8) % (unsigned)range);
+}
+
+static int Verbose = 0;
+static int Errors = 0;
+
+static void Fail( int port, const char * what, int a, int b )
+{
+  if( Errors++ < 10 ) {
+    printf( "port %d: %s (%d, expected %d)\n", port, what, a, b );
+  }
+}
+
+
+struct PORT {
+  char * TxB, * RxB;
+  int TxS, RxS;
+  std::deque<char> TxModel, Wire;        // Bytes put but not sent yet, bytes the cog sent
+  std::deque<char> RxModel;              // Bytes received but not read yet
+  std::deque<char> Sent;                 // Everything put, in order
+  int Dropped, Overruns, Framing;        // Expected error counts
+};
+
+
+// The cog's half of each port
+static void CogSend( int port, PORT & p )
+{
+  int E = cv->Tx_EI[port];
+  if( E == *cv->Tx_II_Ref[port] ) return;              // Empty
+
+  p.Wire.push_back( cv->TxB[port][E] );
+  p.TxModel.pop_front();
+  E += 1;
+  if( E >= cv->TxS[port] ) E -= cv->TxS[port];         // cmpsub
+  *cv->Tx_EI_Ref[port] = E;
+}
+
+static void CogReceive( int port, char c, char StopBit )
+{
+  int N = cv->Rx_II[port] + 1;
+  if( N >= cv->RxS[port] ) N -= cv->RxS[port];         // cmpsub
+
+  if( *cv->Rx_EI_Ref[port] == N ) {
+    *cv->Rx_OE_Ref[port] = ++cv->Rx_OE[port];          // Full - drop it
+  }
+  else {
+    cv->RxB[port][cv->Rx_II[port]] = c;
+    *cv->Rx_II_Ref[port] = N;
+  }
+
+  if( !StopBit ) {
+    *cv->Rx_FE_Ref[port] = ++cv->Rx_FE[port];
+  }
+}
+
+
+static void CheckIndices( int port, PORT & p )
+{
+  if( cv->Tx_II[port] < 0 || cv->Tx_II[port] >= p.TxS ) Fail( port, "Tx_II out of range", cv->Tx_II[port], p.TxS );
+  if( cv->Tx_EI[port] < 0 || cv->Tx_EI[port] >= p.TxS ) Fail( port, "Tx_EI out of range", cv->Tx_EI[port], p.TxS );
+  if( cv->Rx_II[port] < 0 || cv->Rx_II[port] >= p.RxS ) Fail( port, "Rx_II out of range", cv->Rx_II[port], p.RxS );
+  if( cv->Rx_EI[port] < 0 || cv->Rx_EI[port] >= p.RxS ) Fail( port, "Rx_EI out of range", cv->Rx_EI[port], p.RxS );
+}
+
+
+static void Transmit( int port, PORT & p )
+{
+  int Free = p.TxS - 1 - (int)p.TxModel.size();
+
+  if( !S4_Can_Put( port, Free ) ) Fail( port, "S4_Can_Put said no to the free space", Free, 1 );
+  if( S4_Can_Put( port, Free + 1 ) ) Fail( port, "S4_Can_Put said yes to more than the free space", Free + 1, 0 );
+  if( Free == 0 ) return;
+
+  char Data[8192];
+  int Count = 1 + Rand( Rand(4) == 0 ? Free : (Free < 40 ? Free : 40) );
+  for( int i=0; i<Count; i++ ) Data[i] = (char)Rand(256);
+
+  if( Rand(8) == 0 ) {      // Too much for the Try_ versions - nothing should go in
+    char Tried = 0;
+    int Over = Free + 1 + Rand(4);
+    int Before = cv->Tx_II[port];
+
+    if( Rand(2) ) {
+      Tried = S4_Try_Put_Bytes( port, Data, Over );
+    }
+    else {
+      S4_SPAN Span;
+      Tried = S4_Try_Reserve( port, Over, &Span );
+    }
+    if( Tried ) Fail( port, "Try_ took more than the free space", Over, Free );
+    if( cv->Tx_II[port] != Before ) Fail( port, "Try_ moved Tx_II on a drop", cv->Tx_II[port], Before );
+    p.Dropped++;
+    return;
+  }
+
+  switch( Rand(5) )
+  {
+  case 0:
+    for( int i=0; i<Count; i++ ) S4_Put( port, Data[i] );
+    break;
+
+  case 1:
+    S4_Put_Bytes( port, Data, Count );
+    break;
+
+  case 2:
+  {
+    S4_SPAN Span;
+    int Got = S4_Reserve( port, Count, &Span );
+    if( Got != Count ) Fail( port, "S4_Reserve gave a different count", Got, Count );
+    if( Span.Count[0] + Span.Count[1] != Got ) Fail( port, "S4_Reserve spans don't add up", Span.Count[0] + Span.Count[1], Got );
+    if( Span.Count[1] && Span.Ptr[0] + Span.Count[0] != p.TxB + p.TxS ) Fail( port, "S4_Reserve wrapped before the end", 0, 0 );
+
+    memcpy( Span.Ptr[0], Data, Span.Count[0] );
+    memcpy( Span.Ptr[1], Data + Span.Count[0], Span.Count[1] );
+
+    int Mid = cv->Tx_II[port];
+    for( int i=0; i<8; i++ ) CogSend( port, p );   // Nothing reserved goes out before the commit
+    if( cv->Tx_II[port] != Mid ) Fail( port, "Tx_II moved before S4_Commit", cv->Tx_II[port], Mid );
+
+    S4_Commit( port, Got );
+    break;
+  }
+
+  case 3:
+    if( !S4_Try_Put_Bytes( port, Data, Count ) ) Fail( port, "S4_Try_Put_Bytes dropped what fit", Count, Free );
+    break;
+
+  case 4:
+  {
+    S4_SPAN Span;
+    if( !S4_Try_Reserve( port, Count, &Span ) ) Fail( port, "S4_Try_Reserve dropped what fit", Count, Free );
+    memcpy( Span.Ptr[0], Data, Span.Count[0] );
+    memcpy( Span.Ptr[1], Data + Span.Count[0], Span.Count[1] );
+    S4_Commit( port, Count );
+    break;
+  }
+  }
+
+  for( int i=0; i<Count; i++ ) {
+    p.TxModel.push_back( Data[i] );
+    p.Sent.push_back( Data[i] );
+  }
+}
+
+
+static void Receive( int port, PORT & p )
+{
+  int Avail = (int)p.RxModel.size();
+
+  switch( Rand(3) )
+  {
+  case 0:
+  {
+    int c = S4_Peek( port );
+    int d = S4_Check( port );
+    int e = Avail ? (unsigned char)p.RxModel.front() : -1;
+    if( c != e ) Fail( port, "S4_Peek", c, e );
+    if( d != e ) Fail( port, "S4_Check", d, e );
+    if( Avail ) p.RxModel.pop_front();
+    break;
+  }
+
+  case 1:
+  case 2:
+  {
+    char Buf[8192];
+    int Count = 1 + Rand( Avail + 2 );       // Sometimes more than is there
+    char Got = S4_Get_Bytes_Timed( port, Buf, Count, 0 );
+
+    if( Count > Avail ) {
+      if( Got ) Fail( port, "S4_Get_Bytes_Timed returned bytes that weren't there", Count, Avail );
+      break;
+    }
+    if( !Got ) {
+      Fail( port, "S4_Get_Bytes_Timed missed bytes that were there", Count, Avail );
+      break;
+    }
+    for( int i=0; i<Count; i++ ) {
+      if( Buf[i] != p.RxModel.front() ) Fail( port, "S4_Get_Bytes_Timed data", (unsigned char)Buf[i], (unsigned char)p.RxModel.front() );
+      p.RxModel.pop_front();
+    }
+    break;
+  }
+  }
+}
+
+
+static int RunSizes( const int * TxSizes, const int * RxSizes, int Steps )
+{
+  DriverImage[0] = 0x12345678;
+  S4_Initialize();
+
+  PORT Port[4];
+  for( int n=0; n<4; n++ ) {
+    PORT & p = Port[n];
+    p.TxS = TxSizes[n];
+    p.RxS = RxSizes[n];
+    p.Dropped = p.Overruns = p.Framing = 0;
+    p.TxB = new char[p.TxS];
+    p.RxB = new char[p.RxS];
+    S4_Define_Port( n, 115200, n, p.TxB, p.TxS, n + 4, p.RxB, p.RxS );
+  }
+
+  int StartErrors = Errors;
+  for( int step=0; step<Steps; step++ )
+  {
+    int n = Rand(4);
+    PORT & p = Port[n];
+
+    switch( Rand(4) )
+    {
+    case 0:
+      Transmit( n, p );
+      break;
+
+    case 1:   // The cog sends a burst
+    {
+      int Burst = Rand( p.TxS + 1 );
+      for( int i=0; i<Burst; i++ ) CogSend( n, p );
+      break;
+    }
+
+    case 2:   // The cog receives a burst - now and then more than will fit, and a byte with no stop bit
+    {
+      int Burst = Rand( p.RxS - (int)p.RxModel.size() + (Rand(8) == 0 ? 4 : 0) );
+      for( int i=0; i<Burst; i++ ) {
+        char c = (char)Rand(256);
+        char StopBit = Rand(64) != 0;
+        CogReceive( n, c, StopBit );
+
+        if( (int)p.RxModel.size() == p.RxS - 1 ) p.Overruns++;
+        else p.RxModel.push_back( c );
+        if( !StopBit ) p.Framing++;
+      }
+      break;
+    }
+
+    case 3:
+      Receive( n, p );
+      break;
+    }
+
+    CheckIndices( n, p );
+  }
+
+  for( int n=0; n<4; n++ ) {
+    PORT & p = Port[n];
+    for( int i=0; i<p.TxS; i++ ) CogSend( n, p );
+    if( p.Wire != p.Sent ) Fail( n, "bytes sent don't match the bytes put", (int)p.Wire.size(), (int)p.Sent.size() );
+    if( S4_Tx_Dropped(n) != p.Dropped ) Fail( n, "S4_Tx_Dropped", S4_Tx_Dropped(n), p.Dropped );
+    if( S4_Rx_Overruns(n) != p.Overruns ) Fail( n, "S4_Rx_Overruns", S4_Rx_Overruns(n), p.Overruns );
+    if( S4_Rx_Framing(n) != p.Framing ) Fail( n, "S4_Rx_Framing", S4_Rx_Framing(n), p.Framing );
+    if( Verbose ) printf( "port %d: tx %5d rx %5d, %d bytes through, %d dropped, %d overruns, %d framing\n",
+                          n, p.TxS, p.RxS, (int)p.Sent.size(), p.Dropped, p.Overruns, p.Framing );
+    delete [] p.TxB;
+    delete [] p.RxB;
+  }
+  return Errors - StartErrors;
+}
+
+
+// Every telemetry stream has to fit in an empty USB / XBee transmit ring, or TryStartPacket drops it every time
+static void CheckStreamsFit(void)
+{
+  static char TxB[Comms_TxBufSize], RxB[32];
+  DriverImage[0] = 0x12345678;
+  S4_Initialize();
+  S4_Define_Port( 0, 115200, 0, TxB, sizeof(TxB), 4, RxB, sizeof(RxB) );
+
+  for( int i=0; i<Stream_Count; i++ ) {
+    if( !S4_Can_Put( 0, StreamBytes[i] ) ) Fail( 0, "stream packet won't fit in an empty transmit ring", i, StreamBytes[i] );
+  }
+}
+
+
+int main( int argc, char ** argv )
+{
+  for( int i=1; i<argc; i++ )
+  {
+    if( strcmp(argv[i], "-v") == 0 ) Verbose = 1;
+    else {
+      fprintf( stderr, "usage: ring_test [-v]\n" );
+      return 1;
+    }
+  }
+
+  static const int Sizes[][2][4] = {
+    { {  Comms_TxBufSize, Comms_TxBufSize, 4, 64 }, { 32, 32, 128, 4 } },    // As elev8-main.cpp sets them up
+    { {    2,    3,  255,  256 }, {    2,    3,  255,  256 } },
+    { {  257,  300,  511,  512 }, {  513, 1000,  127,  128 } },
+    { { 1024, 4096, 8000, 2048 }, { 4096,  333, 2000,    5 } },
+  };
+
+  for( int s=0; s<(int)(sizeof(Sizes) / sizeof(Sizes[0])); s++ ) {
+    RunSizes( Sizes[s][0], Sizes[s][1], 200000 );
+  }
+  CheckStreamsFit();
+
+  printf( Errors ? "FAILED - %d errors\n" : "All ring buffer checks passed\n", Errors );
+  return Errors ? 1 : 0;
+}
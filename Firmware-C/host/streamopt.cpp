@@ -0,0 +1,658 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// F32 command stream optimizer and cycle report.
+//
+//   streamopt [-o optimized.txt] [-verify count] [quatimu.cpp] [f32.h]
+//
+// Reads the IMU_VarLabels enum and every "unsigned char name[] = { ... };" command stream from
+// quatimu.cpp, then for each stream:
+//   - propagates opMov copies into later reads
+//   - folds "op ..., temp" + "opMov temp, 0, dest" into "op ..., dest" (hoisting dest past independent ops)
+//   - removes stores that are never read
+// and prints op counts and estimated cog cycles before and after.  The optimized streams are written
+// in the same form as quatimu.cpp, ready to paste back in.  With -verify, both versions of each stream
+// are run through the emulated F32 cog (f32_host.cpp) on random inputs and compared bit for bit.
+//
+// A variable's value is only considered dead at the end of a stream if no C code names it, and every
+// stream that touches it writes it before reading it.  Variables whose address is taken in the C code
+// (like &IMU_VARS[m00]) pin their whole group in the enum, up to the next blank or comment line.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <propeller.h>
+#include "constants.h"
+#include "f32.h"
+#include "f32_host.h"
+
+
+struct INSTR {
+  int op, a, b, out;
+};
+
+struct STREAM {
+  std::string name;
+  std::vector<INSTR> code;
+  std::vector<INSTR> opt;
+};
+
+
+static std::vector<std::string> VarNames;          // IMU_VarLabels, in order
+static std::map<std::string, int> VarIndex;
+static std::vector<bool> VarIsInt;                 // declared in the INTEGER section of the enum
+static std::vector<int> VarGroup;                  // enum lines between blank / comment lines share a group
+static std::map<int, int> IntInit;                 // INT_VARS[x] = literal, from QuatIMU_Start
+
+static std::map<std::string, int> OpIndex;         // F32_op* names from f32.h
+static std::map<int, std::string> OpName;
+
+static std::vector<STREAM> Streams;
+static std::set<int> External;                     // variables the C code can see
+
+
+//------------------------------------------------------------------------------
+// Per-op properties.  Cycle counts are typical-path estimates, from counting the PASM
+// in f32_driver.spin at 4 clocks per instruction and 16 per hub access, including the
+// call/ret from the stream loop.  Mul and Div loop over the mantissa bits, so they
+// vary with the data; the figures here assume full precision operands.
+//------------------------------------------------------------------------------
+
+struct OPINFO {
+  const char * name;
+  bool usesB;           // reads the B operand
+  bool writesB;         // writes the B operand (SinCos)
+  bool readsOut;        // reads the output before writing it (FMA)
+  int  vecLen;          // reads this many consecutive vars from A and B (Dot)
+  int  cycles;
+};
+
+static const OPINFO OpInfo[] = {
+  { "F32_opAdd",         true,  false, false, 0,  336 },
+  { "F32_opSub",         true,  false, false, 0,  340 },
+  { "F32_opMul",         true,  false, false, 0,  680 },
+  { "F32_opDiv",         true,  false, false, 0,  720 },
+  { "F32_opFloat",       false, false, false, 0,  270 },
+  { "F32_opTruncRound",  true,  false, false, 0,  150 },
+  { "F32_opSqrt",        false, false, false, 0, 1130 },
+  { "F32_opCmp",         true,  false, false, 0,   44 },
+  { "F32_opSin",         false, false, false, 0, 1150 },
+  { "F32_opCos",         false, false, false, 0, 1160 },
+  { "F32_opLog2",        true,  false, false, 0,  460 },
+  { "F32_opExp2",        true,  false, false, 0,  500 },
+  { "F32_opASinCos",     true,  false, false, 0, 3530 },
+  { "F32_opATan2",       true,  false, false, 0, 1340 },
+  { "F32_opShift",       true,  false, false, 0,  176 },
+  { "F32_opNeg",         false, false, false, 0,   20 },
+  { "F32_opSinCos",      false, true,  false, 0, 1540 },
+  { "F32_opFAbs",        false, false, false, 0,   16 },
+  { "F32_opFMin",        true,  false, false, 0,   32 },
+  { "F32_opCNeg",        true,  false, false, 0,   16 },
+  { "F32_opMov",         false, false, false, 0,    8 },
+  { "F32_opFMA",         true,  false, true,  0, 1060 },
+  { "F32_opDot3",        false, false, false, 3, 3000 },
+  { "F32_opDot4",        false, false, false, 4, 4070 },
+  { "F32_opRSqrt",       false, false, false, 0, 1860 },
+};
+
+static const int StreamLoopCycles = 176;           // per-op fetch / operand load / store overhead in _RunCommandStream
+
+
+static const OPINFO * GetOpInfo( int op )
+{
+  std::map<int, std::string>::iterator it = OpName.find(op);
+  if( it == OpName.end() ) return 0;
+  for( unsigned i=0; i<sizeof(OpInfo)/sizeof(OpInfo[0]); i++ ) {
+    if( it->second == OpInfo[i].name ) return &OpInfo[i];
+  }
+  return 0;
+}
+
+static bool UsesB( int op )   { const OPINFO * p = GetOpInfo(op);  return p ? p->usesB : true; }
+static bool WritesB( int op ) { const OPINFO * p = GetOpInfo(op);  return p ? p->writesB : false; }
+static bool ReadsOut( int op ) { const OPINFO * p = GetOpInfo(op);  return p ? p->readsOut : false; }
+static int  VecLen( int op )  { const OPINFO * p = GetOpInfo(op);  return p ? p->vecLen : 0; }
+static int  OpCycles( int op ) { const OPINFO * p = GetOpInfo(op);  return (p ? p->cycles : 1000) + StreamLoopCycles; }
+
+static bool IsMov( int op ) { return OpName[op] == "F32_opMov"; }
+
+static bool Reads( const INSTR & i, int v )
+{
+  int n = VecLen(i.op);
+  if( n ) return (v >= i.a && v < i.a + n) || (v >= i.b && v < i.b + n);
+  return i.a == v || (UsesB(i.op) && i.b == v) || (ReadsOut(i.op) && i.out == v);
+}
+
+static bool Writes( const INSTR & i, int v ) { return i.out == v || (WritesB(i.op) && i.b == v); }
+static bool Touches( const INSTR & i, int v ) { return Reads(i, v) || Writes(i, v); }
+
+
+//------------------------------------------------------------------------------
+// Source parsing
+//------------------------------------------------------------------------------
+
+static bool ReadFile( const char * filename, std::string & text )
+{
+  FILE * f = fopen( filename, "rb" );
+  if( f == 0 ) return false;
+  char buf[4096];
+  size_t len;
+  while( (len = fread( buf, 1, sizeof(buf), f )) > 0 )
+    text.append( buf, len );
+  fclose(f);
+  return true;
+}
+
+// Replace comments with spaces, keeping newlines so line structure survives
+static std::string StripComments( const std::string & s )
+{
+  std::string r = s;
+  for( size_t i=0; i<r.size(); i++ )
+  {
+    if( r[i] == '/' && i+1 < r.size() && r[i+1] == '/' ) {
+      while( i < r.size() && r[i] != '\n' ) r[i++] = ' ';
+    }
+    else if( r[i] == '/' && i+1 < r.size() && r[i+1] == '*' ) {
+      size_t end = r.find( "*/", i+2 );
+      end = (end == std::string::npos) ? r.size() : end + 2;
+      for( ; i < end; i++ ) if( r[i] != '\n' ) r[i] = ' ';
+      i--;
+    }
+  }
+  return r;
+}
+
+static bool IsIdent( char c ) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'; }
+
+static std::string Trim( const std::string & s )
+{
+  size_t a = s.find_first_not_of( " \t\r\n" );
+  size_t b = s.find_last_not_of( " \t\r\n" );
+  return (a == std::string::npos) ? std::string() : s.substr( a, b - a + 1 );
+}
+
+
+static bool ParseOps( const std::string & text )
+{
+  size_t pos = 0;
+  while( (pos = text.find( "#define", pos )) != std::string::npos )
+  {
+    pos += 7;
+    char name[64];
+    int value;
+    if( sscanf( text.c_str() + pos, " %63s %d", name, &value ) == 2 && strncmp( name, "F32_op", 6 ) == 0 ) {
+      OpIndex[name] = value;
+      OpName[value] = name;
+    }
+  }
+  return !OpIndex.empty();
+}
+
+
+static bool ParseEnum( const std::string & raw )
+{
+  size_t start = raw.find( "enum IMU_VarLabels" );
+  if( start == std::string::npos ) return false;
+  size_t open = raw.find( '{', start );
+  size_t close = raw.find( "};", open );
+  if( open == std::string::npos || close == std::string::npos ) return false;
+
+  std::string body = raw.substr( open + 1, close - open - 1 );
+
+  bool isInt = true;
+  int group = 0;
+  size_t lineStart = 0;
+  while( lineStart < body.size() )
+  {
+    size_t lineEnd = body.find( '\n', lineStart );
+    if( lineEnd == std::string::npos ) lineEnd = body.size();
+    std::string line = body.substr( lineStart, lineEnd - lineStart );
+    lineStart = lineEnd + 1;
+
+    if( line.find( "FLOAT data" ) != std::string::npos ) isInt = false;
+
+    std::string code = Trim( StripComments( line ) );
+    if( code.empty() ) {                              // blank or comment-only line ends a group
+      group++;
+      continue;
+    }
+
+    size_t i = 0;
+    while( i < code.size() ) {
+      while( i < code.size() && !IsIdent(code[i]) ) i++;
+      size_t j = i;
+      while( j < code.size() && IsIdent(code[j]) ) j++;
+      if( j > i ) {
+        std::string name = code.substr( i, j - i );
+        if( name != "IMU_VARS_SIZE" ) {
+          VarIndex[name] = (int)VarNames.size();
+          VarNames.push_back( name );
+          VarIsInt.push_back( isInt );
+          VarGroup.push_back( group );
+        }
+      }
+      i = j;
+    }
+  }
+  return VarNames.size() > 0 && VarNames.size() < 256;
+}
+
+
+static int Operand( const std::string & tok )
+{
+  if( tok.empty() ) return -1;
+  if( tok[0] >= '0' && tok[0] <= '9' ) return atoi( tok.c_str() );
+  std::map<std::string, int>::iterator it = VarIndex.find(tok);
+  return (it == VarIndex.end()) ? -1 : it->second;
+}
+
+
+// Finds the command streams, and records which variables the remaining C code refers to
+static bool ParseStreams( const std::string & raw )
+{
+  std::string text = StripComments( raw );
+  std::string rest;                                   // everything that isn't a stream or the enum
+
+  size_t pos = 0;
+  for(;;)
+  {
+    size_t found = text.find( "unsigned char", pos );
+    size_t bracket = (found == std::string::npos) ? found : text.find( "[]", found );
+    size_t open = (bracket == std::string::npos) ? bracket : text.find( '{', bracket );
+    size_t semi = (found == std::string::npos) ? found : text.find( ';', found );
+
+    if( found == std::string::npos || bracket == std::string::npos || open == std::string::npos || semi < open ) {
+      if( found == std::string::npos ) {
+        rest += text.substr( pos );
+        break;
+      }
+      rest += text.substr( pos, found + 13 - pos );   // not a stream definition
+      pos = found + 13;
+      continue;
+    }
+
+    size_t close = text.find( "};", open );
+    std::string name = Trim( text.substr( found + 13, bracket - found - 13 ) );
+    rest += text.substr( pos, found - pos );
+
+    STREAM s;
+    s.name = name;
+
+    std::vector<int> values;
+    std::string body = text.substr( open + 1, close - open - 1 );
+    size_t i = 0;
+    while( i < body.size() ) {
+      size_t comma = body.find( ',', i );
+      if( comma == std::string::npos ) comma = body.size();
+      std::string tok = Trim( body.substr( i, comma - i ) );
+      i = comma + 1;
+      if( tok.empty() ) continue;
+
+      int v = OpIndex.count(tok) ? OpIndex[tok] : Operand(tok);
+      if( v < 0 ) {
+        fprintf( stderr, "%s: unknown token '%s'\n", name.c_str(), tok.c_str() );
+        return false;
+      }
+      values.push_back( v );
+    }
+
+    for( size_t n = 0; n + 3 < values.size(); n += 4 ) {
+      if( values[n] == 0 ) break;                     // end of stream
+      INSTR in = { values[n], values[n+1], values[n+2], values[n+3] };
+      s.code.push_back( in );
+    }
+    Streams.push_back( s );
+    pos = close + 2;
+  }
+
+  size_t cut = rest.find( "enum IMU_VarLabels" );
+  if( cut != std::string::npos )
+    rest.erase( cut, rest.find( "};", cut ) - cut );
+
+  // Any enum name in the remaining code is visible outside the streams
+  size_t i = 0;
+  while( i < rest.size() )
+  {
+    while( i < rest.size() && !IsIdent(rest[i]) ) i++;
+    size_t j = i;
+    while( j < rest.size() && IsIdent(rest[j]) ) j++;
+    if( j > i ) {
+      std::string name = rest.substr( i, j - i );
+      std::map<std::string, int>::iterator it = VarIndex.find(name);
+      if( it != VarIndex.end() ) {
+        int v = it->second;
+        External.insert( v );
+
+        // &IMU_VARS[x] exposes the whole group x belongs to
+        size_t back = rest.rfind( '&', i );
+        if( back != std::string::npos ) {
+          std::string between;
+          for( size_t k = back; k < i; k++ ) if( rest[k] != ' ' && rest[k] != '\t' ) between += rest[k];
+          if( between == "&IMU_VARS[" || between == "&INT_VARS[" ) {
+            for( int k = v; k < (int)VarNames.size() && VarGroup[k] == VarGroup[v]; k++ )
+              External.insert( k );
+          }
+        }
+
+        // INT_VARS[x] = literal; gives a sensible starting value for -verify
+        size_t eq = rest.find_first_not_of( " \t]", j );
+        if( eq != std::string::npos && rest[eq] == '=' && rest[eq+1] != '=' ) {
+          int value;
+          if( i >= 9 && rest.compare( i - 9, 8, "INT_VARS" ) == 0 && sscanf( rest.c_str() + eq + 1, " %d", &value ) == 1 )
+            IntInit[v] = value;
+        }
+      }
+    }
+    i = j;
+  }
+  return !Streams.empty();
+}
+
+
+//------------------------------------------------------------------------------
+// Optimization passes
+//------------------------------------------------------------------------------
+
+static std::set<int> LocalVars;                    // dead at the end of every stream
+
+static void FindLocalVars(void)
+{
+  for( int v = 0; v < (int)VarNames.size(); v++ )
+  {
+    if( External.count(v) ) continue;
+
+    bool local = true;
+    for( size_t s = 0; s < Streams.size() && local; s++ ) {
+      const std::vector<INSTR> & code = Streams[s].code;
+      for( size_t i = 0; i < code.size(); i++ ) {
+        if( Reads( code[i], v ) ) { local = false; break; }     // read before written in this stream
+        if( Writes( code[i], v ) ) break;
+      }
+    }
+    if( local ) LocalVars.insert( v );
+  }
+}
+
+
+// Replace reads of a copied value with the original, while neither has changed
+static bool PropagateCopies( std::vector<INSTR> & code )
+{
+  bool changed = false;
+  for( size_t i = 0; i < code.size(); i++ )
+  {
+    if( !IsMov(code[i].op) ) continue;
+    int src = code[i].a, dst = code[i].out;
+    if( src == dst ) continue;
+
+    for( size_t j = i + 1; j < code.size(); j++ ) {
+      INSTR & in = code[j];
+      if( VecLen(in.op) ) {                           // vector operands can't be renamed one element at a time
+        if( Writes( in, src ) || Writes( in, dst ) ) break;
+        continue;
+      }
+      if( in.a == dst ) { in.a = src; changed = true; }
+      if( UsesB(in.op) && in.b == dst ) { in.b = src; changed = true; }
+      if( Writes( in, src ) || Writes( in, dst ) ) break;
+    }
+  }
+  return changed;
+}
+
+
+static bool LiveAfter( const std::vector<INSTR> & code, size_t index, int v )
+{
+  for( size_t i = index + 1; i < code.size(); i++ ) {
+    if( Reads( code[i], v ) ) return true;
+    if( Writes( code[i], v ) ) return false;
+  }
+  return LocalVars.count(v) == 0;
+}
+
+
+// "op a, b, t" ... "opMov t, 0, d" becomes "op a, b, d" when t isn't needed afterward,
+// and nothing in between touches d.  The Mov is effectively hoisted up to its producer.
+static bool CoalesceMoves( std::vector<INSTR> & code )
+{
+  for( size_t k = 0; k < code.size(); k++ )
+  {
+    if( !IsMov(code[k].op) ) continue;
+    int t = code[k].a, d = code[k].out;
+
+    if( t == d ) {                                    // self move
+      code.erase( code.begin() + k );
+      return true;
+    }
+
+    // find the producer of t
+    size_t p = k;
+    while( p > 0 ) {
+      p--;
+      if( Writes( code[p], t ) || Reads( code[p], t ) ) break;
+    }
+    if( p == k || code[p].out != t || (WritesB(code[p].op) && code[p].b == t) ) continue;
+    if( ReadsOut(code[p].op) ) continue;              // FMA accumulates into t, so can't be retargeted
+    if( WritesB(code[p].op) && code[p].b == d ) continue;
+    if( LiveAfter( code, k, t ) ) continue;
+
+    bool blocked = false;
+    for( size_t i = p + 1; i < k && !blocked; i++ )
+      blocked = Touches( code[i], d ) || Reads( code[i], t );
+    if( blocked ) continue;
+
+    code[p].out = d;
+    code.erase( code.begin() + k );
+    return true;
+  }
+  return false;
+}
+
+
+static bool RemoveDeadStores( std::vector<INSTR> & code )
+{
+  bool changed = false;
+  for( size_t i = code.size(); i-- > 0; )
+  {
+    const INSTR & in = code[i];
+    bool live = LiveAfter( code, i, in.out ) || (WritesB(in.op) && LiveAfter( code, i, in.b ));
+    if( !live ) {
+      code.erase( code.begin() + i );
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+
+static void Optimize( STREAM & s )
+{
+  s.opt = s.code;
+  bool changed;
+  do {
+    changed = false;
+    while( CoalesceMoves( s.opt ) ) changed = true;     // before propagation, which would add reads of t
+    changed |= PropagateCopies( s.opt );
+    changed |= RemoveDeadStores( s.opt );
+  } while( changed );
+}
+
+
+//------------------------------------------------------------------------------
+// Reporting
+//------------------------------------------------------------------------------
+
+static int StreamCycles( const std::vector<INSTR> & code )
+{
+  int total = 0;
+  for( size_t i = 0; i < code.size(); i++ ) total += OpCycles( code[i].op );
+  return total;
+}
+
+static void Report( const STREAM & s )
+{
+  std::map<int, int> before, after;
+  for( size_t i = 0; i < s.code.size(); i++ ) before[s.code[i].op]++;
+  for( size_t i = 0; i < s.opt.size(); i++ ) after[s.opt[i].op]++;
+
+  int c0 = StreamCycles( s.code ), c1 = StreamCycles( s.opt );
+
+  printf( "%s\n", s.name.c_str() );
+  printf( "  %-18s %6s %6s\n", "op", "before", "after" );
+  for( std::map<int, int>::iterator it = before.begin(); it != before.end(); ++it )
+    printf( "  %-18s %6d %6d\n", OpName[it->first].c_str() + 4, it->second, after[it->first] );
+  printf( "  %-18s %6d %6d\n", "total ops", (int)s.code.size(), (int)s.opt.size() );
+  printf( "  %-18s %6d %6d   (%.1f%% -> %.1f%% of a %d cycle loop)\n\n", "est. cycles", c0, c1,
+          100.0 * c0 / Const_UpdateCycles, 100.0 * c1 / Const_UpdateCycles, Const_UpdateCycles );
+}
+
+
+static void WriteStream( FILE * f, const STREAM & s )
+{
+  fprintf( f, "unsigned char %s[] = {\n", s.name.c_str() );
+  for( size_t i = 0; i < s.opt.size(); i++ ) {
+    const INSTR & in = s.opt[i];
+    std::string a = VarNames[in.a], b = in.b ? VarNames[in.b] : "0", out = VarNames[in.out];
+    fprintf( f, "        %s, %s, %s, %s,\n", OpName[in.op].c_str(), a.c_str(), b.c_str(), out.c_str() );
+  }
+  fprintf( f, "        0, 0, 0, 0\n};\n\n" );
+}
+
+
+//------------------------------------------------------------------------------
+// Verification - run both versions on the emulated cog, and compare everything that stays live
+//------------------------------------------------------------------------------
+
+static bool RunChecked( const std::vector<INSTR> & code, unsigned int * vars )
+{
+  // Run one op at a time, so intermediate NaNs can be caught - the cog's NaN handling depends
+  // on leftover register contents, so streams that hit them aren't expected to match
+  for( size_t i = 0; i < code.size(); i++ ) {
+    unsigned char op[8] = { (unsigned char)(code[i].op << 2), (unsigned char)code[i].a,
+                            (unsigned char)code[i].b, (unsigned char)code[i].out, 0, 0, 0, 0 };
+    F32::RunStream( op, (float *)vars );
+    unsigned int r = vars[code[i].out];
+    if( !VarIsInt[code[i].out] && ((r >> 23) & 0xFF) == 0xFF ) return false;
+  }
+  return true;
+}
+
+static int Verify( const STREAM & s, int count )
+{
+  int n = (int)VarNames.size();
+  std::vector<unsigned int> start(n), a(n), b(n);
+  int compared = 0, failures = 0;
+
+  for( int iter = 0; iter < count * 4 && compared < count; iter++ )
+  {
+    for( int v = 0; v < n; v++ ) {
+      if( IntInit.count(v) ) start[v] = IntInit[v];
+      else if( VarIsInt[v] ) start[v] = (unsigned int)((rand() % 4001) - 2000);
+      else {
+        float f = (float)(rand() / (double)RAND_MAX * 2.0 - 1.0);
+        memcpy( &start[v], &f, 4 );
+      }
+    }
+
+    a = start;
+    b = start;
+    if( !RunChecked( s.code, &a[0] ) ) continue;
+    RunChecked( s.opt, &b[0] );
+    compared++;
+
+    for( int v = 0; v < n; v++ ) {
+      if( LocalVars.count(v) || a[v] == b[v] ) continue;
+      if( failures < 10 )
+        printf( "  MISMATCH %s: %s = %08x, optimized %08x\n", s.name.c_str(), VarNames[v].c_str(), a[v], b[v] );
+      failures++;
+    }
+  }
+  printf( "  %s: %d runs compared, %d mismatches\n", s.name.c_str(), compared, failures );
+  return failures;
+}
+
+
+int main( int argc, char ** argv )
+{
+  const char * srcName = "quatimu.cpp";
+  const char * opsName = "f32.h";
+  const char * outName = 0;
+  int verifyCount = 0;
+  int files = 0;
+
+  for( int i = 1; i < argc; i++ ) {
+    if( strcmp( argv[i], "-o" ) == 0 && i+1 < argc ) outName = argv[++i];
+    else if( strcmp( argv[i], "-verify" ) == 0 && i+1 < argc ) verifyCount = atoi( argv[++i] );
+    else if( argv[i][0] != '-' && files == 0 ) { srcName = argv[i]; files++; }
+    else if( argv[i][0] != '-' && files == 1 ) { opsName = argv[i]; files++; }
+    else {
+      fprintf( stderr, "usage: streamopt [-o file] [-verify count] [quatimu.cpp] [f32.h]\n" );
+      return 1;
+    }
+  }
+
+  std::string src, ops;
+  if( !ReadFile( opsName, ops ) || !ParseOps( ops ) ) {
+    fprintf( stderr, "unable to read F32 ops from %s\n", opsName );
+    return 1;
+  }
+  if( !ReadFile( srcName, src ) || !ParseEnum( src ) || !ParseStreams( src ) ) {
+    fprintf( stderr, "unable to read command streams from %s\n", srcName );
+    return 1;
+  }
+
+  FindLocalVars();
+
+  printf( "Stream-local variables:" );
+  for( std::set<int>::iterator it = LocalVars.begin(); it != LocalVars.end(); ++it )
+    printf( " %s", VarNames[*it].c_str() );
+  printf( "\n\n" );
+
+  int c0 = 0, c1 = 0;
+  for( size_t i = 0; i < Streams.size(); i++ ) {
+    Optimize( Streams[i] );
+    Report( Streams[i] );
+    c0 += StreamCycles( Streams[i].code );
+    c1 += StreamCycles( Streams[i].opt );
+  }
+  printf( "All streams: est. %d cycles before, %d after (%d saved per update)\n", c0, c1, c0 - c1 );
+
+  if( outName ) {
+    FILE * f = fopen( outName, "w" );
+    if( f == 0 ) {
+      fprintf( stderr, "unable to write %s\n", outName );
+      return 1;
+    }
+    for( size_t i = 0; i < Streams.size(); i++ ) WriteStream( f, Streams[i] );
+    fclose( f );
+  }
+
+  int failures = 0;
+  if( verifyCount > 0 ) {
+    F32::Start();
+    printf( "\nVerifying against the emulated F32 cog:\n" );
+    for( size_t i = 0; i < Streams.size(); i++ ) failures += Verify( Streams[i], verifyCount );
+  }
+  return failures ? 2 : 0;
+}
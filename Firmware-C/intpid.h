@@ -82,4 +82,129 @@ public:
 };
 
 
+
+// IntPIDT - the same PID as IntPID, with the options fixed when it's compiled instead of tested on every
+// call.  Precision is the number of fixed bits, as in SetPrecision().  The switches:
+//
+//   UseI       - the integral term is used.  Leave it off if the I gain is zero (IError stays at zero).
+//   UseDFilter - the derivative is filtered.  The filter must be set to a non-zero value.
+//   ClampP     - the P error is clamped to +/- PMax.  PMax must be set to a positive value.
+//
+// Set up like this, the results are the same as IntPID's, bit for bit - host/pid_compare.cpp checks that.
+
+template<int Precision, bool UseI, bool UseDFilter, bool ClampP>
+class IntPIDT
+{
+public:
+  void Init( int PGain, int IGain, int DGain, short _SampleRate )
+  {
+    SampleRate = _SampleRate;
+    Kp = PGain;
+    Ki = IGain / SampleRate;
+    Kd = DGain / SampleRate;
+    PMax = 0;
+    PIMax = 0;
+    DerivFilter = 0;
+
+    DError = 0;
+    LastPError = 0;
+    IError = 0;
+    MaxIntegral = 0x010000;
+    MaxOutput = 1000;
+  }
+
+  void SetPGain( int Value )        { Kp = Value; }
+  void SetIGain( int Value )        { Ki = Value / (int)SampleRate; }
+  void SetDGain( int Value )        { Kd = Value / (int)SampleRate; }
+  void SetPMax( int Value )         { PMax = Value; }
+  void SetPIMax( int Value )        { PIMax = Value; }
+  void SetMaxIntegral( int Value )  { MaxIntegral = Value; }
+  void SetMaxOutput( int Value )    { MaxOutput = Value; }
+
+  void SetDervativeFilter( unsigned char Filter ) { DerivFilter = Filter; }
+
+  void ResetIntegralError(void) { IError = 0; }
+  int GetIError(void)           { return IError; }
+
+  // Use Reset if running a PID that's been idle for a while
+  void Reset(void)              { IError = 0; LastPError = 0; }
+
+  int Calculate( int SetPoint , int Measured , char DoIntegrate )
+  {
+    int PError = SetPoint - Measured;
+
+    if( UseDFilter ) {
+      int RawDeriv = PError - LastPError;
+      DError += ((RawDeriv - DError) * DerivFilter) >> 8;
+    }
+    else {
+      DError = PError - LastPError;
+    }
+
+    LastPError = PError;
+
+    int PClamped = PError;
+    if( ClampP ) {
+      PClamped = Limit( PClamped, PMax );
+    }
+
+    Output = (Kp * PClamped) + (Kd * DError);
+    if( UseI ) {
+      Output += Ki * IError;
+    }
+    Output = (Output + RoundOffset) >> Precision;
+    Output = Limit( Output, MaxOutput );    // mins / maxs, no branch
+
+    if( UseI && DoIntegrate )
+    {
+      PClamped = PError;
+      if( PIMax > 0 ) {
+        PClamped = Limit( PClamped, PIMax );
+      }
+
+      IError += PClamped;
+      IError = Limit( IError, MaxIntegral );
+    }
+
+    return Output;
+  }
+
+  // Runs Calculate() on Count PIDs in a row (roll, pitch, yaw), leaving the results in each one's Output.
+  // The flight loop makes one call, and only one copy of Calculate() ends up in the code.
+  static void CalculateAll( IntPIDT * PID, int Count, const long * SetPoint, const long * Measured, char DoIntegrate )
+  {
+    for( int i=0; i<Count; i++ ) {
+      PID[i].Calculate( SetPoint[i], Measured[i], DoIntegrate );
+    }
+  }
+
+
+private:
+  enum { RoundOffset = 1 << (Precision-1) };
+
+  static long Limit( long v, long max ) {
+    v = (v < -max) ? -max : v;
+    v = (v > max) ? max : v;
+    return v;
+  }
+
+public:
+
+  long Kp;             //PID Gain
+  long Ki;             //PID Gain
+  long Kd;             //PID Gain
+  long PMax;           //Maximum P term error value
+
+  unsigned char DerivFilter;   //value from 0 to 255 - only used with UseDFilter
+  short SampleRate;            //updates per second
+
+  long Output;
+  long DError;         //Derivative error (kept for filtering)
+  long IError;         //Accumulated integral error
+  long LastPError;     //Previous Error
+  long MaxIntegral, PIMax;
+  long MaxOutput;
+};
+
+
 #endif
@@ -0,0 +1,113 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+  
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation, 
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+  
+  Written by Jason Dorie
+*/
+
+#include "elev8-main.h"   // for OUT_FL, etc
+#include "mixer.h"
+
+
+// One output's share of a PID output, in 1/64ths.  The shares the frames use are spelled out as shifts,
+// anything else falls back to a multiply.
+template <int C> struct Share     { static inline int Of( int v ) { return (v * C) >> 6; } };
+template <>      struct Share<0>  { static inline int Of( int ) { return 0; } };
+template <>      struct Share<64> { static inline int Of( int v ) { return v; } };
+template <>      struct Share<60> { static inline int Of( int v ) { return v - (v >> 4); } };
+template <>      struct Share<56> { static inline int Of( int v ) { return v - (v >> 3); } };
+template <>      struct Share<32> { static inline int Of( int v ) { return v >> 1; } };
+template <>      struct Share<24> { static inline int Of( int v ) { return (v >> 2) + (v >> 3); } };
+
+template <int C> static inline int Signed( int v ) {
+  return (C < 0) ? -Share<-C>::Of(v) : Share<C>::Of(v);
+}
+
+template <int P, int R, int Y>
+static inline short Out( int Thro, int Pitch, int Roll, int Yaw, int ThroMix ) {
+  return Thro + (((Signed<P>(Pitch) + Signed<R>(Roll) + Signed<Y>(Yaw)) * ThroMix) >> 7);
+}
+
+#define MIX( P, R, Y )  Out<P, R, Y>( Thro, Pitch, Roll, Yaw, ThroMix )
+
+
+static void Mix_QuadX( short * Motor, int Thro, int Pitch, int Roll, int Yaw, int ThroMix )
+{
+  //                    Pitch Roll  Yaw
+  Motor[OUT_FL] = MIX(   64,   64,  -64 );
+  Motor[OUT_FR] = MIX(   64,  -64,   64 );
+  Motor[OUT_BL] = MIX(  -64,   64,   64 );
+  Motor[OUT_BR] = MIX(  -64,  -64,  -64 );
+}
+
+static void Mix_QuadPlus( short * Motor, int Thro, int Pitch, int Roll, int Yaw, int ThroMix )
+{
+  Motor[0] = MIX(   64,    0,  -64 );   // Front
+  Motor[1] = MIX(    0,  -64,   64 );   // Right
+  Motor[2] = MIX(  -64,    0,  -64 );   // Back
+  Motor[3] = MIX(    0,   64,   64 );   // Left
+}
+
+static void Mix_HexX( short * Motor, int Thro, int Pitch, int Roll, int Yaw, int ThroMix )
+{
+  // Arms every 60 degrees, starting 30 degrees off the nose:  cos 30 = 0.866 ~= 56/64
+  Motor[0] = MIX(   56,   32,  -64 );   // Front left
+  Motor[1] = MIX(   56,  -32,   64 );   // Front right
+  Motor[2] = MIX(    0,  -64,  -64 );   // Right
+  Motor[3] = MIX(  -56,  -32,   64 );   // Back right
+  Motor[4] = MIX(  -56,   32,  -64 );   // Back left
+  Motor[5] = MIX(    0,   64,   64 );   // Left
+}
+
+static void Mix_OctoX( short * Motor, int Thro, int Pitch, int Roll, int Yaw, int ThroMix )
+{
+  // Arms every 45 degrees, starting 22.5 degrees off the nose:  cos 22.5 = 0.924 ~= 60/64, sin 22.5 = 0.383 ~= 24/64
+  Motor[0] = MIX(   60,   24,  -64 );   // Front left
+  Motor[1] = MIX(   60,  -24,   64 );   // Front right
+  Motor[2] = MIX(   24,  -60,  -64 );   // Right front
+  Motor[3] = MIX(  -24,  -60,   64 );   // Right back
+  Motor[4] = MIX(  -60,  -24,  -64 );   // Back right
+  Motor[5] = MIX(  -60,   24,   64 );   // Back left
+  Motor[6] = MIX(  -24,   60,  -64 );   // Left back
+  Motor[7] = MIX(   24,   60,   64 );   // Left front
+}
+
+static void Mix_Y6( short * Motor, int Thro, int Pitch, int Roll, int Yaw, int ThroMix )
+{
+  // Front arms 60 degrees off the nose:  cos 60 = 0.5, sin 60 = 0.866 ~= 56/64.  Yaw is the top
+  // props against the bottom ones.
+  Motor[0] = MIX(   32,   56,  -64 );   // Top front left
+  Motor[1] = MIX(   32,  -56,  -64 );   // Top front right
+  Motor[2] = MIX(  -64,    0,  -64 );   // Top back
+  Motor[3] = MIX(   32,   56,   64 );   // Bottom front left
+  Motor[4] = MIX(   32,  -56,   64 );   // Bottom front right
+  Motor[5] = MIX(  -64,    0,   64 );   // Bottom back
+}
+
+
+static const MIXER Mixers[Frame_Count] = {
+  { Mix_QuadX,    4 },
+  { Mix_QuadPlus, 4 },
+  { Mix_HexX,     6 },
+  { Mix_OctoX,    8 },
+  { Mix_Y6,       6 },
+};
+
+const MIXER * Mixer_Get( int FrameType )
+{
+  if( FrameType < 0 || FrameType >= Frame_Count ) FrameType = Frame_QuadX;
+  return &Mixers[FrameType];
+}
@@ -0,0 +1,68 @@
+#ifndef __MIXER_H__
+#define __MIXER_H__
+
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+  
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation, 
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+  
+  Written by Jason Dorie
+*/
+
+/*
+  Mixer - Motor mixing for each frame type
+
+  Each motor output is the throttle plus its share of the pitch, roll, and yaw PID outputs, scaled by
+  the throttle mix.  The shares are fixed point, in 1/64ths, and each frame type has its own mix
+  function with the shares as template arguments, so they're all constants.  A full share (64) is a
+  plain add or subtract, so the quad X mix is exactly the four lines it always was.  The fractional
+  shares are all a sum or difference of two powers of 2 (32, 56 = 64-8, 60 = 64-4, 24 = 16+8), and
+  come out as shifts and adds - the Propeller has no multiply instruction.
+
+  Output 0 to 3 drive the four motor pins (OUT_FL, OUT_FR, OUT_BR, OUT_BL), 4 to 7 the AUX pins.
+  The output order for each frame, looking down with the front at the top:
+
+    Quad X  - front left, front right, back right, back left
+    Quad +  - front, right, back, left
+    Hex X   - front left, front right, right, back right, back left, left
+    Octo X  - front left, front right, right front, right back, back right, back left, left back, left front
+    Y6      - top: front left, front right, back  then bottom: front left, front right, back
+
+  Motors next to each other spin in opposite directions (Y6 - all the top props one way, bottom the
+  other), with the front left motor spinning the same way as on the quad X.
+*/
+
+#define MAX_MOTORS  8
+
+enum {
+  Frame_QuadX = 0,
+  Frame_QuadPlus,
+  Frame_HexX,
+  Frame_OctoX,
+  Frame_Y6,
+  Frame_Count
+};
+
+typedef void (*MIX_FUNC)( short * Motor, int Thro, int Pitch, int Roll, int Yaw, int ThroMix );
+
+struct MIXER {
+  MIX_FUNC Mix;     // Fills in Motor[0] to Motor[Outputs-1]
+  char  Outputs;
+};
+
+
+const MIXER * Mixer_Get( int FrameType );   // Unknown frame types get the quad X mixer
+
+#endif
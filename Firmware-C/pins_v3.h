@@ -45,6 +45,8 @@
 #define PIN_MOTOR_AUX2  18
 #define PIN_EXP_TX      19
 #define PIN_EXP_RX      20
+#define PIN_MOTOR_AUX3  PIN_EXP_TX    // Only used by frames with 8 motors - takes over serial port 2
+#define PIN_MOTOR_AUX4  PIN_EXP_RX
 
 #define PIN_VBATT  16
 
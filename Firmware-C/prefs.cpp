@@ -51,6 +51,51 @@ void Prefs_Save(void)
   EEPROM::FromRam( &Prefs, (char *)&Prefs + sizeof(Prefs)-1, 32768 );  //Copy from DAT to EEPROM, address 32768
 }
 
+
+static PREFS SavePrefs;       // What's being saved - Prefs itself can change while the save is going
+static short SaveIndex;       // Next byte to write, or to read back once they're all written (past sizeof(PREFS))
+static char  Saving;
+
+void Prefs_StartSave(void)
+{
+  Prefs.Checksum = Prefs_CalculateChecksum( Prefs );
+  memcpy( &SavePrefs, &Prefs, sizeof(Prefs) );
+  SaveIndex = 0;          // Starting again from the top if a save was already going
+  Saving = 1;
+}
+
+int Prefs_SaveStep(void)
+{
+  if( !Saving ) return PrefsSave_Idle;
+  if( !EEPROM::Ready() ) return PrefsSave_Busy;     // Still writing the last chunk
+
+  const int Size = sizeof(PREFS);
+  int ofs = (SaveIndex < Size) ? SaveIndex : SaveIndex - Size;
+  int count = Size - ofs;
+  if( count > Prefs_SaveChunk ) count = Prefs_SaveChunk;
+
+  char * src = (char *)&SavePrefs + ofs;
+
+  if( SaveIndex < Size ) {
+    EEPROM::FromRam( src, src + count-1, 32768 + ofs );   // Chunks never cross a 64 byte EEPROM page, since 64 is a multiple of the chunk size
+  }
+  else {
+    char check[Prefs_SaveChunk];
+    EEPROM::ToRam( check, check + count-1, 32768 + ofs );
+    if( memcmp( check, src, count ) != 0 ) {
+      Saving = 0;
+      return PrefsSave_Failed;
+    }
+  }
+
+  SaveIndex += count;
+  if( SaveIndex < Size*2 ) return PrefsSave_Busy;
+
+  Saving = 0;
+  return PrefsSave_Done;
+}
+
+
 #define PI  3.141592654
 
 
@@ -72,9 +117,9 @@ void Prefs_SetDefaults(void)
   Prefs.MagScaleOfs[5] = 1024;
 
   Prefs.AutoLevelRollPitch =    (35.0f / 1024.0f) * (PI/180.0f) * 0.5f;          // 35 deg/ControlScale * Deg2Rad * HalfAngle
-  Prefs.AutoLevelYawRate =    ((180.0f / 250.0f) / 1024.0f) * (PI/180.f) * 0.5f; // 180 deg/ControlScale / UpdateRate * Deg2Rad * HalfAngle
-  Prefs.ManualRollPitchRate = ((120.0f / 250.0f) / 1024.0f) * (PI/180.f) * 0.5f;
-  Prefs.ManualYawRate =       ((180.0f / 250.0f) / 1024.0f) * (PI/180.f) * 0.5f;
+  Prefs.AutoLevelYawRate =    ((180.0f / (float)Prefs_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f; // 180 deg/ControlScale / UpdateRate * Deg2Rad * HalfAngle
+  Prefs.ManualRollPitchRate = ((120.0f / (float)Prefs_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f;
+  Prefs.ManualYawRate =       ((180.0f / (float)Prefs_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f;
 
 
   Prefs.PitchGain = 127;
@@ -95,8 +140,8 @@ void Prefs_SetDefaults(void)
   Prefs.CenterThrottle = 1500 * 8;
   Prefs.MinThrottleArmed = 1140 * 8;
 
-  Prefs.ArmDelay = 250;
-  Prefs.DisarmDelay = 125;
+  Prefs.ArmDelay = Prefs_UpdateRate;         // 1 second
+  Prefs.DisarmDelay = Prefs_UpdateRate / 2;  // 1/2 second
 
   Prefs.ThrustCorrectionScale = 256;  // 0 to 256  =  0 to 1
   Prefs.AccelCorrectionFilter = 16;   // 0 to 256  =  0 to 1
@@ -106,6 +151,10 @@ void Prefs_SetDefaults(void)
   Prefs.FlightMode[2] = FlightMode_Manual;
   Prefs.AccelCorrectionStrength = 96;
 
+  Prefs.GyroLowpass = 0;      // Gyro filters off
+  Prefs.GyroNotch = 0;
+  Prefs.GyroNotchWidth = 20;
+
   Prefs.ThroChannel = 0;      //Standard radio channel mappings
   Prefs.AileChannel = 1;
   Prefs.ElevChannel = 2;
@@ -26,6 +26,11 @@
 //
 */
 
+// The per-update rates (AutoLevelYawRate, ManualRollPitchRate, ManualYawRate) and the ArmDelay / DisarmDelay
+// counts are stored as if the flight loop ran at this rate, which is what the GroundStation assumes when
+// it writes them.  ApplyPrefs() and the arming code convert them to Const_UpdateRate.
+#define Prefs_UpdateRate  250
+
 typedef struct {
   int   DriftScale[3];
   int   DriftOffset[3];
@@ -51,7 +56,7 @@ typedef struct {
   char  unused;
 
   char  ReceiverType;     // 0 = PWM, 1 = SBUS, 2 = PPM, 3 = RemoteRX
-  char  unused2;
+  char  FrameType;        // 0 = Quad X, 1 = Quad +, 2 = Hex X, 3 = Octo X, 4 = Y6 (see mixer.h) - read at power up
   char  UseBattMon;
   char  DisableMotors;
 
@@ -102,6 +107,11 @@ typedef struct {
   short Aux2Center;
   short Aux3Center;
 
+  char  GyroLowpass;      // Gyro lowpass ahead of the rate PIDs, -3dB point in Hz - 0 = off
+  char  GyroNotch;        // Gyro notch ahead of the rate PIDs, center in Hz - 0 = off
+  char  GyroNotchWidth;   // Notch bandwidth in Hz
+  char  unused2;
+
   int   Checksum;
 
   // Accessors for looping over channel assignments, scales, centers
@@ -119,6 +129,21 @@ int Prefs_Load(void);
 void Prefs_Save(void);
 void Prefs_SetDefaults(void);
 
+// Saving a few bytes at a time, so the flight loop never waits on the EEPROM.  Prefs_StartSave() takes a copy
+// of the prefs, and each Prefs_SaveStep() call after that writes (then reads back to check) one small chunk,
+// if the EEPROM isn't still busy with the last one.
+enum PREFSSAVE {
+  PrefsSave_Idle = 0,     // Nothing to do
+  PrefsSave_Busy,         // Still going
+  PrefsSave_Done,         // Finished, and read back correctly - returned once
+  PrefsSave_Failed,       // Finished, but what was read back didn't match - returned once
+};
+
+#define Prefs_SaveChunk  8    // Bytes per step - each byte is a few hundred instructions of bit-banged I2C
+
+void Prefs_StartSave(void);
+int  Prefs_SaveStep(void);
+
 void Prefs_Test(void);
 
 int Prefs_CalculateChecksum( PREFS & PrefsStruct );
@@ -22,8 +22,11 @@
 
 #include "constants.h"
 #include "f32.h"
+#include "f32_expr.h"
 #include "quatimu.h"
 
+#ifndef QUATIMU_FIXED     // quatimu_fixed.cpp replaces this file
+
 
 #define RadToDeg (180.0 / 3.141592654)                         //Degrees per Radian
 #define GyroToDeg  (1000.0 / 70.0)                             //Gyro units per degree @ 2000 deg/sec sens = 70 mdps/bit
@@ -58,6 +61,7 @@ enum IMU_VarLabels {
     ax, ay, az,                                  // Sensor inputs
     mx, my, mz,
     alt, altRate,
+    gyroCount,                                   // Number of gyro readings summed into gx, gy, gz
 
     // Integer constants used in computation
     const_0,
@@ -84,6 +88,9 @@ enum IMU_VarLabels {
     fxy, fxz, fyz,
 
     rx, ry, rz,                                  // Float versions of rotation components
+    gyroScale, negGyroScale,                     // Gyro units to radians, divided by the number of readings
+    conex, coney, conez,                         // Coning correction for this update
+    prx, pry, prz,                               // Previous update's gyro rotation, / 12 (for the coning correction)
     fax, fay, faz,                               // Float version of accelerometer vector
     fmx, fmy, fmz,                               // Float version of magnetometer vector
     omx, omy, omz,                               // Oriented version of magnetometer vector
@@ -95,6 +102,7 @@ enum IMU_VarLabels {
     errCorrX, errCorrY, errCorrZ,                // computed rotation correction factor
     
     temp,                                        // temp value for use in equations
+    temp2, temp3,                                // more temps, used by the f32_expr.h streams
 
     FloatYaw,                                    // Current heading (yaw) in floating point
     HalfYaw,                                     // Heading / 2, used for quaternion construction
@@ -130,6 +138,7 @@ enum IMU_VarLabels {
 
     cqw, cqx, cqy, cqz,                 // Control Quaternion result
     qrw, qrx, qry, qrz,                 // Rotation quaternion between CQ and current orientation (Q)
+    qrwSign,                            // Sign of qrw, used to flip QR to the short way around
 
     diffAxisX, diffAxisY, diffAxisZ,    // Axis around which QR rotates to get from Q to CQ
     diffAngle,                          // Amount of rotation required to get from Q to CQ
@@ -139,7 +148,6 @@ enum IMU_VarLabels {
 
     // Float constants used in computation
     const_GyroScale,
-    const_NegGyroScale,
 
     const_F1,
     const_F2,
@@ -148,6 +156,7 @@ enum IMU_VarLabels {
     const_epsilon,
     
     const_neghalf,
+    const_OneTwelfth,
 
     const_AccErrScale,
     const_MagErrScale,
@@ -188,7 +197,7 @@ static union {
 };
 
 
-#define PI  3.151592654
+#define PI  3.141592654
 
 
 void QuatIMU_Start(void)
@@ -209,7 +218,6 @@ void QuatIMU_Start(void)
   //arguments from memory using memory addresses, so the values actually need to exist somewhere
 
   IMU_VARS[const_GyroScale]         =    1.0f / (float)GyroScale;    
-  IMU_VARS[const_NegGyroScale]      =   -1.0f / (float)GyroScale;
 
   INT_VARS[const_0]                 =    0;
   INT_VARS[const_1]                 =    1;
@@ -222,6 +230,7 @@ void QuatIMU_Start(void)
   
   IMU_VARS[const_epsilon]           =    0.00000001f;     //Added to vector length value before inverting (1/X) to insure no divide-by-zero problems
   IMU_VARS[const_neghalf]           =   -0.5f;
+  IMU_VARS[const_OneTwelfth]        =    1.0f / 12.0f;
 
 
   IMU_VARS[const_AccErrScale]       =    Startup_ErrScale;  //How much accelerometer to fuse in each update (runs a little faster if it's a fractional power of two)
@@ -237,11 +246,11 @@ void QuatIMU_Start(void)
   IMU_VARS[const_velAccTrust]       =    0.9993f;      // was 0.9990    - used to generate the absolute altitude estimate
   IMU_VARS[const_velAltiTrust]      =    0.0007f;      // was 0.0010
 
-  IMU_VARS[const_YawRateScale]      =    ((120.0f / 250.0f) / 1024.0f) * (PI/180.f) * 0.5f; // 120 deg/sec / UpdateRate * Deg2Rad * HalfAngle
+  IMU_VARS[const_YawRateScale]      =    ((120.0f / (float)Const_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f; // 120 deg/sec / UpdateRate * Deg2Rad * HalfAngle
   IMU_VARS[const_AutoBankScale]     =    (45.0f / 1024.0f) * (PI/180.0f) * 0.5f;
 
-  IMU_VARS[const_ManualYawScale]    =   ((180.0f / 250.0f) / 1024.0f) * (PI/180.f) * 0.5f; // 120 deg/sec / UpdateRate * Deg2Rad * HalfAngle
-  IMU_VARS[const_ManualBankScale]   =   ((120.0f / 250.0f) / 1024.0f) * (PI/180.f) * 0.5f; // 120 deg/sec / UpdateRate * Deg2Rad * HalfAngle
+  IMU_VARS[const_ManualYawScale]    =   ((180.0f / (float)Const_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f; // 180 deg/sec / UpdateRate * Deg2Rad * HalfAngle
+  IMU_VARS[const_ManualBankScale]   =   ((120.0f / (float)Const_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f; // 120 deg/sec / UpdateRate * Deg2Rad * HalfAngle
   
   IMU_VARS[const_TwoPI]             =    2.0f * PI;
 
@@ -325,7 +334,7 @@ int QuatIMU_GetYawDifference(void) {
 void QuatIMU_SetAutoLevelRates( float MaxRollPitch , float YawRate )
 {
   IMU_VARS[const_AutoBankScale] = MaxRollPitch; // (45.0f / 1024.0f) * (PI/180.0f) * 0.5f;
-  IMU_VARS[const_YawRateScale]  = YawRate;      // ((120.0f / 250.0f) / 1024.0f) * (PI/180.f) * 0.5f;
+  IMU_VARS[const_YawRateScale]  = YawRate;      // ((120.0f / (float)Const_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f;
 }
 
 void QuatIMU_SetManualRates( float RollPitchRate, float YawRate )
@@ -337,12 +346,14 @@ void QuatIMU_SetManualRates( float RollPitchRate, float YawRate )
 
 void QuatIMU_ResetDesiredYaw(void)
 {
+  F32::WaitStream();                       // Queued control streams read and write these, so let them finish first
   IMU_VARS[Heading] = IMU_VARS[HalfYaw];   // Desired value = current computed value half-angle
 }
 
 
 void QuatIMU_ResetDesiredOrientation(void)
 {
+  F32::WaitStream();                       // Queued control streams read and write these, so let them finish first
   IMU_VARS[cqw] = IMU_VARS[qw];
   IMU_VARS[cqx] = IMU_VARS[qx];
   IMU_VARS[cqy] = IMU_VARS[qy];
@@ -408,9 +419,16 @@ void QuatIMU_SetGyroZero( int x, int y, int z )
   '  http://mathinfo.univ-reims.fr/IMG/pdf/Rotating_Objects_Using_Quaternions.pdf
 
   {
-  rx = gx / GyroScale + errCorrX
-  ry = gy / GyroScale + errCorrY
-  rz = gz / GyroScale + errCorrZ
+  rx = gx / GyroScale / gyroCount         (gx is the sum of gyroCount readings)
+  ry = gy / GyroScale / gyroCount
+  rz = gz / GyroScale / gyroCount
+
+  r += (pr x r)                           (coning correction, pr is the previous r / 12)
+  pr = r / 12
+
+  rx += errCorrX
+  ry += errCorrY
+  rz += errCorrZ
 
   rmag = sqrt(rx * rx + ry * ry + rz * rz + 0.0000000001) / 2.0 
 
@@ -447,21 +465,63 @@ void QuatIMU_AdjustStreamPointers( unsigned char * p )
 unsigned char QuatUpdateCommands[] = {
 
   //--------------------------------------------------------------
-  // Convert the gyro rates to radians, add in the previous cycle error corrections
+  // Average the gyro readings and convert the rates to radians
   //--------------------------------------------------------------
-  
+
+  //gyroScale = (1 / GyroScale) / gyroCount
+        F32_opFloat, gyroCount, 0, gyroScale,             //gyroScale = float(gyroCount)
+        F32_opDiv, const_GyroScale, gyroScale, gyroScale, //gyroScale = const_GyroScale / gyroScale
+        F32_opNeg, gyroScale, 0, negGyroScale,            //negGyroScale = -gyroScale
+
+  //fgx = gx / GyroScale
         F32_opFloat, gx, 0, rx,                           //rx = float(gx)
-        F32_opMul, rx, const_GyroScale, rx,               //rx /= GyroScale
-        F32_opAdd, rx, errCorrX, rx,                      //rx += errCorrX
+        F32_opMul, rx, gyroScale, rx,                     //rx /= GyroScale
 
-  //fgy = gy / GyroScale + errCorrY
+  //fgy = gz / GyroScale
         F32_opFloat, gz,  0, ry,                          //ry = float(gz)
-        F32_opMul, ry, const_NegGyroScale, ry,            //ry /= GyroScale
-        F32_opAdd, ry, errCorrY, ry,                      //ry += errCorrY
+        F32_opMul, ry, negGyroScale, ry,                  //ry /= -GyroScale
 
-  //fgz = gz / GyroScale + errCorrZ
+  //fgz = gy / GyroScale
         F32_opFloat, gy, 0, rz,                           //rz = float(gy)
-        F32_opMul, rz, const_NegGyroScale, rz,            //rz /= GyroScale
+        F32_opMul, rz, negGyroScale, rz,                  //rz /= -GyroScale
+
+
+  //--------------------------------------------------------------
+  // Coning correction - the averaged rate misses the part of the rotation that comes from the axis
+  // itself turning during the update.  The cross product of the previous and current rotations / 12
+  // puts most of it back.
+  //--------------------------------------------------------------
+
+  //cone = pr x r
+        F32_opMul, pry, rz, conex,                        //conex = pry*rz
+        F32_opMul, prz, ry, temp,                         //temp = prz*ry
+        F32_opSub, conex, temp, conex,                    //conex -= temp
+
+        F32_opMul, prz, rx, coney,                        //coney = prz*rx
+        F32_opMul, prx, rz, temp,                         //temp = prx*rz
+        F32_opSub, coney, temp, coney,                    //coney -= temp
+
+        F32_opMul, prx, ry, conez,                        //conez = prx*ry
+        F32_opMul, pry, rx, temp,                         //temp = pry*rx
+        F32_opSub, conez, temp, conez,                    //conez -= temp
+
+  //pr = r / 12, for the next update
+        F32_opMul, rx, const_OneTwelfth, prx,             //prx = rx / 12
+        F32_opMul, ry, const_OneTwelfth, pry,             //pry = ry / 12
+        F32_opMul, rz, const_OneTwelfth, prz,             //prz = rz / 12
+
+
+  //--------------------------------------------------------------
+  // Add in the coning correction and the previous cycle error corrections
+  //--------------------------------------------------------------
+
+        F32_opAdd, rx, conex, rx,                         //rx += conex
+        F32_opAdd, rx, errCorrX, rx,                      //rx += errCorrX
+
+        F32_opAdd, ry, coney, ry,                         //ry += coney
+        F32_opAdd, ry, errCorrY, ry,                      //ry += errCorrY
+
+        F32_opAdd, rz, conez, rz,                         //rz += conez
         F32_opAdd, rz, errCorrZ, rz,                      //rz += errCorrZ
 
 
@@ -470,98 +530,77 @@ unsigned char QuatUpdateCommands[] = {
   //--------------------------------------------------------------
 
   //rmag = sqrt(rx * rx + ry * ry + rz * rz + 0.0000000001) * 0.5
-        F32_opMul, rx, rx, rmag,                          //rmag = fgx*fgx
-        F32_opMul, ry, ry, temp,                          //temp = fgy*fgy
-        F32_opAdd, rmag, temp, rmag,                      //rmag += temp
-        F32_opMul, rz, rz, temp,                          //temp = fgz*fgz
-        F32_opAdd, rmag, temp, rmag,                      //rmag += temp
+        F32_opDot3, rx, rx, rmag,                         //rmag = fgx*fgx + fgy*fgy + fgz*fgz
         F32_opAdd, rmag, const_epsilon, rmag,             //rmag += 0.00000001
         F32_opSqrt, rmag, 0, rmag,                        //rmag = Sqrt(rmag)                                                  
         F32_opShift, rmag, const_neg1, rmag,              //rmag *= 0.5                                                  
-  //8 instructions  (17)
+  //4 instructions  (13)
 
   //cosr = Cos(rMag)
   //sinr = Sin(rMag) / rMag
         F32_opSinCos, rmag,  sinr, cosr,           //sinr = Sin(rmag), cosr = Cos(rmag)  
         F32_opDiv, sinr,  rmag, sinr,              //sinr /= rmag                                                  
-  //3 instructions  (20)
+  //2 instructions  (15)
 
   //qdot.w =  (r.x*x + r.y*y + r.z*z) * -0.5
-        F32_opMul, rx,  qx, qdw,                   //qdw = rx*qx 
-        F32_opMul, ry,  qy, temp,                  //temp = ry*qy
-        F32_opAdd, qdw,  temp, qdw,                //qdw += temp
-        F32_opMul, rz,  qz, temp,                  //temp = rz*qz
-        F32_opAdd, qdw,  temp, qdw,                //qdw += temp
+        F32_opDot3, rx,  qx, qdw,                  //qdw = rx*qx + ry*qy + rz*qz
         F32_opMul, qdw,  const_neghalf, qdw,       //qdw *= -0.5
-  //8 instructions  (28)
+  //2 instructions  (17)
 
   //qdot.x =  (r.x*w + r.z*y - r.y*z) * 0.5
         F32_opMul, rx,  qw, qdx,                   //qdx = rx*qw 
-        F32_opMul, rz,  qy, temp,                  //temp = rz*qy
-        F32_opAdd, qdx,  temp, qdx,                //qdx += temp
+        F32_opFMA, rz,  qy, qdx,                   //qdx += rz*qy
         F32_opMul, ry,  qz, temp,                  //temp = ry*qz
         F32_opSub, qdx,  temp, qdx,                //qdx -= temp
         F32_opShift, qdx,  const_neg1, qdx,        //qdx *= 0.5
-  //8 instructions  (36)
+  //5 instructions  (22)
 
   //qdot.y =  (r.y*w - r.z*x + r.x*z) * 0.5
         F32_opMul, ry,  qw, qdy,                   //qdy = ry*qw 
         F32_opMul, rz,  qx, temp,                  //temp = rz*qx
         F32_opSub, qdy,  temp, qdy,                //qdy -= temp
-        F32_opMul, rx,  qz, temp,                  //temp = rx*qz
-        F32_opAdd, qdy,  temp, qdy,                //qdy += temp
+        F32_opFMA, rx,  qz, qdy,                   //qdy += rx*qz
         F32_opShift, qdy,  const_neg1, qdy,        //qdy *= 0.5
-  //8 instructions  (44)
+  //5 instructions  (27)
 
   //qdot.z =  (r.z*w + r.y*x - r.x*y) * 0.5
         F32_opMul, rz,  qw, qdz,                   //qdz = rz*qw 
-        F32_opMul, ry,  qx, temp,                  //temp = ry*qx
-        F32_opAdd, qdz,  temp, qdz,                //qdz += temp
+        F32_opFMA, ry,  qx, qdz,                   //qdz += ry*qx
         F32_opMul, rx,  qy, temp,                  //temp = rx*qy
         F32_opSub, qdz,  temp, qdz,                //qdz -= temp
         F32_opShift, qdz,  const_neg1, qdz,        //qdz *= 0.5
-  //8 instructions  (52)
+  //5 instructions  (32)
    
   //q.w = cosr * q.w + sinr * qdot.w
         F32_opMul, cosr,  qw, qw,                  //qw = cosr*qw 
-        F32_opMul, sinr,  qdw, temp,               //temp = sinr*qdw
-        F32_opAdd, qw,  temp, qw,                  //qw += temp
+        F32_opFMA, sinr,  qdw, qw,                 //qw += sinr*qdw
 
   //q.x = cosr * q.x + sinr * qdot.x
         F32_opMul, cosr,  qx, qx,                  //qx = cosr*qx 
-        F32_opMul, sinr,  qdx, temp,               //temp = sinr*qdx
-        F32_opAdd, qx,  temp, qx,                  //qx += temp
+        F32_opFMA, sinr,  qdx, qx,                 //qx += sinr*qdx
 
   //q.y = cosr * q.y + sinr * qdot.y
         F32_opMul, cosr,  qy, qy,                  //qy = cosr*qy 
-        F32_opMul, sinr,  qdy, temp,               //temp = sinr*qdy
-        F32_opAdd, qy,  temp, qy,                  //qy += temp
+        F32_opFMA, sinr,  qdy, qy,                 //qy += sinr*qdy
 
   //q.z = cosr * q.z + sinr * qdot.z
         F32_opMul, cosr,  qz, qz,                  //qz = cosr*qz 
-        F32_opMul, sinr,  qdz, temp,               //temp = sinr*qdz
-        F32_opAdd, qz,  temp, qz,                  //qz += temp
-  //12 instructions  (64)
+        F32_opFMA, sinr,  qdz, qz,                 //qz += sinr*qdz
+  //8 instructions  (40)
 
   //q = q.Normalize()
-  //rmag = sqrt(q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w + 0.0000001)
-        F32_opMul, qx, qx, rmag,                   //rmag = qx*qx 
-        F32_opMul, qy, qy, temp,                   //temp = qy*qy 
-        F32_opAdd, rmag,  temp, rmag,              //rmag += temp 
-        F32_opMul, qz, qz, temp,                   //temp = qz*qz 
-        F32_opAdd, rmag,  temp, rmag,              //rmag += temp 
-        F32_opMul, qw, qw, temp,                   //temp = qw*qw 
-        F32_opAdd, rmag,  temp, rmag,              //rmag += temp 
+  //rmag = 1.0 / sqrt(q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w + 0.0000001)
+        F32_opDot4, qx, qx, rmag,                  //rmag = qx*qx + qy*qy + qz*qz + qw*qw
         F32_opAdd, rmag,  const_epsilon, rmag,     //rmag += 0.0000001 
-        F32_opSqrt, rmag,  0, rmag,                //sqrt(rmag) 
-  //9 instructions (73)
+        F32_opRSqrt, rmag,  0, rmag,               //1.0 / sqrt(rmag) 
+  //3 instructions (43)
 
-  //q /= rmag   
-        F32_opDiv, qw,  rmag, qw,                  //qw /= rmag 
-        F32_opDiv, qx,  rmag, qx,                  //qx /= rmag 
-        F32_opDiv, qy,  rmag, qy,                  //qy /= rmag 
-        F32_opDiv, qz,  rmag, qz,                  //qz /= rmag 
-  //4 instructions (77)
+  //q *= rmag   
+        F32_opMul, qw,  rmag, qw,                  //qw *= rmag 
+        F32_opMul, qx,  rmag, qx,                  //qx *= rmag 
+        F32_opMul, qy,  rmag, qy,                  //qy *= rmag 
+        F32_opMul, qz,  rmag, qz,                  //qz *= rmag 
+  //4 instructions (47)
 
 
   //--------------------------------------------------------------
@@ -571,17 +610,17 @@ unsigned char QuatUpdateCommands[] = {
         F32_opMul, qx, qx, fx2,                    //fx2 = qx *qx
         F32_opMul, qy, qy, fy2,                    //fy2 = qy *qy
         F32_opMul, qz, qz, fz2,                    //fz2 = qz *qz
-  //3 instructions (80)
+  //3 instructions (50)
 
         F32_opMul, qw,  qx, fwx,                   //fwx = qw *qx
         F32_opMul, qw,  qy, fwy,                   //fwy = qw *qy
         F32_opMul, qw,  qz, fwz,                   //fwz = qw *qz
-  //3 instructions (83)
+  //3 instructions (53)
 
         F32_opMul, qx,  qy, fxy,                   //fxy = qx *qy
         F32_opMul, qx,  qz, fxz,                   //fxz = qx *qz
         F32_opMul, qy,  qz, fyz,                   //fyz = qy *qz
-  //3 instructions (86)
+  //3 instructions (56)
 
 
   
@@ -597,7 +636,7 @@ unsigned char QuatUpdateCommands[] = {
   //m02 =        2.0f * (fxz + fwy)
         F32_opAdd, fxz,  fwy, temp,                //temp = fxz+fwy
         F32_opShift, temp,  const_1, m02,          //m02 = 2.0 * temp
-  //7 instructions (93)
+  //7 instructions (63)
 
 
   //m10 =        2.0f * (fxy + fwz)
@@ -612,7 +651,7 @@ unsigned char QuatUpdateCommands[] = {
   //m12 =        2.0f * (fyz - fwx)
         F32_opSub, fyz,  fwx, temp,                //temp = fyz-fwx
         F32_opShift, temp,  const_1, m12,          //m12 = 2.0 * temp
-  //7 instructions (100)
+  //7 instructions (70)
 
    
   //m20 =        2.0f * (fxz - fwy)
@@ -627,7 +666,7 @@ unsigned char QuatUpdateCommands[] = {
         F32_opAdd, fx2,  fy2, temp,                //temp = fx2+fy2
         F32_opShift, temp,  const_1, temp,         //temp *= 2.0
         F32_opSub, const_F1,  temp, m22,           //m22 = 1.0 - temp
-  //7 instructions (107)
+  //7 instructions (77)
 
 
   //--------------------------------------------------------------
@@ -653,8 +692,7 @@ unsigned char QuatUpdateCommands[] = {
 
   //ayRot = (fax * accRollCorrSin) + (fay * accRollCorrCos)
         F32_opMul, fax,  accRollCorrSin, ayRot,
-        F32_opMul, fay,  accRollCorrCos, temp,
-        F32_opAdd, ayRot,  temp, ayRot,
+        F32_opFMA, fay,  accRollCorrCos, ayRot,
 
   //fax = axRot         
   //fay = ayRot
@@ -670,8 +708,7 @@ unsigned char QuatUpdateCommands[] = {
 
   //ayRot = (fax * accPitchCorrSin) + (fay * accPitchCorrCos)
         F32_opMul, faz,  accPitchCorrSin, ayRot,                           
-        F32_opMul, fay,  accPitchCorrCos, temp,
-        F32_opAdd, ayRot,  temp, ayRot,
+        F32_opFMA, fay,  accPitchCorrCos, ayRot,
 
   //faz = axRot         
   //fay = ayRot
@@ -686,29 +723,35 @@ unsigned char QuatUpdateCommands[] = {
   //--------------------------------------------------------------
 
   //rmag = facc.length
-        F32_opMul, fax,fax, rmag,                  //rmag = fax*fax
-        F32_opMul, fay,fay, temp,                  //temp = fay*fay
-        F32_opAdd, rmag,  temp, rmag,              //rmag += temp
-        F32_opMul, faz,faz, temp,                  //temp = faz*faz
-        F32_opAdd, rmag,  temp, rmag,              //rmag += temp
+        F32_opDot3, fax,fax, rmag,                 //rmag = fax*fax + fay*fay + faz*faz
         F32_opAdd, rmag,  const_epsilon, rmag,     //rmag += 0.00000001
         F32_opSqrt, rmag,  0, rmag,                //rmag = Sqrt(rmag)                                                  
 
-  //facc /= rmag
-        F32_opDiv, fax,  rmag, faxn,               //faxn = fax / rmag 
-        F32_opDiv, fay,  rmag, fayn,               //fayn = fay / rmag 
-        F32_opDiv, faz,  rmag, fazn,               //fazn = faz / rmag 
-
-
 
   //accWeight = 1.0 - FMin( FAbs( 2.0 - accLen * 2.0 ), 1.0 )
-        F32_opMul, rmag,  const_AccScale, rmag,    //rmag /= accScale (accelerometer to 1G units)
-        F32_opShift, rmag,  const_1, accWeight,    //accWeight = rmag * 2.0
+        F32_opMul, rmag,  const_AccScale, temp,    //temp = rmag / accScale (accelerometer to 1G units)
+        F32_opShift, temp,  const_1, accWeight,    //accWeight = temp * 2.0
         F32_opSub, const_F2,  accWeight, accWeight,//accWeight = 2.0 - accWeight
         F32_opFAbs, accWeight,  0, accWeight,      //accWeight = FAbs(accWeight)
         F32_opFMin, accWeight, const_F1, accWeight,//accWeight = FMin( accWeight, 1.0 )
         F32_opSub, const_F1,  accWeight, accWeight,//accWeight = 1.0 - accWeight                                                
 
+  //accWeight *= const_AccErrScale
+        F32_opMul, const_AccErrScale,  accWeight, accWeight,
+
+
+  //--------------------------------------------------------------
+  // Normalize the accelerometer vector and scale it by the weighting
+  // factor in one step:  facc * (accWeight / rmag).  The weight then
+  // carries straight through the cross product below, so the result
+  // doesn't need scaling afterward.
+  //--------------------------------------------------------------
+
+        F32_opDiv, accWeight,  rmag, temp,         //temp = accWeight / rmag
+        F32_opMul, fax,  temp, faxn,               //faxn = fax * temp
+        F32_opMul, fay,  temp, fayn,               //fayn = fay * temp
+        F32_opMul, faz,  temp, fazn,               //fazn = faz * temp
+
 
   //--------------------------------------------------------------
   // Compute the cross product of our normalized accelerometer vector
@@ -716,38 +759,27 @@ unsigned char QuatUpdateCommands[] = {
   // the cross product will be zeros.  Any difference produces an
   // axis of rotation between the two vectors, and the magnitude of
   // the vector is the amount to rotate to align them.
+  //
+  // Because faxn/fayn/fazn are already scaled by the weighting factor,
+  // the result is the correction that gets mixed in with the gyro
+  // values on the next update to pull the "up" part of our rotation
+  // back into alignment with gravity over time.
   //--------------------------------------------------------------
 
-
-  //errDiffX = fayn * m12 - fazn * m11
-        F32_opMul, fayn,  m12, errDiffX, 
+  //errCorrX = fayn * m12 - fazn * m11
+        F32_opMul, fayn,  m12, errCorrX, 
         F32_opMul, fazn,  m11, temp, 
-        F32_opSub, errDiffX,  temp, errDiffX, 
+        F32_opSub, errCorrX,  temp, errCorrX, 
 
-  //errDiffY = fazn * m10 - faxn * m12
-        F32_opMul, fazn,  m10, errDiffY, 
+  //errCorrY = fazn * m10 - faxn * m12
+        F32_opMul, fazn,  m10, errCorrY, 
         F32_opMul, faxn,  m12, temp, 
-        F32_opSub, errDiffY,  temp, errDiffY, 
+        F32_opSub, errCorrY,  temp, errCorrY, 
 
-  //errDiffZ = faxn * m11 - fayn * m10
-        F32_opMul, faxn,  m11, errDiffZ, 
+  //errCorrZ = faxn * m11 - fayn * m10
+        F32_opMul, faxn,  m11, errCorrZ, 
         F32_opMul, fayn,  m10, temp,
-        F32_opSub, errDiffZ,  temp, errDiffZ, 
-
-  //accWeight *= const_AccErrScale
-        F32_opMul, const_AccErrScale,  accWeight, accWeight,
-
-  //--------------------------------------------------------------
-  // Scale the resulting difference by the weighting factor.  This
-  // gets mixed in with the gyro values on the next update to pull
-  // the "up" part of our rotation back into alignment with gravity
-  // over time.
-  //--------------------------------------------------------------
-
-  //errCorr = errDiff * accWeight
-        F32_opMul, errDiffX,  accWeight, errCorrX,  
-        F32_opMul, errDiffY,  accWeight, errCorrY,  
-        F32_opMul, errDiffZ,  accWeight, errCorrZ,  
+        F32_opSub, errCorrZ,  temp, errCorrZ, 
 
 
   // compute heading using Atan2 and the Z vector of the orientation matrix
@@ -866,21 +898,14 @@ unsigned char QuatUpdateCommands[] = {
   //forceWY := M.Transpose().Mul(Force).y                 //Orient force vector into world frame
   //forceWY = m01*forceX + m11*forceY + m21*forceZ
 
-        F32_opMul, forceX,  m10, forceWY,  
-   
-        F32_opMul, forceY,  m11, temp,  
-        F32_opAdd, forceWY, temp, forceWY,  
-
-        F32_opMul, forceZ,  m12, temp,  
-        F32_opAdd, forceWY, temp, forceWY,  
+        F32_opDot3, forceX,  m10, forceWY,                        //forceWY = forceX*m10 + forceY*m11 + forceZ*m12
 
         F32_opSub, forceWY, const_F1, forceWY,                    //Subtract 1G (removes gravity)
 
   //forceWY *= 9.8 * 1000.0                                       //Convert to mm/sec^2
         F32_opMul, forceWY,  const_G_mm_PerSec, forceWY,
 
-        F32_opMul, forceWY,  const_UpdateScale, temp,             //temp := forceWY / UpdateRate
-        F32_opAdd, velocityEstimate,  temp, velocityEstimate,     //velEstimate += forceWY / UpdateRate
+        F32_opFMA, forceWY,  const_UpdateScale, velocityEstimate, //velEstimate += forceWY / UpdateRate
   
   
         F32_opFloat, altRate,  0, altitudeVelocity,                //AltVelocity = float(altRate)
@@ -888,19 +913,16 @@ unsigned char QuatUpdateCommands[] = {
 
   //VelocityEstimate := (VelocityEstimate * 0.9950) + (altVelocity * 0.0050)
         F32_opMul, velocityEstimate,  const_velAccScale, velocityEstimate, 
-        F32_opMul, altitudeVelocity,  const_velAltiScale, temp,  
-        F32_opAdd, velocityEstimate,  temp, velocityEstimate,   
+        F32_opFMA, altitudeVelocity,  const_velAltiScale, velocityEstimate,
 
   //altitudeEstimate += velocityEstimate / UpdateRate
-        F32_opMul, velocityEstimate,  const_UpdateScale, temp,
-        F32_opAdd, altitudeEstimate,  temp, altitudeEstimate,   
+        F32_opFMA, velocityEstimate,  const_UpdateScale, altitudeEstimate,
 
   //altitudeEstimate := (altitudeEstimate * 0.9950) * alti * 0.0050
         F32_opMul, altitudeEstimate,  const_velAccTrust, altitudeEstimate, 
 
         F32_opFloat, alt,  0, temp,                             //temp := float(alt)  (alt in mm)
-        F32_opMul, temp,  const_velAltiTrust, temp,             //temp *= 0.0050
-        F32_opAdd, altitudeEstimate,  temp, altitudeEstimate,   //altEstimate += temp 
+        F32_opFMA, temp,  const_velAltiTrust, altitudeEstimate, //altEstimate += temp * 0.0050
 
 
         F32_opTruncRound, altitudeEstimate,  const_0, AltitudeEstMM,  // output integer values for PIDs
@@ -912,154 +934,116 @@ unsigned char QuatUpdateCommands[] = {
 
 
 
-unsigned char UpdateControls_Manual[] = {
+// The control streams below are written with f32_expr.h, which turns each statement into the same
+// { F32_op, a, b, out } tuples at compile time, using temp..temp3 for intermediate values.
+
+namespace IMU_Expr {
+
+  F32_VAR(ConstNull);
+  F32_VAR(qx);  F32_VAR(qy);  F32_VAR(qz);  F32_VAR(qw);
+  F32_VAR(rx);  F32_VAR(ry);  F32_VAR(rz);  F32_VAR(rmag);
+  F32_VAR(DebugFloat);
+
+  F32_VAR(In_Elev);  F32_VAR(In_Aile);  F32_VAR(In_Rudd);
+  F32_VAR(csx);  F32_VAR(csy);  F32_VAR(csz);
+  F32_VAR(snx);  F32_VAR(sny);  F32_VAR(snz);
+  F32_VAR(snycsx);  F32_VAR(snysnx);  F32_VAR(csycsz);  F32_VAR(csysnz);
+  F32_VAR(cqw);  F32_VAR(cqx);  F32_VAR(cqy);  F32_VAR(cqz);
+  F32_VAR(qrw);  F32_VAR(qrx);  F32_VAR(qry);  F32_VAR(qrz);  F32_VAR(qrwSign);
+  F32_VAR(diffAngle);
+  F32_VAR(PitchDiff);  F32_VAR(RollDiff);  F32_VAR(YawDiff);
+  F32_VAR(Heading);
+
+  F32_VAR(const_0);  F32_VAR(const_1);
+  F32_VAR(const_F1);  F32_VAR(const_epsilon);
+  F32_VAR(const_YawRateScale);  F32_VAR(const_ManualYawScale);
+  F32_VAR(const_AutoBankScale);  F32_VAR(const_ManualBankScale);
+  F32_VAR(const_TwoPI);
+  F32_VAR(const_OutControlShift);
+
+
+unsigned char * const UpdateControls_Manual = F32_STREAM( ::temp, ::temp3,
 
   // float xrot = (float)radio.Elev * const_ManualBankScale;	// Individual scalars for channel sensitivity
   // float yrot = (float)radio.Rudd * const_ManualBankScale;
   // float zrot = (float)radio.Aile * -const_ManualBankScale;
 
-  F32_opFloat,  In_Elev, 0, In_Elev,                  // Elev to float
-  F32_opFloat,  In_Aile, 0, In_Aile,                  // Aile to float
-  F32_opFloat,  In_Rudd, 0, In_Rudd,                  // Rudd to float
+  In_Elev = Float( In_Elev ),
+  In_Aile = Float( In_Aile ),
+  In_Rudd = Float( In_Rudd ),
 
-  F32_opMul,    In_Elev, const_ManualBankScale, rx,// rx = (Elev scaled to incremental update angle)
-  F32_opMul,    In_Aile, const_ManualBankScale, rz,// rz = (Aile scaled to incremental update angle)
-  F32_opMul,    In_Rudd, const_ManualYawScale, ry, // Scale rudd by maximum yaw rate scale
-
-  F32_opNeg,    rz, 0, rz,
+  rx = In_Elev * const_ManualBankScale,               // rx = (Elev scaled to incremental update angle)
+  rz = -(In_Aile * const_ManualBankScale),            // rz = (Aile scaled to incremental update angle)
+  ry = In_Rudd * const_ManualYawScale,                // Scale rudd by maximum yaw rate scale
 
 
   // QR = CQ * Quaternion(0,rx,ry,rz)
-
   // Expands to ( * qw zero terms removed):
-  // qrx =             cqy * rz - cqz * ry + cqw * rx;
-  // qry = -cqx * rz            + cqz * rx + cqw * ry;
-  // qrz =  cqx * ry - cqy * rx            + cqw * rz;
-  // qrw = -cqx * rx - cqy * ry - cqz * rz;
-
-  // qrx =             cqy * rz - cqz * ry + cqw * rx;
-  F32_opMul,    cqy, rz, qrx,           // qrx =  cqy*rz
-  F32_opMul,    cqz, ry, temp,
-  F32_opSub,    qrx, temp, qrx,         // qrx -= cqz*ry
-  F32_opMul,    cqw, rx, temp,
-  F32_opAdd,    qrx, temp, qrx,         // qrx += cqw*rx
-
-
-  // qry = -cqx * rz            + cqz * rx + cqw * ry;
-  F32_opMul,    cqx, rz, qry,           // qry =  cqx*rz
-  F32_opNeg,    qry, 0, qry,            // qry = -qry
-  F32_opMul,    cqz, rx, temp,
-  F32_opAdd,    qry, temp, qry,         // qry += cqz*rx
-  F32_opMul,    cqw, ry, temp,
-  F32_opAdd,    qry, temp, qry,         // qry += cqw*ry
-
-
-  // qrz =  cqx * ry - cqy * rx            + cqw * rz;
-  F32_opMul,    cqx, ry, qrz,           // qrz =  cqx*ry
-  F32_opMul,    cqy, rx, temp,
-  F32_opSub,    qrz, temp, qrz,         // qrz -= cqy*rx
-  F32_opMul,    cqw, rz, temp,
-  F32_opAdd,    qrz, temp, qrz,         // qrz += cqw*rz
-
-
-  // qrw = -cqx * rx - cqy * ry - cqz * rz;
-  F32_opMul,    cqx, rx, qrw,           // qrw =  cqx*rx
-  F32_opNeg,    qrw, 0, qrw,            // qrw = -qrw
-  F32_opMul,    cqy, ry, temp,
-  F32_opSub,    qrw, temp, qrw,         // qrw -= cqy*ry
-  F32_opMul,    cqz, rz, temp,
-  F32_opSub,    qrw, temp, qrw,         // qrw -= cqz*rz
 
-  
+  qrx =               cqy * rz - cqz * ry + cqw * rx,
+  qry = -(cqx * rz)            + cqz * rx + cqw * ry,
+  qrz =    cqx * ry - cqy * rx            + cqw * rz,
+  qrw = -(cqx * rx) - cqy * ry - cqz * rz,
+
+
   // CQ = CQ + QR;
-  F32_opAdd,    cqw, qrw, cqw,          // cqw += qrw
-  F32_opAdd,    cqx, qrx, cqx,          // cqx += qrx
-  F32_opAdd,    cqy, qry, cqy,          // cqy += qry
-  F32_opAdd,    cqz, qrz, cqz,          // cqz += qrz
-  
-  
+  cqw = cqw + qrw,
+  cqx = cqx + qrx,
+  cqy = cqy + qry,
+  cqz = cqz + qrz,
+
+
   // CQ.Normalize();
-  //rmag = sqrt(cqx*cqx + cqy*cqy + cqz*cqz + cqw*cqw + 0.0000001)
-  F32_opMul, cqx,cqx, rmag,                  //rmag = cqx*cqx 
-  F32_opMul, cqy,cqy, temp,                  //temp = cqy*cqy 
-  F32_opAdd, rmag,  temp, rmag,              //rmag += temp 
-  F32_opMul, cqz,cqz, temp,                  //temp = cqz*cqz 
-  F32_opAdd, rmag,  temp, rmag,              //rmag += temp 
-  F32_opMul, cqw,cqw, temp,                  //temp = cqw*cqw 
-  F32_opAdd, rmag,  temp, rmag,              //rmag += temp 
-  F32_opAdd, rmag,  const_epsilon, rmag,     //rmag += 0.0000001 
-  F32_opSqrt, rmag,  0, rmag,                //sqrt(rmag) 
-
-  //cq /= rmag   
-  F32_opDiv, cqw,  rmag, cqw,                //cqw /= rmag 
-  F32_opDiv, cqx,  rmag, cqx,                //cqx /= rmag 
-  F32_opDiv, cqy,  rmag, cqy,                //cqy /= rmag 
-  F32_opDiv, cqz,  rmag, cqz,                //cqz /= rmag 
-  
-  0,0,0,0,
-};
+  rmag = RSqrt( cqw*cqw + cqx*cqx + cqy*cqy + cqz*cqz + const_epsilon ),
 
+  cqw = cqw * rmag,
+  cqx = cqx * rmag,
+  cqy = cqy * rmag,
+  cqz = cqz * rmag
+);
 
 
-unsigned char UpdateControlQuaternion_AutoLevel[] = {
+
+unsigned char * const UpdateControlQuaternion_AutoLevel = F32_STREAM( ::temp, ::temp3,
 
   // Convert radio inputs to float, scale them to get them into the range we want
 
-  F32_opFloat,  In_Elev, 0, In_Elev,                  // Elev to float
-  F32_opFloat,  In_Aile, 0, In_Aile,                  // Aile to float
-  F32_opFloat,  In_Rudd, 0, In_Rudd,                  // Rudd to float
+  In_Elev = Float( In_Elev ),
+  In_Aile = Float( In_Aile ),
+  In_Rudd = Float( In_Rudd ),
 
-  F32_opMul,    In_Elev, const_AutoBankScale, rx,     // rx = (Elev scaled to bank angle)
-  F32_opMul,    In_Aile, const_AutoBankScale, rz,     // rz = (Aile scaled to bank angle)
-  F32_opNeg,    rz, 0, rz,                            // rz = -rz
+  rx = In_Elev * const_AutoBankScale,                 // rx = (Elev scaled to bank angle)
+  rz = -(In_Aile * const_AutoBankScale),              // rz = (Aile scaled to bank angle)
 
-  F32_opMul,    In_Rudd, const_YawRateScale, In_Rudd, // Scale rudd by maximum yaw rate scale
-  F32_opAdd,    Heading, In_Rudd, Heading,            // Add scaled rudd to desired Heading   (may need to range check - keep in +/- PI ?)
+  Heading = Heading + In_Rudd * const_YawRateScale,   // Add scaled rudd to desired Heading
 
-  // Keep Heading in the range of -PI to PI
-  F32_opDiv,    Heading, const_TwoPI, temp,           // temp = Heading/PI
-  F32_opTruncRound, temp, const_0, temp,              // temp = (int)(Heading/PI)
-  F32_opFloat,  temp, 0, temp,                        // temp = (float)((int)(Heading/PI))
-  F32_opMul,    temp, const_TwoPI, temp,              // temp is now the integer multiple of PI in heading
-  F32_opSub,    Heading, temp, Heading,               // Remove the part that's out of range
+  // Keep Heading in the range of -PI to PI - remove the integer multiple of 2*PI
+  Heading = Heading - Float( TruncRound( Heading / const_TwoPI, const_0 ) ) * const_TwoPI,
 
 
   // Compute sines and cosines of scaled control input values
 
-  F32_opSinCos, rx, snx, csx,                         // snx = Sin(rx), csx = Cos(rx)
-  F32_opSinCos, Heading, sny, csy,                    // sny = Sin(ry), csy = Cos(ry)   (ry is heading)
-  F32_opSinCos, rz, snz, csz,                         // snz = Sin(rz), csz = Cos(rz)
+  csx = SinCos( rx, snx ),                            // snx = Sin(rx), csx = Cos(rx)
+  csy = SinCos( Heading, sny ),                       // sny = Sin(ry), csy = Cos(ry)   (ry is heading)
+  csz = SinCos( rz, snz ),                            // snz = Sin(rz), csz = Cos(rz)
 
   // Pre-compute some re-used terms to save computation time
 
-  F32_opMul,    sny, csx, snycsx,                     // snycsx = sny * csx
-  F32_opMul,    sny, snx, snysnx,                     // snysnx = sny * snx
-  F32_opMul,    csy, csz, csycsz,                     // csycsz = csy * csz
-  F32_opMul,    csy, snz, csysnz,                     // scssnz = csy * snz
+  snycsx = sny * csx,
+  snysnx = sny * snx,
+  csycsz = csy * csz,
+  csysnz = csy * snz,
 
   // Compute the quaternion that represents our new desired orientation  ((CQ = Control Quaternion))
 
-  F32_opMul,    snycsx, snz, cqx,                     // cqx =  snycsx * snz + csycsz * snx
-  F32_opMul,    csycsz, snx, temp,
-  F32_opAdd,    cqx, temp, cqx,
-
-  F32_opMul,    snycsx, csz, cqy,                     // cqy =  snycsx * csz + csysnz * snx
-  F32_opMul,    csysnz, snx, temp,
-  F32_opAdd,    cqy, temp, cqy,
+  cqx = snycsx * snz + csycsz * snx,
+  cqy = snycsx * csz + csysnz * snx,
+  cqz = csysnz * csx - snysnx * csz,
+  cqw = csycsz * csx - snysnx * snz
+);
 
-  F32_opMul,    csysnz, csx, cqz,                     // cqz = -snysnx * csz + csysnz * csx
-  F32_opMul,    snysnx, csz, temp,
-  F32_opSub,    cqz, temp, cqz,
 
-  F32_opMul,    csycsz, csx, cqw,                     // cqw = -snysnx * snz + csycsz * csx
-  F32_opMul,    snysnx, snz, temp,
-  F32_opSub,    cqw, temp, cqw,
-
-  0,0,0,0,
-};
-
-
-unsigned char UpdateControls_ComputeOrientationChange[] = {
+unsigned char * const UpdateControls_ComputeOrientationChange = F32_STREAM( ::temp, ::temp3,
 
   //---------------------------------------------------------------------------
   // Compute the quaternion which is the rotation from our current orientation (Q)
@@ -1071,66 +1055,18 @@ unsigned char UpdateControls_ComputeOrientationChange[] = {
 
   // With all the appropriate sign flips, the formula becomes:
 
-  // qrx = -cqx * qw - cqy * qz + cqz * qy + cqw * qx;
-  // qry =  cqx * qz - cqy * qw - cqz * qx + cqw * qy;
-  // qrz = -cqx * qy + cqy * qx - cqz * qw + cqw * qz;
-  // qrw =  cqx * qx + cqy * qy + cqz * qz + cqw * qw;
-
-
-
-  // qrx = -cqx * qw - cqy * qz + cqz * qy + cqw * qx;
+  qrx = -(cqx * qw) - cqy * qz + cqz * qy + cqw * qx,
+  qry =    cqx * qz - cqy * qw - cqz * qx + cqw * qy,
+  qrz = -(cqx * qy) + cqy * qx - cqz * qw + cqw * qz,
+  qrw =    cqx * qx + cqy * qy + cqz * qz + cqw * qw,
 
-  F32_opMul,    cqx, qw, qrx,           // qrx =  cqx*qw
-  F32_opNeg,    qrx, 0, qrx,            // qrx = -qrx
-  F32_opMul,    cqy, qz, temp,
-  F32_opSub,    qrx, temp, qrx,         // qrx -= cqy*qz
-  F32_opMul,    cqz, qy, temp,
-  F32_opAdd,    qrx, temp, qrx,         // qrx += cqz*qy
-  F32_opMul,    cqw, qx, temp,
-  F32_opAdd,    qrx, temp, qrx,         // qrx += cqw*qx
-
-
-  // qry =  cqx * qz - cqy * qw - cqz * qx + cqw * qy;
-
-  F32_opMul,    cqx, qz, qry,           // qry =  cqx*qz
-  F32_opMul,    cqy, qw, temp,
-  F32_opSub,    qry, temp, qry,         // qry -= cqy*qw
-  F32_opMul,    cqz, qx, temp,
-  F32_opSub,    qry, temp, qry,         // qry -= cqz*qx
-  F32_opMul,    cqw, qy, temp,
-  F32_opAdd,    qry, temp, qry,         // qry += cqw*qy
-
-  
-  // qrz = -cqx * qy + cqy * qx - cqz * qw + cqw * qz;
-
-  F32_opMul,    cqx, qy, qrz,           // qrz =  cqx*qy
-  F32_opNeg,    qrz, 0, qrz,            // qrz = -qrz
-  F32_opMul,    cqy, qx, temp,
-  F32_opAdd,    qrz, temp, qrz,         // qrz += cqy*qx
-  F32_opMul,    cqz, qw, temp,
-  F32_opSub,    qrz, temp, qrz,         // qrz -= cqz*qw
-  F32_opMul,    cqw, qz, temp,
-  F32_opAdd,    qrz, temp, qrz,         // qrz += cqw*qz
-
-
-  // qrw =  cqx * qx + cqy * qy + cqz * qz + cqw * qw;
-
-  F32_opMul,    cqx, qx, qrw,           // qrw =  cqx*qx
-  F32_opMul,    cqy, qy, temp,
-  F32_opAdd,    qrw, temp, qrw,         // qrw += cqy*qy
-  F32_opMul,    cqz, qz, temp,
-  F32_opAdd,    qrw, temp, qrw,         // qrw += cqz*qz
-  F32_opMul,    cqw, qw, temp,
-  F32_opAdd,    qrw, temp, qrw,         // qrw += cqw*qw
-
-
-  F32_opCmp,    qrw, const_0, temp,     // qrw < 0?
 
   // Conditionally negate QR if QR.w < 0
-  F32_opCNeg,   qrw, temp, qrw,
-  F32_opCNeg,   qrx, temp, qrx,
-  F32_opCNeg,   qry, temp, qry,
-  F32_opCNeg,   qrz, temp, qrz,
+  qrwSign = Cmp( qrw, const_0 ),
+  qrw = CNeg( qrw, qrwSign ),
+  qrx = CNeg( qrx, qrwSign ),
+  qry = CNeg( qry, qrwSign ),
+  qrz = CNeg( qrz, qrwSign ),
 
   // float diffAngle = qrot.ToAngleAxis( out DiffAxis );
 
@@ -1142,56 +1078,41 @@ unsigned char UpdateControls_ComputeOrientationChange[] = {
   // DiffAxis.x = qrx / rmag; // normalise axis
   // DiffAxis.y = qry / rmag;
   // DiffAxis.z = qrz / rmag;
-  
+
   // PitchDiff = DiffAxis.x * diffAngle
   // RollDiff =  DiffAxis.z * diffAngle
   // YawDiff =   DiffAxis.y * diffAngle
 
 
   // float diffAngle = 2.0f * Acos(qrw);
-  F32_opFMin,   qrw, const_F1, qrw,        // clamp qrw to -1.0 to +1.0 range
-  F32_opNeg,    qrw, 0, qrw,
-  F32_opFMin,   qrw, const_F1, qrw,        // clamp qrw to -1.0 to +1.0 range
-  F32_opNeg,    qrw, 0, qrw,
+  qrw = -FMin( -FMin( qrw, const_F1 ), const_F1 ),          // clamp qrw to -1.0 to +1.0 range (don't have FMax, so negate, use FMin, negate again)
 
-  F32_opASinCos, qrw, const_0, diffAngle,
-  F32_opShift,  diffAngle, const_1, diffAngle,         // diffAngle *= 2.0
+  diffAngle = Shift( ASinCos( qrw, const_0 ), const_1 ),    // diffAngle = acos(qrw) * 2.0
 
-  F32_opMov,    diffAngle, 0, DebugFloat,
+  DebugFloat = diffAngle,
 
-  
-  // float rmag = Sqrt( 1.0f - qrw*qrw );	  // assuming quaternion normalised then w is less than 1, so term always positive.
-  F32_opMul,    qrw, qrw, temp,
-  F32_opSub,    const_F1, temp, temp,
-
-  F32_opNeg,    temp, 0, temp,
-  F32_opFMin,   temp, 0, temp,              // make sure temp is >= 0.0 (don't have FMax, so negate, use FMin, negate again)
-  F32_opNeg,    temp, 0, temp,
-
-  F32_opSqrt,   temp, 0, rmag,
 
+  // float rmag = Sqrt( 1.0f - qrw*qrw );	  // assuming quaternion normalised then w is less than 1, so term always positive.
+  rmag = Sqrt( -FMin( -(const_F1 - qrw*qrw), ConstNull ) ),  // make sure the term is >= 0.0
 
-  // rmag = max( rmag, 0.0000001 )
-  F32_opAdd,    rmag, const_epsilon, rmag,
-  F32_opDiv,    diffAngle, rmag, rmag,        // rmag = (1.0/rmag * diffAngle)  equivalent to rmag = (diffAngle / rmag)
-  F32_opShift,  rmag, const_OutControlShift, rmag,    // rmag *= 4096
+  // rmag = max( rmag, 0.0000001 ), then rmag = (1.0/rmag * diffAngle) * 4096
+  rmag = Shift( diffAngle / (rmag + const_epsilon), const_OutControlShift ),
 
   // Simplified this a little by changing  X / rmag * diffAngle into X * (1.0/rmag * diffAngle)
   // PitchDiff = qrx / rmag * diffAngle
   // RollDiff =  qry / rmag * diffAngle
   // YawDiff =   qrz / rmag * diffAngle
 
-  F32_opMul,    qrx, rmag, PitchDiff,
-  F32_opMul,    qrz, rmag, RollDiff,
-  F32_opMul,    qry, rmag, YawDiff,
+  PitchDiff = TruncRound( qrx * rmag, const_0 ),
+  RollDiff =  TruncRound( qrz * rmag, const_0 ),
+  YawDiff =   TruncRound( qry * rmag, const_0 )
+);
 
+} // namespace IMU_Expr
 
-  F32_opTruncRound, PitchDiff, const_0, PitchDiff,
-  F32_opTruncRound, RollDiff, const_0, RollDiff,
-  F32_opTruncRound, YawDiff, const_0, YawDiff,  
-
-  0, 0, 0, 0
-};
+using IMU_Expr::UpdateControls_Manual;
+using IMU_Expr::UpdateControlQuaternion_AutoLevel;
+using IMU_Expr::UpdateControls_ComputeOrientationChange;
 
 
 
@@ -1201,21 +1122,36 @@ void QuatIMU_InitFunctions(void)
   QuatIMU_AdjustStreamPointers( UpdateControls_Manual );
   QuatIMU_AdjustStreamPointers( UpdateControlQuaternion_AutoLevel );
   QuatIMU_AdjustStreamPointers( UpdateControls_ComputeOrientationChange );
+
+#ifdef F32_PROFILE
+  F32::ProfileStream( 0, QuatUpdateCommands );
+  F32::ProfileStream( 1, UpdateControls_Manual );
+  F32::ProfileStream( 2, UpdateControlQuaternion_AutoLevel );
+  F32::ProfileStream( 3, UpdateControls_ComputeOrientationChange );
+#endif
 }
 
 
 
-void QuatIMU_Update( int * packetAddr )
+int QuatIMU_Update( int * packetAddr , int * gyroSum , int gyroSamples )
 {
   memcpy( &IMU_VARS[gx], packetAddr, 11 * sizeof(int) );
 
-  //Subtract gyro bias.  Probably better to do this in the sensor code, and ditto for accelerometer offset
+  if( gyroSum != 0 && gyroSamples > 0 ) {
+    memcpy( &IMU_VARS[gx], gyroSum, 3 * sizeof(int) );
+  }
+  else {
+    gyroSamples = 1;    // No new readings summed - use the latest one in the packet
+  }
+  ((int*)IMU_VARS)[gyroCount] = gyroSamples;
 
-  ((int*)IMU_VARS)[gx] -= zx;
-  ((int*)IMU_VARS)[gy] -= zy;
-  ((int*)IMU_VARS)[gz] -= zz;
+  //Subtract gyro bias (once per reading in the sums).  Probably better to do this in the sensor code, and ditto for accelerometer offset
 
-  F32::RunStream( QuatUpdateCommands , IMU_VARS );
+  ((int*)IMU_VARS)[gx] -= zx * gyroSamples;
+  ((int*)IMU_VARS)[gy] -= zy * gyroSamples;
+  ((int*)IMU_VARS)[gz] -= zz * gyroSamples;
+
+  return F32::RunStream( QuatUpdateCommands , IMU_VARS );
 }
 
 inline static int abs( int v )
@@ -1231,7 +1167,7 @@ static int Deadband( int v , int db )
   return 0;
 }
 
-void QuatIMU_UpdateControls( RADIO * Radio , bool ManualMode , bool AutoManual )
+int QuatIMU_UpdateControls( RADIO * Radio , bool ManualMode , bool AutoManual )
 {
   if( ManualMode & AutoManual ) {
     // Auto-manual mode behaves differently - manual control takes over at half throw, so compress
@@ -1246,6 +1182,8 @@ void QuatIMU_UpdateControls( RADIO * Radio , bool ManualMode , bool AutoManual )
   }
   ((int*)IMU_VARS)[In_Rudd] = Deadband( Radio->Rudd, 24 );
 
+  // Both streams are queued behind anything already running, so this doesn't wait for the IMU update
+
   if( ManualMode ) {
     F32::RunStream( UpdateControls_Manual , IMU_VARS );
   }
@@ -1253,8 +1191,7 @@ void QuatIMU_UpdateControls( RADIO * Radio , bool ManualMode , bool AutoManual )
     F32::RunStream( UpdateControlQuaternion_AutoLevel , IMU_VARS );
   }
 
-  F32::WaitStream();
-  F32::RunStream( UpdateControls_ComputeOrientationChange , IMU_VARS );
+  return F32::RunStream( UpdateControls_ComputeOrientationChange , IMU_VARS );
 }
 
 
@@ -1262,3 +1199,5 @@ void QuatIMU_WaitForCompletion(void)
 {
   F32::WaitStream();    // Wait for the stream to complete
 }
+
+#endif
@@ -25,6 +25,11 @@
 #include "elev8-main.h"   // for RADIO struct
 
 
+// Build the IMU with integer (fixed point) math on the calling cog (quatimu_fixed.cpp) instead of float
+// command streams on the F32 cog (quatimu.cpp).  Frees the F32 cog and its driver image.
+//#define QUATIMU_FIXED
+
+
 void QuatIMU_Start(void);
 void QuatIMU_SetErrScaleMode( int IsStartup );
 
@@ -67,8 +72,14 @@ void QuatIMU_InitFunctions(void);
 void QuatIMU_SetGyroZero( int x, int y, int z );
  
 
-void QuatIMU_Update( int * packetAddr );
-void QuatIMU_UpdateControls( RADIO * Radio , bool ManualMode , bool AutoManual );
+// These queue their streams on the F32 cog and return without waiting.  The result is the F32 stream
+// sequence number of the last one, for F32::StreamDone() / F32::WaitStream( seq ).  With QUATIMU_FIXED
+// they finish before returning, and return 0
+//
+// gyroSum is the sum of gyroSamples gyro readings taken since the last update (from Sensors_GyroSum),
+// which are averaged instead of using the single reading in the packet.  Pass 0 to use the packet reading.
+int QuatIMU_Update( int * packetAddr , int * gyroSum , int gyroSamples );
+int QuatIMU_UpdateControls( RADIO * Radio , bool ManualMode , bool AutoManual );
 
 void QuatIMU_WaitForCompletion(void);
 
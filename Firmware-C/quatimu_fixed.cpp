@@ -0,0 +1,700 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation,
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+
+  Written by Jason Dorie
+*/
+
+// Integer (fixed point) version of the QuatIMU code, used in place of quatimu.cpp when QUATIMU_FIXED
+// is defined in quatimu.h.  The math is the same as the F32 command streams in quatimu.cpp, step for
+// step, but it runs directly on the calling cog, so the F32 cog (and its ~2kb driver image) isn't needed.
+//
+// Number formats used below:
+//   Q30 - 2.30 fixed point, 1.0 == (1<<30).  Quaternions, the matrix, sines and cosines, small angles in radians
+//   Q16 - 16.16 fixed point.  Accelerations in G, the output scale factor
+//   BAM - binary angle, the whole 32 bit range is one turn (0x80000000 == PI), so angles wrap for free
+//   Altitude is mm in 24.8, vertical velocity is mm/sec in 20.12
+//
+// Use host/imu_compare.cpp to check this file against the float streams after any change.
+
+#include <propeller.h>
+
+#include "constants.h"
+#include "quatimu.h"
+
+#ifdef QUATIMU_FIXED
+
+
+#define RadToDeg (180.0 / 3.141592654)                         //Degrees per Radian
+#define GyroToDeg  (1000.0 / 70.0)                             //Gyro units per degree @ 2000 deg/sec sens = 70 mdps/bit
+#define GyroScale  (GyroToDeg * RadToDeg * (float)Const_UpdateRate)
+
+#define PI  3.141592654
+
+#define ONE         (1 << 30)                                  // 1.0 in Q30
+#define RateShift   38                                         // Manual control rates are radians per stick unit in Q38
+#define RateScale   ((float)(1LL << RateShift))
+#define BAMPerRad   (2147483648.0f / (float)PI)
+
+const int GyroToRad       = (int)((float)ONE / GyroScale * 65536.0f + 0.5f);  // Gyro units to Q30 radians per update, in Q16
+
+const int Startup_ErrScale = ONE / 32;          // Converge quickly on startup
+const int Running_ErrScale = ONE / 512;         // Converge more slowly once up & running
+
+const int VelPerG         = (int)(9.80665f * 1000.0f / (float)Const_UpdateRate * 4096.0f + 0.5f);  // 1G for one update, in mm/sec 20.12
+const int VelAltiScale    = (int)(0.0005f * (float)ONE + 0.5f);   // Used to generate the vertical velocity estimate
+const int AltiTrust       = (int)(0.0007f * (float)ONE + 0.5f);   // Used to generate the absolute altitude estimate
+const int AltPerVel       = ONE / (Const_UpdateRate * 16);         // velocity 20.12 / UpdateRate -> altitude 24.8
+
+const int ThrustMin       = ONE >> 6;           // Clamp m11 so the thrust factor stays within +/- 16384 (about 89 degrees of tilt)
+
+
+static int  zx, zy, zz;                          // Gyro zero readings
+
+static int  qx, qy, qz, qw;                      // Body orientation quaternion (Q30)
+static int  m[3][3];                             // Body orientation as a 3x3 matrix (Q30)
+
+static int  errCorrX, errCorrY, errCorrZ;        // computed rotation correction factor (Q30 radians)
+static int  prx, pry, prz;                       // Previous update's gyro rotation / 12, for the coning correction (Q30 radians)
+
+static int  accRollCorrSin, accRollCorrCos;      // used to correct the accelerometer vector angle offset (Q30)
+static int  accPitchCorrSin, accPitchCorrCos;
+static int  AccErrScale;                         // How much accelerometer to fuse in each update (Q30)
+
+static int  Yaw, HalfYaw;                        // Current heading (BAM), and half of it for quaternion construction
+static int  Pitch, Roll;                         // Current pitch and roll, scaled units (65536 == PI)
+static int  ThrustFactor;                        // 256 / m11, scale factor for thrust
+
+static int  velocityEstimate;                    // mm/sec, 20.12
+static int  altitudeEstimate;                    // mm, 24.8
+static int  AltitudeEstMM, VelocityEstMM;
+
+static int  ManualBankScale, ManualYawScale;     // radians per stick unit (Q38), half-angle
+static int  AutoBankScale, YawRateScale;         // BAM per stick unit << 8, half-angle
+
+static unsigned int Heading;                     // Desired heading half-angle for auto-level (BAM)
+static int  cqx, cqy, cqz, cqw;                  // Control Quaternion (Q30)
+static int  DiffHalfAngle;                       // Half the rotation between Q and CQ (Q30 radians)
+static int  PitchDiff, RollDiff, YawDiff;        // Difference between current orientation and desired, scaled outputs
+
+static float FloatQ[4], FloatM[9];               // Float copies for the getters that hand out float pointers
+
+
+
+// CORDIC rotation angles, atan( 2^-i ) as BAM
+static const int CordicAngle[30] = {
+  536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+  2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861,
+  10430, 5215, 2608, 1304, 652, 326, 163, 81,
+  41, 20, 10, 5, 3, 1 };
+
+#define CordicGain  652032874                    // Product of the CORDIC stage lengths, inverted (0.60725 in Q30)
+
+
+// Q30 multiply using only 32 bit products - the Propeller has no multiply instruction, and a full 64 bit
+// product is much slower.  Works for any a and b where the result fits in 32 bits, and rounds to nearest, so
+// there's no bias to build up in the values that are integrated every update (the altitude estimate)
+static int Mul30( int a, int b )
+{
+  int ah = a >> 16, bh = b >> 16;
+  int al = a & 0xffff, bl = b & 0xffff;
+  int frac = ((ah * bl) >> 1) + ((al * bh) >> 1) + (int)(((unsigned int)al * (unsigned int)bl) >> 17);
+  return ((ah * bh) << 2) + ((frac + 0x1000) >> 13);
+}
+
+// a / b, rounded to nearest (b > 0)
+static int Div( int a, int b )
+{
+  return (a >= 0) ? (a + (b >> 1)) / b : -((-a + (b >> 1)) / b);
+}
+
+// (a * b) >> shift, rounded, with a 64 bit intermediate.  Used for the few products that need the range.
+static int MulShift( int a, int b, int shift )
+{
+  return (int)(((long long)a * b + (1LL << (shift-1))) >> shift);
+}
+
+static unsigned int ISqrt( unsigned long long v )
+{
+  unsigned long long r = 0, bit = 1ULL << 62;
+
+  while( bit > v ) bit >>= 2;
+  while( bit ) {
+    if( v >= r + bit ) {
+      v -= r + bit;
+      r = (r >> 1) + bit;
+    }
+    else
+      r >>= 1;
+    bit >>= 2;
+  }
+  return (unsigned int)r;
+}
+
+// Sine and cosine of a BAM angle, both Q30
+static void SinCos( int a, int * s, int * c )
+{
+  int x = CordicGain, y = 0;
+  int flip = 0;
+
+  // CORDIC only converges within about +/- 99 degrees, so rotate the other half of the circle by PI first
+  if( (a ^ (a << 1)) < 0 ) {
+    a = (int)((unsigned int)a + 0x80000000u);
+    flip = 1;
+  }
+
+  for( int i=0; i<30; i++ ) {
+    int dx = x >> i, dy = y >> i;
+    if( a >= 0 ) { x -= dy;  y += dx;  a -= CordicAngle[i]; }
+    else         { x += dy;  y -= dx;  a += CordicAngle[i]; }
+  }
+
+  *s = flip ? -y : y;
+  *c = flip ? -x : x;
+}
+
+// ATan2 of two Q30 values, result as BAM
+static int ATan2( int y, int x )
+{
+  unsigned int a = 0;
+
+  x >>= 1;  y >>= 1;                             // CORDIC grows the vector by 1.65x, so make room
+  if( x < 0 ) {
+    x = -x;  y = -y;                             // Rotate into the right half plane
+    a = 0x80000000u;
+  }
+
+  for( int i=0; i<30; i++ ) {
+    int dx = x >> i, dy = y >> i;
+    if( y > 0 ) { x += dy;  y -= dx;  a += CordicAngle[i]; }
+    else        { x -= dy;  y += dx;  a -= CordicAngle[i]; }
+  }
+  return (int)a;
+}
+
+static int ASin( int v )
+{
+  if( v > ONE ) v = ONE;
+  if( v < -ONE ) v = -ONE;
+  return ATan2( v, ISqrt( (1ULL << 60) - (long long)v * v ) );
+}
+
+// Scale a quaternion to unit length.  They're always close already, so two Newton steps of
+// r = r * (3 - n*r*r) / 2, starting from r = 1, replace the 1/Sqrt() the float version uses
+static void Normalize( int * w, int * x, int * y, int * z )
+{
+  int n = Mul30(*w,*w) + Mul30(*x,*x) + Mul30(*y,*y) + Mul30(*z,*z);
+  int r = ONE;
+
+  r += Mul30( r, (ONE - Mul30( n, Mul30(r,r) )) >> 1 );
+  r += Mul30( r, (ONE - Mul30( n, Mul30(r,r) )) >> 1 );
+
+  *w = Mul30( *w, r );
+  *x = Mul30( *x, r );
+  *y = Mul30( *y, r );
+  *z = Mul30( *z, r );
+}
+
+inline static int abs( int v )
+{
+  return (v < 0) ? -v : v;
+}
+
+static int ToFixed( float f, float scale )
+{
+  f *= scale;
+  return (int)(f < 0.0f ? f - 0.5f : f + 0.5f);
+}
+
+static float ToFloat( int v, int shift )
+{
+  return (float)v * (1.0f / (float)(1 << shift));
+}
+
+
+
+void QuatIMU_Start(void)
+{
+  zx = zy = zz = 0;
+
+  qx = qy = qz = 0;
+  qw = ONE;
+  memset( m, 0, sizeof(m) );
+  errCorrX = errCorrY = errCorrZ = 0;
+  prx = pry = prz = 0;
+
+  accRollCorrSin = 0;                            // used to correct the accelerometer vector angle offset
+  accRollCorrCos = ONE;
+  accPitchCorrSin = 0;
+  accPitchCorrCos = ONE;
+
+  AccErrScale = Startup_ErrScale;
+
+  Yaw = HalfYaw = Pitch = Roll = ThrustFactor = 0;
+  velocityEstimate = altitudeEstimate = 0;
+  AltitudeEstMM = VelocityEstMM = 0;
+
+  Heading = 0;
+  cqx = cqy = cqz = cqw = 0;
+  DiffHalfAngle = PitchDiff = RollDiff = YawDiff = 0;
+
+  AutoBankScale   = ToFixed( (45.0f / 1024.0f) * (PI/180.0f) * 0.5f, BAMPerRad * 256.0f );
+  YawRateScale    = ToFixed( ((120.0f / (float)Const_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f, BAMPerRad * 256.0f );  // 120 deg/sec / UpdateRate * Deg2Rad * HalfAngle
+  ManualBankScale = ToFixed( ((120.0f / (float)Const_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f, RateScale );
+  ManualYawScale  = ToFixed( ((180.0f / (float)Const_UpdateRate) / 1024.0f) * (PI/180.f) * 0.5f, RateScale );
+}
+
+
+void QuatIMU_SetErrScaleMode( int IsStartup )
+{
+  AccErrScale = IsStartup ? Startup_ErrScale : Running_ErrScale;
+}
+
+
+
+int QuatIMU_GetYaw(void) {
+  return (Yaw + (1<<14)) >> 15;
+}
+
+int QuatIMU_GetRoll(void) {
+  return Roll;
+}
+
+int QuatIMU_GetPitch(void) {
+  return Pitch;
+}
+
+int QuatIMU_GetThrustFactor(void) {
+  return ThrustFactor;
+}
+
+float * QuatIMU_GetMatrix(void) {
+  for( int i=0; i<9; i++ )
+    FloatM[i] = ToFloat( m[i/3][i%3], 30 );
+  return FloatM;
+}
+
+float * QuatIMU_GetQuaternion(void) {
+  FloatQ[0] = ToFloat( qx, 30 );
+  FloatQ[1] = ToFloat( qy, 30 );
+  FloatQ[2] = ToFloat( qz, 30 );
+  FloatQ[3] = ToFloat( qw, 30 );
+  return FloatQ;
+}
+
+int QuatIMU_GetVerticalVelocityEstimate(void) {
+  return VelocityEstMM;
+}
+
+int QuatIMU_GetAltitudeEstimate(void) {
+  return AltitudeEstMM;
+}
+
+void QuatIMU_SetInitialAltitudeGuess( int altiMM )
+{
+  altitudeEstimate = altiMM << 8;
+}
+
+int QuatIMU_GetPitchDifference(void) {
+  return PitchDiff;
+}
+
+int QuatIMU_GetRollDifference(void) {
+  return RollDiff;
+}
+
+int QuatIMU_GetYawDifference(void) {
+  return YawDiff;
+}
+
+
+void QuatIMU_SetAutoLevelRates( float MaxRollPitch , float YawRate )
+{
+  AutoBankScale = ToFixed( MaxRollPitch, BAMPerRad * 256.0f );
+  YawRateScale  = ToFixed( YawRate, BAMPerRad * 256.0f );
+}
+
+void QuatIMU_SetManualRates( float RollPitchRate, float YawRate )
+{
+  ManualBankScale = ToFixed( RollPitchRate, RateScale );
+  ManualYawScale  = ToFixed( YawRate, RateScale );
+}
+
+
+void QuatIMU_ResetDesiredYaw(void)
+{
+  Heading = HalfYaw;           // Desired value = current computed value half-angle
+}
+
+
+void QuatIMU_ResetDesiredOrientation(void)
+{
+  cqw = qw;
+  cqx = qx;
+  cqy = qy;
+  cqz = qz;
+}
+
+
+float QuatIMU_GetFloatYaw(void)
+{
+  return (float)Yaw * (float)(PI / 2147483648.0);
+}
+
+float QuatIMU_GetFloatHeading(void)
+{
+  return (float)(int)Heading * (float)(PI / 2147483648.0);
+}
+
+
+void QuatIMU_GetDesiredQ( float * dest )
+{
+  dest[0] = ToFloat( cqx, 30 );
+  dest[1] = ToFloat( cqy, 30 );
+  dest[2] = ToFloat( cqz, 30 );
+  dest[3] = ToFloat( cqw, 30 );
+}
+
+void QuatIMU_GetDebugFloat( float * dest )
+{
+  dest[0] = ToFloat( DiffHalfAngle, 29 );        // diffAngle, 2 * the half angle
+}
+
+void QuatIMU_SetRollCorrection( float * addr )
+{
+  accRollCorrSin = ToFixed( addr[0], (float)ONE );
+  accRollCorrCos = ToFixed( addr[1], (float)ONE );
+}
+
+void QuatIMU_SetPitchCorrection( float * addr )
+{
+  accPitchCorrSin = ToFixed( addr[0], (float)ONE );
+  accPitchCorrCos = ToFixed( addr[1], (float)ONE );
+}
+
+
+void QuatIMU_SetGyroZero( int x, int y, int z )
+{
+  zx = x;
+  zy = y;
+  zz = z;
+}
+
+
+
+// Same order as the float version - see QuatUpdateCommands in quatimu.cpp for the derivation of each step
+
+int QuatIMU_Update( int * packetAddr , int * gyroSum , int gyroSamples )
+{
+  int ax = packetAddr[3], ay = packetAddr[4], az = packetAddr[5];
+  int alt = packetAddr[9], altRate = packetAddr[10];
+
+  if( gyroSum == 0 || gyroSamples <= 0 ) {
+    gyroSum = packetAddr;   // No new readings summed - use the latest one in the packet
+    gyroSamples = 1;
+  }
+  int gx = gyroSum[0] - zx * gyroSamples, gy = gyroSum[1] - zy * gyroSamples, gz = gyroSum[2] - zz * gyroSamples;
+
+  //--------------------------------------------------------------
+  // Average the gyro readings and convert the rates to radians
+  //--------------------------------------------------------------
+
+  int rx = MulShift(  gx, GyroToRad, 16 );
+  int ry = MulShift( -gz, GyroToRad, 16 );
+  int rz = MulShift( -gy, GyroToRad, 16 );
+
+  if( gyroSamples > 1 ) {
+    rx = Div( rx, gyroSamples );
+    ry = Div( ry, gyroSamples );
+    rz = Div( rz, gyroSamples );
+  }
+
+  //--------------------------------------------------------------
+  // Coning correction (pr x r), then add in the previous cycle error corrections
+  //--------------------------------------------------------------
+
+  int conex = Mul30(pry,rz) - Mul30(prz,ry);
+  int coney = Mul30(prz,rx) - Mul30(prx,rz);
+  int conez = Mul30(prx,ry) - Mul30(pry,rx);
+
+  prx = Mul30( rx, ONE/12 );
+  pry = Mul30( ry, ONE/12 );
+  prz = Mul30( rz, ONE/12 );
+
+  rx += conex + errCorrX;
+  ry += coney + errCorrY;
+  rz += conez + errCorrZ;
+
+
+  //--------------------------------------------------------------
+  // Update the orientation quaternion
+  //--------------------------------------------------------------
+
+  // rmag is half the rotation angle, and small enough that a short series gives cos(rmag) and sin(rmag)/rmag
+  // directly from rmag^2, so there's no Sqrt, Sin, Cos, or divide here
+  int r2 = (Mul30(rx,rx) + Mul30(ry,ry) + Mul30(rz,rz)) >> 2;
+
+  int cosr = ONE - Mul30( r2, ONE/2 - Mul30( r2, ONE/24 - Mul30( r2, ONE/720 ) ) );
+  int sinr = ONE - Mul30( r2, ONE/6 - Mul30( r2, ONE/120 - Mul30( r2, ONE/5040 ) ) );
+
+  int qdw = -(Mul30(rx,qx) + Mul30(ry,qy) + Mul30(rz,qz)) >> 1;
+  int qdx =  (Mul30(rx,qw) + Mul30(rz,qy) - Mul30(ry,qz)) >> 1;
+  int qdy =  (Mul30(ry,qw) - Mul30(rz,qx) + Mul30(rx,qz)) >> 1;
+  int qdz =  (Mul30(rz,qw) + Mul30(ry,qx) - Mul30(rx,qy)) >> 1;
+
+  qw = Mul30(cosr,qw) + Mul30(sinr,qdw);
+  qx = Mul30(cosr,qx) + Mul30(sinr,qdx);
+  qy = Mul30(cosr,qy) + Mul30(sinr,qdy);
+  qz = Mul30(cosr,qz) + Mul30(sinr,qdz);
+
+  Normalize( &qw, &qx, &qy, &qz );
+
+
+  //--------------------------------------------------------------
+  //Now convert the updated quaternion to a rotation matrix
+  //--------------------------------------------------------------
+
+  int fx2 = Mul30(qx,qx), fy2 = Mul30(qy,qy), fz2 = Mul30(qz,qz);
+  int fwx = Mul30(qw,qx), fwy = Mul30(qw,qy), fwz = Mul30(qw,qz);
+  int fxy = Mul30(qx,qy), fxz = Mul30(qx,qz), fyz = Mul30(qy,qz);
+
+  // 1.0 - 2.0 * (a + b) is done as two subtracts, because 2.0 * (a + b) can reach 2.0, which doesn't fit
+  m[0][0] = (ONE - (fy2 + fz2)) - (fy2 + fz2);
+  m[0][1] = (fxy - fwz) << 1;
+  m[0][2] = (fxz + fwy) << 1;
+
+  m[1][0] = (fxy + fwz) << 1;
+  m[1][1] = (ONE - (fx2 + fz2)) - (fx2 + fz2);
+  m[1][2] = (fyz - fwx) << 1;
+
+  m[2][0] = (fxz - fwy) << 1;
+  m[2][1] = (fyz + fwx) << 1;
+  m[2][2] = (ONE - (fx2 + fy2)) - (fx2 + fy2);
+
+
+  //--------------------------------------------------------------
+  // Get the accelerometer vector in G, correct the orientation by any
+  // user specified rotation offset
+  //--------------------------------------------------------------
+
+  int fax = -ax * (65536 / Const_OneG);          // Acceleration in X (left/right)
+  int fay =  az * (65536 / Const_OneG);          // Acceleration in Y (up/down)
+  int faz =  ay * (65536 / Const_OneG);          // Acceleration in Z (toward/away)
+
+  int axRot = Mul30(fax, accRollCorrCos) - Mul30(fay, accRollCorrSin);
+  int ayRot = Mul30(fax, accRollCorrSin) + Mul30(fay, accRollCorrCos);
+  fax = axRot;
+  fay = ayRot;
+
+  axRot = Mul30(faz, accPitchCorrCos) - Mul30(fay, accPitchCorrSin);
+  ayRot = Mul30(faz, accPitchCorrSin) + Mul30(fay, accPitchCorrCos);
+  faz = axRot;
+  fay = ayRot;
+
+
+  //--------------------------------------------------------------
+  // Compute length of the accelerometer vector and use it to decide
+  // weighting - if it's too long/short, weight it less.
+  //--------------------------------------------------------------
+
+  int rmag = ISqrt( (long long)fax*fax + (long long)fay*fay + (long long)faz*faz );    // Q16
+
+  //accWeight = 1.0 - FMin( FAbs( 2.0 - accLen * 2.0 ), 1.0 )
+  int accWeight = (2 << 16) - (rmag << 1);
+  if( accWeight < 0 ) accWeight = -accWeight;
+  if( accWeight > (1 << 16) ) accWeight = 1 << 16;
+  accWeight = Mul30( ((1 << 16) - accWeight) << 14, AccErrScale );     // Q30
+
+
+  // Normalize the accelerometer vector and scale it by the weighting factor in one step
+  int temp = rmag ? (int)(((long long)accWeight << 16) / rmag) : 0;
+
+  int faxn = MulShift( fax, temp, 16 );          // Q30
+  int fayn = MulShift( fay, temp, 16 );
+  int fazn = MulShift( faz, temp, 16 );
+
+
+  //--------------------------------------------------------------
+  // Cross the weighted accelerometer vector with our current "up"
+  // vector to get the correction to mix in on the next update
+  //--------------------------------------------------------------
+
+  errCorrX = Mul30(fayn, m[1][2]) - Mul30(fazn, m[1][1]);
+  errCorrY = Mul30(fazn, m[1][0]) - Mul30(faxn, m[1][2]);
+  errCorrZ = Mul30(faxn, m[1][1]) - Mul30(fayn, m[1][0]);
+
+
+  // compute heading using Atan2 and the Z vector of the orientation matrix
+  Yaw = -ATan2( m[2][0], m[2][2] );
+  HalfYaw = Yaw >> 1;
+
+  // Compute pitch and roll in integer form, used by compass calibration, possible user code
+  Pitch =  ((ASin( m[1][2] ) + (1<<14)) >> 15);
+  Roll  = -((ASin( m[1][0] ) + (1<<14)) >> 15);
+
+  // 1.0/m11 = scale factor for thrust, * 256
+  int m11 = m[1][1];
+  if( m11 > -ThrustMin && m11 < ThrustMin ) m11 = (m11 < 0) ? -ThrustMin : ThrustMin;
+  m11 >>= 8;                                     // 256.0 / m11 == 1.0 / (m11 / 256)
+  ThrustFactor = (ONE + (abs(m11) >> 1)) / m11;
+
+
+  //--------------------------------------------------------------
+  // Compute the running height estimate - this is a fusion of the
+  // height computed directly from barometric pressure, and and
+  // running estimate of vertical velocity computed from the
+  // accelerometer, integrated to produce a height estimate.
+  //--------------------------------------------------------------
+
+  //forceWY = forceX*m10 + forceY*m11 + forceZ*m12 - 1G     (force in world frame, minus gravity)
+  int forceWY = Mul30(fax, m[1][0]) + Mul30(fay, m[1][1]) + Mul30(faz, m[1][2]) - (1 << 16);
+
+  velocityEstimate += MulShift( forceWY, VelPerG, 16 );                           //velEstimate += forceWY / UpdateRate
+  velocityEstimate += Mul30( (altRate << 12) - velocityEstimate, VelAltiScale );  //blend in the altimeter rate
+
+  altitudeEstimate += Mul30( velocityEstimate, AltPerVel );                       //altitudeEstimate += velocityEstimate / UpdateRate
+  altitudeEstimate += Mul30( (alt << 8) - altitudeEstimate, AltiTrust );          //blend in the altimeter
+
+  AltitudeEstMM = (altitudeEstimate + (1 << 7)) >> 8;
+  VelocityEstMM = (velocityEstimate + (1 << 11)) >> 12;
+
+  return 0;
+}
+
+
+
+// Maps an input from (-N .. 0 .. +N) to output zero when the absolute input value is < db, removes the range from the output so it doesn't pop
+static int Deadband( int v , int db )
+{
+  if( v > db ) return v - db;
+  if( v < -db ) return v + db;
+  return 0;
+}
+
+
+static void UpdateControls_Manual( int In_Elev, int In_Aile, int In_Rudd )
+{
+  int rx =  MulShift( In_Elev, ManualBankScale, RateShift - 30 );    // rx = (Elev scaled to incremental update angle)
+  int rz = -MulShift( In_Aile, ManualBankScale, RateShift - 30 );    // rz = (Aile scaled to incremental update angle)
+  int ry =  MulShift( In_Rudd, ManualYawScale, RateShift - 30 );     // Scale rudd by maximum yaw rate scale
+
+  // QR = CQ * Quaternion(0,rx,ry,rz)
+  int qrx =                  Mul30(cqy,rz) - Mul30(cqz,ry) + Mul30(cqw,rx);
+  int qry = -Mul30(cqx,rz)                 + Mul30(cqz,rx) + Mul30(cqw,ry);
+  int qrz =  Mul30(cqx,ry) - Mul30(cqy,rx)                 + Mul30(cqw,rz);
+  int qrw = -Mul30(cqx,rx) - Mul30(cqy,ry) - Mul30(cqz,rz);
+
+  // CQ = CQ + QR;
+  cqw += qrw;
+  cqx += qrx;
+  cqy += qry;
+  cqz += qrz;
+
+  Normalize( &cqw, &cqx, &cqy, &cqz );
+}
+
+
+static void UpdateControlQuaternion_AutoLevel( int In_Elev, int In_Aile, int In_Rudd )
+{
+  int rx =  MulShift( In_Elev, AutoBankScale, 8 );       // rx = (Elev scaled to bank angle)
+  int rz = -MulShift( In_Aile, AutoBankScale, 8 );       // rz = (Aile scaled to bank angle)
+
+  Heading += MulShift( In_Rudd, YawRateScale, 8 );       // Add scaled rudd to desired Heading (wraps at +/- PI by itself)
+
+  // Compute sines and cosines of scaled control input values
+  int csx, csy, csz, snx, sny, snz;
+  SinCos( rx, &snx, &csx );
+  SinCos( (int)Heading, &sny, &csy );
+  SinCos( rz, &snz, &csz );
+
+  // Pre-compute some re-used terms to save computation time
+  int snycsx = Mul30(sny, csx);
+  int snysnx = Mul30(sny, snx);
+  int csycsz = Mul30(csy, csz);
+  int csysnz = Mul30(csy, snz);
+
+  // Compute the quaternion that represents our new desired orientation  ((CQ = Control Quaternion))
+  cqx = Mul30(snycsx, snz) + Mul30(csycsz, snx);
+  cqy = Mul30(snycsx, csz) + Mul30(csysnz, snx);
+  cqz = Mul30(csysnz, csx) - Mul30(snysnx, csz);
+  cqw = Mul30(csycsz, csx) - Mul30(snysnx, snz);
+}
+
+
+static void UpdateControls_ComputeOrientationChange(void)
+{
+  // QR = CQ.Conjugate() * Q, the rotation from our current orientation (Q) to our desired one (CQ)
+
+  int qrx = -Mul30(cqx,qw) - Mul30(cqy,qz) + Mul30(cqz,qy) + Mul30(cqw,qx);
+  int qry =  Mul30(cqx,qz) - Mul30(cqy,qw) - Mul30(cqz,qx) + Mul30(cqw,qy);
+  int qrz = -Mul30(cqx,qy) + Mul30(cqy,qx) - Mul30(cqz,qw) + Mul30(cqw,qz);
+  int qrw =  Mul30(cqx,qx) + Mul30(cqy,qy) + Mul30(cqz,qz) + Mul30(cqw,qw);
+
+  // Negate QR if QR.w < 0, so it goes the short way around
+  if( qrw < 0 ) {
+    qrw = -qrw;  qrx = -qrx;  qry = -qry;  qrz = -qrz;
+  }
+  if( qrw > ONE ) qrw = ONE;
+
+  // half angle = acos(qrw), and rmag = sin(half angle) = Sqrt( 1.0 - qrw*qrw )
+  int rmag = ISqrt( (1ULL << 60) - (long long)qrw * qrw );
+  DiffHalfAngle = Mul30( ATan2( rmag, qrw ), (int)(PI / 2.0 * ONE) );    // BAM to Q30 radians
+
+  // scale = diffAngle / rmag, in Q16.  Tends to 2.0 as the angle goes to zero
+  int scale = rmag ? (int)(((long long)DiffHalfAngle << 17) / rmag) : (2 << 16);
+
+  // PitchDiff = qrx / rmag * diffAngle * 4096
+  PitchDiff = MulShift( qrx, scale, 30 + 16 - 12 );
+  RollDiff  = MulShift( qrz, scale, 30 + 16 - 12 );
+  YawDiff   = MulShift( qry, scale, 30 + 16 - 12 );
+}
+
+
+int QuatIMU_UpdateControls( RADIO * Radio , bool ManualMode , bool AutoManual )
+{
+  int In_Elev, In_Aile, In_Rudd;
+
+  if( ManualMode & AutoManual ) {
+    // Auto-manual mode behaves differently - manual control takes over at half throw, so compress
+    // the range of manual into the other half of the range so the manual part feels less twitchy
+
+    In_Elev = Deadband( Radio->Elev, 485 ) << 1;
+    In_Aile = Deadband( Radio->Aile, 485 ) << 1;
+  }
+  else {
+    In_Elev = Deadband( Radio->Elev, 24 );
+    In_Aile = Deadband( Radio->Aile, 24 );
+  }
+  In_Rudd = Deadband( Radio->Rudd, 24 );
+
+  if( ManualMode ) {
+    UpdateControls_Manual( In_Elev, In_Aile, In_Rudd );
+  }
+  else {
+    UpdateControlQuaternion_AutoLevel( In_Elev, In_Aile, In_Rudd );
+  }
+
+  UpdateControls_ComputeOrientationChange();
+  return 0;
+}
+
+
+void QuatIMU_WaitForCompletion(void)
+{
+  // Everything above runs on the calling cog, so it's already done
+}
+
+#endif
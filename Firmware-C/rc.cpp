@@ -25,12 +25,37 @@
 
 static const int Scale = 80/2; // System clock frequency in Mhz, halved - we're converting outputs to 1/2 microsecond resolution
 
+// How each radio channel is made from the raw pulse widths:  (*Source - Offset) * Scale / 65536
+// The PPM driver reads these after every frame, so the layout has to match rc_driver_ppm.spin
+struct CHANNELMAP {
+  long * Source;    // Raw pulse width this channel comes from
+  long   Offset;    // Pulse width, in clocks, that comes out as 0
+  long   Scale;     // Multiplier, in 1/65536ths
+};
+
 static struct {
   long Pins[8];
   long PinMask;
+  CHANNELMAP Map[8];
+  short Radio[9];   // Normalized channels, in RADIO order (Aux4 is SBUS only, so it stays 0)
 } data;
 
-static char Cog;
+static char Cog, NormalizeHere;
+static long LastPins[8];
+
+
+static short Normalize( const CHANNELMAP & m )
+{
+  return (*m.Source - m.Offset) * m.Scale / 65536;    // Rounds toward zero, same as the PPM driver
+}
+
+static void NormalizeAll(void)
+{
+  for( int i=0; i<8; i++ ) {
+    LastPins[i] = *data.Map[i].Source;
+    data.Radio[i] = Normalize( data.Map[i] );
+  }
+}
 
 void RC::Start(char UsePPM)
 {
@@ -38,6 +63,11 @@ void RC::Start(char UsePPM)
   for( int i=1; i<8; i++ ) {
     data.Pins[i] = Scale * 3000;   // All other values are centered
   }
+  NormalizeAll();
+
+  // The PWM driver times edges on all 8 pins at once, and never has a quiet moment to do the channel
+  // math without throwing off a pulse, so for PWM it's done in GetRadio(), only for the pins that changed
+  NormalizeHere = !UsePPM;
 
   if( UsePPM ) {
     data.PinMask = PIN_RC_0_MASK;   // Elev8-FC pins are defined in pins.h
@@ -79,6 +109,33 @@ int RC::GetRC(int _pin) {
 	return data.Pins[_pin] / Scale - 3000; // Get pulse width from Pins[..], convert to uSec, make 0 center
 }
 
+void RC::SetChannelMap( const char * ChannelIndex , const short * ChannelCenter , const short * ChannelScale )
+{
+  // Normalized = (Pins[Index] / Scale - 3000 - Center) * ChannelScale / 1024, done as a single multiply on the
+  // pulse width in clocks, so the drivers don't need to divide.  The multiplier is rounded to the nearest
+  // 1/65536, so a reading can come out a count or two different than dividing first.
+  for( int i=0; i<8; i++ ) {
+    data.Map[i].Source = &data.Pins[ ChannelIndex[i] & 7 ];
+    data.Map[i].Offset = Scale * (3000 + ChannelCenter[i]);
+    data.Map[i].Scale = (ChannelScale[i] * 8 + (ChannelScale[i] < 0 ? -2 : 2)) / 5;   // ChannelScale * 65536 / (40 * 1024), rounded
+  }
+  NormalizeAll();
+}
+
+const short * RC::GetRadio(void)
+{
+  if( NormalizeHere ) {
+    for( int i=0; i<8; i++ ) {
+      if( *data.Map[i].Source != LastPins[i] ) {
+        LastPins[i] = *data.Map[i].Source;
+        data.Radio[i] = Normalize( data.Map[i] );
+      }
+    }
+  }
+  return data.Radio;
+}
+
+
 //int RC::Channel( int _pin ) {
 //	return data.Pins[_pin] / Scale;
 //}
@@ -30,6 +30,13 @@ public:
   //static int  Get(int _pin);
   static int  GetRC(int _pin);
   //static int  Channel(int _pin);
+
+  // Tells the driver which input feeds each radio channel, and the center and scale to apply to it -
+  // call this before Start()
+  static void SetChannelMap( const char * ChannelIndex , const short * ChannelCenter , const short * ChannelScale );
+
+  // The normalized channels, in RADIO order, updated by the driver as each frame comes in
+  static const short * GetRadio(void);
 };
 
 #endif
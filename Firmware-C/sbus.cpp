@@ -25,13 +25,36 @@
 
 static char Cog;
 
+// How each radio channel is made from the raw channels:  (*Source - Offset) * Scale / 1024
+// The drivers read these after every frame, so the layout has to match sbus_driver.spin and remote_rx_driver.spin
+struct CHANNELMAP {
+  short * Source;   // Raw channel this one comes from
+  long    Offset;   // Raw value that comes out as 0
+  long    Scale;    // Multiplier, in 1/1024ths
+};
+
 static struct DATA {
   long  InputMask;
   long  BaudDelay;
   short Channels[18];  //Last two channels are digital
+  CHANNELMAP Map[9];
+  short Radio[9];      // Normalized channels, in RADIO order
 } data;
 
 
+static short Normalize( const CHANNELMAP & m )
+{
+  return (*m.Source - m.Offset) * m.Scale / 1024;    // Rounds toward zero, same as the drivers
+}
+
+static void NormalizeAll(void)
+{
+  for( int i=0; i<9; i++ ) {
+    data.Radio[i] = Normalize( data.Map[i] );
+  }
+}
+
+
 void SBUS::Start( int InputPin , bool UseRemoteRX )
 {
   data.InputMask = 1 << InputPin;
@@ -40,6 +63,7 @@ void SBUS::Start( int InputPin , bool UseRemoteRX )
   for( int i=1; i<18; i++ ) {
     data.Channels[i] = 1024;     // All other channels are centered
   }
+  NormalizeAll();
 
   if( UseRemoteRX == false )
   {
@@ -68,3 +92,23 @@ void SBUS::Stop(void)
 short SBUS::GetRC( int i ) {
   return data.Channels[i] - 1024;
 }
+
+void SBUS::SetChannelMap( const char * ChannelIndex , const short * ChannelCenter , const short * ChannelScale )
+{
+  for( int i=0; i<8; i++ ) {
+    data.Map[i].Source = &data.Channels[ ChannelIndex[i] & 15 ];
+    data.Map[i].Offset = 1024 + ChannelCenter[i];
+    data.Map[i].Scale = ChannelScale[i];
+  }
+
+  // Extra raw channel for SBUS users, tuning, experimentation
+  data.Map[8].Source = &data.Channels[8];   // Aux4
+  data.Map[8].Offset = 1024 - 32;
+  data.Map[8].Scale = 1280;
+
+  NormalizeAll();
+}
+
+const short * SBUS::GetRadio(void) {
+  return data.Radio;
+}
@@ -0,0 +1,40 @@
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+  
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation, 
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+  
+  Written by Jason Dorie
+*/
+
+#include <propeller.h>
+#include "sched.h"
+
+
+void Sched_Run( SCHED_TASK * Tasks, int Count, int Loop )
+{
+  for( int i=0; i<Count; i++ )
+  {
+    SCHED_TASK & t = Tasks[i];
+    if( (Loop & (t.Period-1)) != t.Phase ) continue;
+
+    int start = CNT;
+    t.Func();
+    int cycles = CNT - start;
+
+    t.Runs++;
+    if( cycles > t.MaxCycles ) t.MaxCycles = cycles;
+    if( cycles > t.Budget ) t.Overruns++;
+  }
+}
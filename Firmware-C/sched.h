@@ -0,0 +1,51 @@
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+/*
+  This file is part of the ELEV-8 Flight Controller Firmware
+  for Parallax part #80204, Revision A
+  
+  Copyright 2015 Parallax Incorporated
+
+  ELEV-8 Flight Controller Firmware is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free Software Foundation, 
+  either version 3 of the License, or (at your option) any later version.
+
+  ELEV-8 Flight Controller Firmware is distributed in the hope that it will be useful, but 
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the ELEV-8 Flight Controller Firmware.  If not, see <http://www.gnu.org/licenses/>.
+  
+  Written by Jason Dorie
+*/
+
+/*
+  Sched - Rate group scheduler for the main loop
+
+  Each task runs once every Period loops (a power of 2), on a fixed Phase within that period.
+  Giving tasks in the same rate group different phases spreads the sub-rate work out over the
+  loop iterations, so it doesn't all land on the same one.  Every run is timed with CNT - the
+  longest run is kept, and runs that take longer than the task's Budget are counted.
+*/
+
+typedef void (*SCHED_FUNC)(void);
+
+struct SCHED_TASK {
+  SCHED_FUNC Func;
+  unsigned char Period;     // Run every Period loops - must be a power of 2
+  unsigned char Phase;      // Which loop within the period to run on, 0 to Period-1
+  int  Budget;              // Cycles the task should take at most
+
+  int  MaxCycles;           // Longest run since it was last taken for telemetry
+  unsigned short Runs;      // Running counts (they wrap)
+  unsigned short Overruns;  // Runs that went over Budget
+};
+
+#define SCHED_TASK_DEF( Func, Period, Phase, Budget )   { Func, Period, Phase, Budget, 0, 0, 0 }
+
+
+void Sched_Run( SCHED_TASK * Tasks, int Count, int Loop );   // Runs the tasks that are due on loop number 'Loop'
+
+#endif
@@ -42,13 +42,14 @@
 
 
 static struct DATA {
-  int  ins[Sensors_ParamsCount];  //Temp, GX, GY, GZ, AX, AY, AZ, MX, MY, MZ, Alt, AltRate, AltTemp, Pressure, Timer
+  int  ins[Sensors_ParamsCount];  //Temp, GX, GY, GZ, AX, AY, AZ, MX, MY, MZ, Alt, AltRate, AltTemp, Pressure, GyroSum XYZ, GyroSamples, Timer
   int  DriftScale[3];
   int  DriftOffset[3];            //These values will be altered in the EEPROM by the Config Tool and Propeller Eeprom code                       
   int  AccelOffset[3];
   int  MagOffsetX, MagScaleX, MagOffsetY, MagScaleY, MagOffsetZ, MagScaleZ;
 } data;
 
+static int GyroSumPrev[4];     // Gyro sums and count as of the last Sensors_GyroSum call
 static int DriftBackup[6];
 static int AccelBackup[3];
 static int MagBackup[6];
@@ -120,6 +121,28 @@ int * Sensors_Address(void)
   return &data.ins[0];
 }
 
+int Sensors_GyroSum( int * dest )
+{
+  // Sum of the gyro readings taken since the last call, in dest[0..2].  Returns how many readings are in the sums.
+  // The sensor cog reads the gyro several times per flight loop - this lets the IMU use all of them, not just the latest
+  int * src = (int *)&((SENS *)&data.ins[0])->GyroSumX;
+  int sum[4];
+
+  // The sensor cog may be part way through writing these, so read them until two copies match
+  do {
+    memcpy( sum, src, sizeof(sum) );
+  } while( memcmp( sum, src, sizeof(sum) ) != 0 );
+
+  for( int i=0; i<3; i++ ) {
+    dest[i] = sum[i] - GyroSumPrev[i];    // Differences of the running sums, so wrap around doesn't matter
+  }
+  int count = sum[3] - GyroSumPrev[3];
+
+  memcpy( GyroSumPrev, sum, sizeof(sum) );
+  return count;
+}
+
+
 void Sensors_TempZeroDriftValues(void)
 {
   //Temporarily back up the values so we can restore them with "ResetDriftValues"
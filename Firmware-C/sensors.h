@@ -28,6 +28,7 @@ void Sensors_Stop(void);
 
 int Sensors_In(int channel);
 int* Sensors_Address(void);
+int Sensors_GyroSum( int * dest );
 
 void Sensors_TempZeroDriftValues(void);
 void Sensors_ResetDriftValues(void);
@@ -48,6 +49,8 @@ struct SENS {
   long MagX, MagY, MagZ;          // Magnetometer readings
   long Alt, AltRate;              // Computed altimeter height (mm) and rate (mm/sec)
   long AltTemp, Pressure;         // Altimeter temperature and pressure
+  long GyroSumX, GyroSumY, GyroSumZ;  // Running sums of every gyro reading (free running, wrap around)
+  long GyroSamples;               // Running count of the gyro readings in the sums
   long SensorTime;                //How long sensors took to read (debug / optimization test value)
 };
 
@@ -59,9 +59,9 @@
 //       1) Associating the same pin with both Tx and Rx channels has undefined results
 //       2) Rx and Tx buffers must not overlap and must be at least two bytes in size;
 //          other than the limits of available memory there is no upper bound on their sizes 
-//       3) Framing and overrun errors are not detected. Overruns of the receive buffer 
-//          simply over write previously received data
-//       4) Put operations, with the exception of Can_Put are blocking. They will not 
+//       3) Framing errors (no stop bit) and overruns (a byte arriving when the receive buffer
+//          is full) are counted for each port. A byte that overruns the buffer is dropped
+//       4) Put operations, with the exception of Can_Put and Try_Put_Bytes are blocking. They will not 
 //          return until their data has been buffered for output. Put_Bytes buffers data
 //          to the greatest extent possible and may be called with a Count that is greater
 //          than the buffer size.
@@ -84,6 +84,11 @@
 //                 Reduced latency receiver
 //                 Stopped shifting in stop bit
 //                 Reduced latency of transmitter
+// Elev8         Receivers count overruns and framing errors, and drop a byte that would
+//                 overrun the buffer (this adds a hub read and a wait for the stop bit
+//                 to each received byte)
+//               Added Try_Put_Bytes, which drops what won't fit and counts it, and
+//                 Reserve / Commit for writing straight into the transmit buffer
 //____________________________________________________________________________________________
 //
 // Data structures:
@@ -150,10 +155,16 @@ struct S4_COGVARS {
   int            TxM[4];                   // Tx pin masks
   int            TPB[4];                   // Ticks per bit
   int            SO[4];                    // Sample offsets in ticks
+  int*           Rx_EI_Ref[4];             // Pointers to Rx extraction indices
+  volatile int*  Rx_OE_Ref[4];             // Pointers to Rx overrun counts
+  volatile int*  Rx_FE_Ref[4];             // Pointers to Rx framing error counts
+  volatile int   Rx_OE[4];                 // Rx overrun counts
+  volatile int   Rx_FE[4];                 // Rx framing error counts
 };
 
 static S4_COGVARS * cv;
 static char cog;
+static int  Tx_Dropped[4];                 // Writes Try_Put_Bytes / Try_Reserve dropped because they didn't fit
 
 
 void S4_Initialize(void)
@@ -179,10 +190,14 @@ void S4_Initialize(void)
     cv->Rx_II_Ref[N] = &(cv->Rx_II[N]);
     cv->Tx_II_Ref[N] = &(cv->Tx_II[N]);
     cv->Tx_EI_Ref[N] = &(cv->Tx_EI[N]);
+    cv->Rx_EI_Ref[N] = &(cv->Rx_EI[N]);
+    cv->Rx_OE_Ref[N] = &(cv->Rx_OE[N]);
+    cv->Rx_FE_Ref[N] = &(cv->Rx_FE[N]);
+    Tx_Dropped[N] = 0;
   }
 }
 
-void S4_Define_Port(char The_Port, int The_Baud, char The_TxP, char * The_TxB, char The_TxS, char The_RxP, char * The_RxB, char The_RxS)
+void S4_Define_Port(char The_Port, int The_Baud, char The_TxP, char * The_TxB, int The_TxS, char The_RxP, char * The_RxB, int The_RxS)
 {
 int The_TPB;
 
@@ -278,7 +293,7 @@ void S4_Put_Unsafe(char The_Port, char The_Byte)
 char S4_Can_Put(char The_Port, int The_Count)
 {
   int BC = cv->Tx_EI[The_Port] - cv->Tx_II[The_Port] - 1;
-  if(BC <= 0)
+  if(BC < 0)                                           // A full buffer is 0, not TxS
     BC = BC + cv->TxS[The_Port];
 
   return(BC >= The_Count);
@@ -318,6 +333,70 @@ void S4_Put_Bytes(char The_Port, void * The_Bytes, int The_Count)
   }
 }
 
+char S4_Try_Put_Bytes(char The_Port, void * The_Bytes, int The_Count)
+{
+  if( !S4_Can_Put(The_Port, The_Count) ) {
+    Tx_Dropped[The_Port]++;
+    return 0;
+  }
+
+  S4_Put_Bytes(The_Port, The_Bytes, The_Count);        // Won't wait - there's room for all of it
+  return 1;
+}
+
+
+static void Span(char The_Port, int The_Count, S4_SPAN * The_Span)
+{
+  int Size = cv->TxS[The_Port];
+  int I = cv->Tx_II[The_Port];
+
+  int C = min((Size - I), The_Count);                  // C = bytes before the end of the buffer
+  The_Span->Ptr[0] = cv->TxB[The_Port] + I;
+  The_Span->Count[0] = C;
+  The_Span->Ptr[1] = cv->TxB[The_Port];
+  The_Span->Count[1] = The_Count - C;                  // The rest wraps to the start - often none
+}
+
+int S4_Reserve(char The_Port, int The_Count, S4_SPAN * The_Span)
+{
+  The_Count = min(The_Count, cv->TxS[The_Port] - 1);   // Never more than the buffer can hold
+
+  while( !S4_Can_Put(The_Port, The_Count) )            // Wait for room
+    ;
+
+  Span(The_Port, The_Count, The_Span);
+  return The_Count;
+}
+
+char S4_Try_Reserve(char The_Port, int The_Count, S4_SPAN * The_Span)
+{
+  if( !S4_Can_Put(The_Port, The_Count) ) {
+    Tx_Dropped[The_Port]++;
+    return 0;
+  }
+
+  Span(The_Port, The_Count, The_Span);
+  return 1;
+}
+
+
+void S4_Commit(char The_Port, int The_Count)
+{
+  int N = cv->Tx_II[The_Port] + The_Count;
+  if( N >= cv->TxS[The_Port] )
+    N -= cv->TxS[The_Port];
+
+  cv->Tx_II[The_Port] = N;                             // The driver can send the bytes now
+}
+
+//__________________________________________________________________________________
+//
+// Error counts - running totals since S4_Initialize
+//
+int S4_Tx_Dropped(char The_Port)  { return Tx_Dropped[The_Port]; }
+int S4_Rx_Overruns(char The_Port) { return cv->Rx_OE[The_Port]; }
+int S4_Rx_Framing(char The_Port)  { return cv->Rx_FE[The_Port]; }
+
 //__________________________________________________________________________________
 //
 // The Receive primitives
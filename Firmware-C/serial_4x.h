@@ -71,7 +71,7 @@ void S4_Initialize(void);
 // RxB   The address of the receive buffer
 // RxS   The size, in bytes, of the receive buffer
 
-void S4_Define_Port(char The_Port, int The_Baud, char The_TxP, char * The_TxB, char The_TxS, char The_RxP, char * The_RxB, char The_RxS);
+void S4_Define_Port(char The_Port, int The_Baud, char The_TxP, char * The_TxB, int The_TxS, char The_RxP, char * The_RxB, int The_RxS);
     
 void S4_Start(void);
 void S4_Stop(void);
@@ -85,8 +85,35 @@ void S4_Flush_Output(char The_Port);
 
 void S4_Put(char The_Port, char The_Byte);
 void S4_Put_Unsafe(char The_Port, char The_Byte);
-char S4_Can_Put(char The_Port, char The_Count);
+char S4_Can_Put(char The_Port, int The_Count);
 void S4_Put_Bytes(char The_Port, void * The_Bytes, int The_Count);
+char S4_Try_Put_Bytes(char The_Port, void * The_Bytes, int The_Count);   // All of it, or nothing (counted as dropped) - never waits
+
+
+// Reserve / Commit - write straight into the transmit buffer
+//
+// S4_Reserve waits until there is room for The_Count bytes (or for as much as the buffer can ever hold,
+// if The_Count is more than that) and returns how many bytes it reserved.  The_Span says where they
+// go - the second part is at the start of the buffer, when the space wraps around the end.  Nothing is
+// sent until S4_Commit is called with the number of bytes written, so the driver never sees a partial
+// packet.  Only one reservation per port can be outstanding.
+
+struct S4_SPAN {
+  char * Ptr[2];
+  int    Count[2];
+};
+
+int  S4_Reserve(char The_Port, int The_Count, S4_SPAN * The_Span);
+char S4_Try_Reserve(char The_Port, int The_Count, S4_SPAN * The_Span);  // Doesn't wait - 0 (counted as dropped) if there's no room for all of it
+void S4_Commit(char The_Port, int The_Count);
+
+
+// Error counts, running totals for each port: writes the Try_ functions dropped, received bytes dropped
+// because the receive buffer was full, and received bytes with no stop bit
+
+int  S4_Tx_Dropped(char The_Port);
+int  S4_Rx_Overruns(char The_Port);
+int  S4_Rx_Framing(char The_Port);
 
 
 // The Receive primitives
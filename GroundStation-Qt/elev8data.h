@@ -50,14 +50,17 @@ public:
 class MotorData
 {
 public:
-    short FL, FR, BR, BL;	// front-left, front-right, back-right, back-left motor outputs
+    short Motor[8];		// motor outputs, in the order the frame type's mixer uses (quad X is FL, FR, BR, BL)
+    int   Count;		// how many the frame type uses - the FC only sends those
+    int   FrameType;	// frame the FC's mixer is running - quad X if the board can't drive the one in the prefs
 
     void ReadFrom( packet * p )
     {
-        FL = p->GetShort();
-        FR = p->GetShort();
-        BR = p->GetShort();
-        BL = p->GetShort();
+        Count = (p->data.length() - 4) / 2;	// payload, minus the frame type and the checksum
+        if( Count > 8 ) Count = 8;
+        for( int i=0; i<Count; i++ )
+            Motor[i] = p->GetShort();
+        FrameType = p->GetShort();
     }
 };
 
@@ -102,6 +105,85 @@ public:
 };
 
 
+// Cycle counts from the F32 cog, only sent by firmware built with F32_PROFILE.
+// All values are running totals that wrap, so the differences between two packets are what matter.
+class F32ProfileData
+{
+public:
+    quint32 OpCycles[32];			// indexed by F32 op number
+    quint32 StreamRuns[4];			// QuatUpdate, Manual, AutoLevel, ComputeOrientationChange
+    quint32 StreamCycles[4];
+
+    void ReadFrom( packet * p )
+    {
+        for( int i=0; i<32; i++ ) OpCycles[i] = (quint32)p->GetInt();
+        for( int i=0; i<4; i++ ) StreamRuns[i] = (quint32)p->GetInt();
+        for( int i=0; i<4; i++ ) StreamCycles[i] = (quint32)p->GetInt();
+    }
+};
+
+
+// Serial port error counts, for ports 0 (USB) to 3: packets the flight controller dropped because the
+// port's transmit buffer was full, received bytes dropped because the receive buffer was full, and
+// received bytes with no stop bit.  Then the blackbox frames the flight controller didn't log (ENABLE_LOGGING
+// builds only).  Running totals since power up, wrapping at 16 bits.
+class LinkData
+{
+public:
+    quint16 TxDropped[4];
+    quint16 RxOverruns[4];
+    quint16 RxFraming[4];
+    quint16 BlackboxDropped;
+
+    void ReadFrom( packet * p )
+    {
+        for( int i=0; i<4; i++ ) TxDropped[i] = (quint16)p->GetShort();
+        for( int i=0; i<4; i++ ) RxOverruns[i] = (quint16)p->GetShort();
+        for( int i=0; i<4; i++ ) RxFraming[i] = (quint16)p->GetShort();
+        BlackboxDropped = (quint16)p->GetShort();
+    }
+};
+
+
+// Update loop timing for one phase of the loop (see LoopTimingNames in mainwindow.cpp for the order), and the
+// run stats of one of the scheduler's sub-rate tasks (TaskNames).
+// Counts is a log2 histogram of the cycles the phase took - bucket 0 is under 128 cycles, bucket n is
+// 2^(n+6) up to 2^(n+7), and the last bucket is everything above that.  Counts, Overruns, TaskRuns and
+// TaskOverruns are running totals that wrap, so the differences between two packets are what matter.
+class LoopTimingData
+{
+public:
+    short Phase;
+    quint16 Overruns;			// loops that ran past their time slot
+    int MaxCycles;				// longest this phase took since its last packet
+    quint16 Counts[16];
+
+    short Task;
+    short TaskPeriod;			// loops between runs
+    quint16 TaskRuns;
+    quint16 TaskOverruns;		// runs that took longer than TaskBudget
+    int TaskBudget;				// cycles
+    int TaskMaxCycles;			// longest run since this task's last packet
+    int LoopCycles;				// clock cycles in one update loop
+
+    void ReadFrom( packet * p )
+    {
+        Phase = p->GetShort();
+        Overruns = (quint16)p->GetShort();
+        MaxCycles = p->GetInt();
+        for( int i=0; i<16; i++ ) Counts[i] = (quint16)p->GetShort();
+
+        Task = p->GetShort();
+        TaskPeriod = p->GetShort();
+        TaskRuns = (quint16)p->GetShort();
+        TaskOverruns = (quint16)p->GetShort();
+        TaskBudget = p->GetInt();
+        TaskMaxCycles = p->GetInt();
+        LoopCycles = p->GetInt();
+    }
+};
+
+
 class ComputedData
 {
 public:
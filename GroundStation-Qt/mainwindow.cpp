@@ -10,6 +10,23 @@ static char beatString[] = "BEAT";
 
 AHRS ahrs;
 
+// Where each motor output is shown for each frame type - the bar (0 to 3 are the left column, top to
+// bottom, 4 to 7 the right column) and its label.  The outputs are in the order the firmware mixer uses.
+struct MotorLayout {
+	int count;
+	int slot[8];
+	const char * name[8];
+};
+
+static const MotorLayout MotorLayouts[] = {
+	{ 4, { 0, 4, 7, 3 },					{ "FL", "FR", "BR", "BL" } },								// Quad X
+	{ 4, { 0, 4, 7, 3 },					{ "F", "R", "B", "L" } },									// Quad +
+	{ 6, { 0, 4, 5, 7, 3, 1 },				{ "FL", "FR", "R", "BR", "BL", "L" } },						// Hex X
+	{ 8, { 0, 4, 5, 6, 7, 3, 2, 1 },		{ "FL", "FR", "RF", "RB", "BR", "BL", "LB", "LF" } },		// Octo X
+	{ 6, { 0, 4, 3, 1, 5, 7 },				{ "FLt", "FRt", "Bt", "FLb", "FRb", "Bb" } },				// Y6 (top, bottom)
+};
+
+
 MainWindow::MainWindow(QWidget *parent) :
 	QMainWindow(parent),
     ui(new Ui::MainWindow)
@@ -19,6 +36,7 @@ MainWindow::MainWindow(QWidget *parent) :
 	CalibrateTimer = 0;
 	RadioMode = 2;		// Mode 2 by default - check to see if there's a config file with a different setting
 	currentMode = None;
+	sensorPeriod = 8;
 
     ui->setupUi(this);
 
@@ -101,24 +119,29 @@ MainWindow::MainWindow(QWidget *parent) :
 
 	InternalChange = true;
 
-    ui->motor_FL_val->setFromLeft(false);
-    ui->motor_BL_val->setFromLeft(false);
-
-    ui->motor_FL_val->setMinMax( 8000, 16000 );
-    ui->motor_FL_val->setLeftLabel( "FL" );
-    ui->motor_FL_val->setBarColor( QColor::fromRgb(255,160,128) );
-
-    ui->motor_FR_val->setMinMax( 8000, 16000 );
-    ui->motor_FR_val->setRightLabel( "FR" );
-    ui->motor_FR_val->setBarColor( QColor::fromRgb(255,160,128) );
-
-    ui->motor_BR_val->setMinMax( 8000, 16000 );
-    ui->motor_BR_val->setRightLabel( "BR" );
-    ui->motor_BR_val->setBarColor( QColor::fromRgb(255,160,128) );
+    // Motor bars - the four corners are in the form, and there are two more in each column for the frames
+    // with more than four motors.  SetMotorLayout() shows the ones the frame type uses.
+    motorBars[0] = ui->motor_FL_val;
+    motorBars[3] = ui->motor_BL_val;
+    motorBars[4] = ui->motor_FR_val;
+    motorBars[7] = ui->motor_BR_val;
+    for( int i=1; i<3; i++ ) {
+        motorBars[i] = new ValueBar_Widget( ui->motor_FL_val->parentWidget() );
+        motorBars[i]->setSizePolicy( ui->motor_FL_val->sizePolicy() );
+        ui->verticalLayout_3->insertWidget( i, motorBars[i] );
+
+        motorBars[4+i] = new ValueBar_Widget( ui->motor_FR_val->parentWidget() );
+        motorBars[4+i]->setSizePolicy( ui->motor_FR_val->sizePolicy() );
+        ui->verticalLayout_2->insertWidget( i, motorBars[4+i] );
+    }
 
-    ui->motor_BL_val->setMinMax( 8000, 16000 );
-    ui->motor_BL_val->setLeftLabel( "BL" );
-    ui->motor_BL_val->setBarColor( QColor::fromRgb(255,160,128) );
+    for( int i=0; i<8; i++ ) {
+        motorBars[i]->setFromLeft( i >= 4 );    // The left column fills in from the right
+        motorBars[i]->setMinMax( 8000, 16000 );
+        motorBars[i]->setBarColor( QColor::fromRgb(255,160,128) );
+    }
+    fcFrameType = -1;
+    SetMotorLayout( 0 );
 
     ui->btnMotorTest_FL->setStyleSheet( style );
     ui->btnMotorTest_FR->setStyleSheet( style );
@@ -176,6 +199,12 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->cbReceiverType->addItem(QString("PPM"));
 	ui->cbReceiverType->addItem(QString("RemoteRX"));
 
+	ui->cbFrameType->addItem(QString("Quad X"));
+	ui->cbFrameType->addItem(QString("Quad +"));
+	ui->cbFrameType->addItem(QString("Hex X"));
+	ui->cbFrameType->addItem(QString("Octo X"));
+	ui->cbFrameType->addItem(QString("Y6"));
+
 	ui->cbArmingDelay->addItem(QString("1.00 sec"));
 	ui->cbArmingDelay->addItem(QString("0.50 sec"));
 	ui->cbArmingDelay->addItem(QString("0.25 sec"));
@@ -234,6 +263,9 @@ MainWindow::MainWindow(QWidget *parent) :
 
 	SampleIndex = 0;
 	SamplesWrapped = 0;
+	f32ProfileValid = false;
+	loopCycles = 0;
+	ResetLoopTiming();
 
 	sg = ui->sensorGraph;
 	sg->legend->setVisible(true);
@@ -333,6 +365,7 @@ void MainWindow::timerEvent(QTimerEvent * e)
 	{
 		Heartbeat = 0;
 		SendCommand( beatString );	// Send the connection heartbeat
+		SendSubscription();			// The heartbeat resets the telemetry rates on a new connection
 	}
 
 	ProcessPackets();
@@ -379,6 +412,34 @@ void MainWindow::SendCommand( QString command )
     comm.Send( (quint8*)arr.constData(), arr.length() );
 }
 
+// Ask for the telemetry the current tab shows, as loops between packets (250 loops a second) for each
+// stream, 0 for streams we don't need.  The order matches the Stream_ enum in the firmware's comms.h.
+// The flight controller slows them all down if they add up to more than the link can carry.
+void MainWindow::SendSubscription(void)
+{
+	static const quint8 allStreams[9]    = {  8,  8,  8,  8,  8,  8,  8,  8,  8 };
+	static const quint8 sensorStreams[9] = { 32, 32,  2,  0,  8,  0,  8,  0,  0 };	// 125Hz sensors for the graphs
+	static const quint8 calibStreams[9]  = { 32, 32,  4,  0,  0,  0,  0,  0,  0 };
+	static const quint8 timingStreams[9] = { 32, 32,  0,  2,  0,  0,  0,  0, 32 };	// F32 profile comes in the timing stream
+
+	const quint8 * periods = allStreams;
+	QWidget * tab = ui->tabWidget->currentWidget();
+
+	if( tab == ui->tpSensors ) {
+		periods = sensorStreams;
+	}
+	else if( tab == ui->tpGyroCalib || tab == ui->tpAccelCalib ) {
+		periods = calibStreams;
+	}
+	else if( tab == ui->tpLoopTiming || tab == ui->tpF32Profile ) {
+		periods = timingStreams;
+	}
+
+	sensorPeriod = periods[2];
+	SendCommand( "Subs" );
+	comm.Send( (quint8*)periods, 9 );
+}
+
 void MainWindow::SetRadioMode(int mode)
 {
 	if( mode != 1 && mode != 2 ) return;
@@ -441,6 +502,9 @@ void MainWindow::ProcessPackets(void)
     bool bMotorsChanged = false;
     bool bComputedChanged = false;
     bool bPrefsChanged = false;
+    bool bF32ProfileChanged = false;
+    bool bLinkChanged = false;
+    bool bLoopTimingChanged = false;
 
     packet * p;
     do {
@@ -470,7 +534,7 @@ void MainWindow::ProcessPackets(void)
 					AddGraphSample( 8, sensors.MagZ );
 					AddGraphSample( 9, sensors.Temp );
 
-					ahrs.Update( sensors , (1.0/250.f) * 8.0f , false );
+					ahrs.Update( sensors , (1.0/250.f) * (float)sensorPeriod , false );
 
 					bSensorsChanged = true;
                     break;
@@ -535,6 +599,51 @@ void MainWindow::ProcessPackets(void)
                     bDebugChanged = true;
                     break;
 
+                case 8:	// F32 profile (profiling firmware only)
+                    f32ProfilePrev = f32Profile;
+                    f32Profile.ReadFrom( p );
+                    bF32ProfileChanged = f32ProfileValid;	// need two packets to work out the rates
+                    f32ProfileValid = true;
+                    break;
+
+                case 9:	// Loop timing, one phase of the update loop per packet
+                    {
+                        LoopTimingData lt;
+                        lt.ReadFrom( p );
+                        loopCycles = lt.LoopCycles;
+                        if( lt.Phase < 0 || lt.Phase > 8 ) break;
+
+                        LoopTimingData & prev = loopTimingPrev[lt.Phase];
+                        if( loopTimingValid[lt.Phase] ) {	// the counts are running totals, so add up the differences
+                            for( int i=0; i<16; i++ ) {
+                                loopTimingCounts[lt.Phase][i] += (quint16)(lt.Counts[i] - prev.Counts[i]);
+                            }
+                            loopTimingMax[lt.Phase] = qMax( loopTimingMax[lt.Phase], lt.MaxCycles );
+                        }
+                        if( lt.Phase == 7 ) {
+                            if( loopTimingValid[7] ) loopOverruns += (quint16)(lt.Overruns - prev.Overruns);
+                            bLoopTimingChanged = true;
+                        }
+                        prev = lt;
+                        loopTimingValid[lt.Phase] = true;
+
+                        if( lt.Task < 0 || lt.Task > 8 ) break;
+                        LoopTimingData & tprev = taskPrev[lt.Task];
+                        if( taskValid[lt.Task] ) {
+                            taskRuns[lt.Task] += (quint16)(lt.TaskRuns - tprev.TaskRuns);
+                            taskOverruns[lt.Task] += (quint16)(lt.TaskOverruns - tprev.TaskOverruns);
+                            taskMax[lt.Task] = qMax( taskMax[lt.Task], lt.TaskMaxCycles );
+                        }
+                        tprev = lt;
+                        taskValid[lt.Task] = true;
+                    }
+                    break;
+
+                case 10:	// Serial port error counts
+                    linkData.ReadFrom( p );
+                    bLinkChanged = true;
+                    break;
+
                 case 0x18:	// Settings
 					{
 						PREFS tempPrefs;
@@ -650,17 +759,21 @@ void MainWindow::ProcessPackets(void)
 
     if( bMotorsChanged )
     {
-        ui->motor_FL_val->setValue( motors.FL );
-		ui->motor_FL_val->setRightLabel( motors.FL/8 );
-
-        ui->motor_FR_val->setValue( motors.FR );
-		ui->motor_FR_val->setLeftLabel( motors.FR/8 );
-
-        ui->motor_BR_val->setValue( motors.BR );
-		ui->motor_BR_val->setLeftLabel( motors.BR/8 );
+        if( motors.FrameType != fcFrameType ) {
+            fcFrameType = motors.FrameType;
+            SetMotorLayout( fcFrameType );		// The bars show what the FC is running, not what the prefs say
+        }
 
-        ui->motor_BL_val->setValue( motors.BL );
-		ui->motor_BL_val->setRightLabel( motors.BL/8 );
+        const MotorLayout & layout = MotorLayouts[motorLayout];
+        for( int i=0; i<motors.Count && i<layout.count; i++ )
+        {
+            ValueBar_Widget * bar = motorBars[ layout.slot[i] ];
+            bar->setValue( motors.Motor[i] );
+            if( layout.slot[i] < 4 )
+                bar->setRightLabel( motors.Motor[i]/8 );
+            else
+                bar->setLeftLabel( motors.Motor[i]/8 );
+        }
     }
 
     if(bQuatChanged) {
@@ -792,6 +905,21 @@ void MainWindow::ProcessPackets(void)
 			"CPU time (uS): %1 (min), %2 (max), %3 (avg)" ).arg( debugData.MinCycles * 64/80 ).arg( debugData.MaxCycles * 64/80 ).arg( debugData.AvgCycles * 64/80 ) );
     }
 
+    if( bF32ProfileChanged ) {
+        UpdateF32Profile();
+    }
+
+    if( bLoopTimingChanged ) {
+        UpdateLoopTiming();
+    }
+
+    if( bLinkChanged ) {
+        ui->lblLinkErrors->setText( QString( "Serial dropped / overruns / framing:  USB %1 / %2 / %3   XBee %4 / %5 / %6   Blackbox frames dropped: %7" )
+            .arg( linkData.TxDropped[0] ).arg( linkData.RxOverruns[0] ).arg( linkData.RxFraming[0] )
+            .arg( linkData.TxDropped[1] ).arg( linkData.RxOverruns[1] ).arg( linkData.RxFraming[1] )
+            .arg( linkData.BlackboxDropped ) );
+    }
+
     if( bComputedChanged ) {
         ui->Altimeter_display->setAltitude( computed.AltiEst / 1000.0f );
 
@@ -817,6 +945,46 @@ void MainWindow::ProcessPackets(void)
     }
 }
 
+void MainWindow::SetMotorLayout( int frameType )
+{
+	if( frameType < 0 || frameType >= (int)(sizeof(MotorLayouts) / sizeof(MotorLayouts[0])) )
+		frameType = 0;
+	motorLayout = frameType;
+
+	const MotorLayout & layout = MotorLayouts[frameType];
+	for( int i=0; i<8; i++ )
+		motorBars[i]->setVisible( false );
+
+	for( int i=0; i<layout.count; i++ )
+	{
+		ValueBar_Widget * bar = motorBars[ layout.slot[i] ];
+		bar->setVisible( true );
+		if( layout.slot[i] < 4 ) {
+			bar->setLeftLabel( layout.name[i] );
+			bar->setRightLabel( "" );
+		}
+		else {
+			bar->setRightLabel( layout.name[i] );
+			bar->setLeftLabel( "" );
+		}
+	}
+	UpdateFrameTypeLabel();
+}
+
+void MainWindow::UpdateFrameTypeLabel(void)
+{
+	// The FC only reads the frame type at power up, and runs quad X (and won't arm) if the board doesn't have the
+	// outputs for the one in the prefs - say which it's running when that isn't the one shown
+	if( fcFrameType < 0 || fcFrameType == prefs.FrameType ) {
+		ui->labelFrameType->setText( "Frame Type" );
+		ui->labelFrameType->setStyleSheet( "" );
+	}
+	else {
+		ui->labelFrameType->setText( QString( "Frame Type (FC: %1)" ).arg( ui->cbFrameType->itemText( fcFrameType ) ) );
+		ui->labelFrameType->setStyleSheet( "QLabel { color : red; }" );
+	}
+}
+
 void MainWindow::TestMotor(int index)
 {
     if(comm.Connected())
@@ -841,12 +1009,169 @@ void MainWindow::CancelThrottleCalibration(void)
 	ThrottleCalibrationCycle = 0;
 }
 
+// Percentage of the update loop the given cycles take - blank until the FC has sent how long a loop is
+static QString LoopLoad( double cycles, int loopCycles )
+{
+	if( loopCycles <= 0 ) return QString();
+	return QString::number( cycles / loopCycles * 100.0, 'f', 1 );
+}
+
+void MainWindow::UpdateF32Profile(void)
+{
+	static const char * streamNames[4] = { "IMU update", "Manual controls", "Auto-level controls", "Orientation change" };
+	static const char * opNames[32] = {
+		"", "Add", "Sub", "Mul", "Div", "Float", "TruncRound", "Sqrt", "Cmp", "Sin", "Cos", "Tan", "Log2", "Exp2", "Pow", "ASinCos",
+		"ATan2", "Shift", "Neg", "SinCos", "FAbs", "FMin", "Frac", "CNeg", "Mov", "RunStream", "FMA", "Dot3", "Dot4", "RSqrt", "RunQueue", "" };
+
+	// Every cycle count is per IMU update, which runs once per loop
+	quint32 updates = f32Profile.StreamRuns[0] - f32ProfilePrev.StreamRuns[0];
+	if( updates == 0 ) return;
+
+	QTableWidget * t = ui->tblF32Profile;
+	t->setRowCount(0);
+
+	quint32 streamTotal = 0;
+	for( int i=0; i<4; i++ ) {
+		quint32 runs = f32Profile.StreamRuns[i] - f32ProfilePrev.StreamRuns[i];
+		quint32 cycles = f32Profile.StreamCycles[i] - f32ProfilePrev.StreamCycles[i];
+		if( runs == 0 ) continue;
+
+		streamTotal += cycles;
+
+		int row = t->rowCount();
+		t->insertRow( row );
+		t->setItem( row, 0, new QTableWidgetItem( streamNames[i] ) );
+		t->setItem( row, 1, new QTableWidgetItem( QString::number( cycles / updates ) ) );
+		t->setItem( row, 2, new QTableWidgetItem( LoopLoad( (double)cycles / updates, loopCycles ) ) );
+		t->setItem( row, 3, new QTableWidgetItem( QString::number( cycles / runs ) ) );
+	}
+
+	for( int op=1; op<32; op++ ) {
+		quint32 cycles = f32Profile.OpCycles[op] - f32ProfilePrev.OpCycles[op];
+		if( cycles == 0 ) continue;
+
+		int row = t->rowCount();
+		t->insertRow( row );
+		t->setItem( row, 0, new QTableWidgetItem( QString( "    op%1" ).arg( opNames[op] ) ) );
+		t->setItem( row, 1, new QTableWidgetItem( QString::number( cycles / updates ) ) );
+		t->setItem( row, 2, new QTableWidgetItem( LoopLoad( (double)cycles / updates, loopCycles ) ) );
+	}
+
+	ui->lblF32Profile->setText( QString( "F32 cog: %1 cycles per update, %2% of the update loop" )
+								.arg( streamTotal / updates ).arg( LoopLoad( (double)streamTotal / updates, loopCycles ) ) );
+}
+
+
+// Cycles below which the given fraction of the samples in a loop timing histogram fall, interpolated
+// within the bucket.  The last bucket has no upper end, so anything in it reports the bottom of it.
+static double LoopTimingPercentile( const quint32 * counts, quint32 total, double fraction )
+{
+	double target = total * fraction;
+	double below = 0;
+
+	for( int b=0; b<16; b++ ) {
+		if( counts[b] == 0 ) continue;
+		double lo = (b == 0) ? 0.0 : (double)(1 << (b+6));
+		if( b == 15 || below + counts[b] >= target ) {
+			if( b == 15 ) return lo;
+			double hi = (double)(1 << (b+7));
+			return lo + (hi - lo) * (target - below) / counts[b];
+		}
+		below += counts[b];
+	}
+	return 0.0;
+}
+
+void MainWindow::UpdateLoopTiming(void)
+{
+	static const char * LoopTimingNames[9] = { "Sensors", "IMU start", "Radio + controls", "Flight loop", "IMU wait", "Comms", "Scheduled tasks", "Whole loop",
+											   "Gyro filters, per axis" };
+	static const int LoopTimingDivide[9] = { 1, 1, 1, 1, 1, 1, 1, 1, 3 };		// the gyro filters are timed for all 3 axes together
+
+	const double CyclesPerUS = 80.0;
+
+	QTableWidget * t = ui->tblLoopTiming;
+	t->setRowCount(9);
+
+	for( int i=0; i<9; i++ )
+	{
+		quint32 total = 0;
+		for( int b=0; b<16; b++ ) total += loopTimingCounts[i][b];
+
+		t->setItem( i, 0, new QTableWidgetItem( LoopTimingNames[i] ) );
+		if( total == 0 ) {
+			for( int c=1; c<6; c++ ) t->setItem( i, c, new QTableWidgetItem( "" ) );
+			continue;
+		}
+
+		double p50 = LoopTimingPercentile( loopTimingCounts[i], total, 0.50 ) / LoopTimingDivide[i];
+		double p99 = LoopTimingPercentile( loopTimingCounts[i], total, 0.99 ) / LoopTimingDivide[i];
+
+		t->setItem( i, 1, new QTableWidgetItem( QString::number( p50 / CyclesPerUS, 'f', 0 ) ) );
+		t->setItem( i, 2, new QTableWidgetItem( QString::number( p99 / CyclesPerUS, 'f', 0 ) ) );
+		t->setItem( i, 3, new QTableWidgetItem( QString::number( loopTimingMax[i] / LoopTimingDivide[i] / CyclesPerUS, 'f', 0 ) ) );
+		t->setItem( i, 4, new QTableWidgetItem( LoopLoad( p99, loopCycles ) ) );
+		t->setItem( i, 5, new QTableWidgetItem( QString::number( total ) ) );
+	}
+
+	ui->lblLoopTiming->setText( QString( "Overruns: %1 (loops that ran past their time slot)" ).arg( loopOverruns ) );
+
+	// The scheduler's sub-rate tasks, in the firmware's Tasks[] order - the low voltage alarm is only on V3 boards
+	static const char * TaskNames[9] = { "Gyro zero", "Motor test", "Prefs save", "Beeper", "Cycle stats", "Battery read",
+										 "Battery discharge", "Battery charge", "Low voltage alarm" };
+
+	QTableWidget * tt = ui->tblTasks;
+	int rows = 0;
+	for( int i=0; i<9; i++ ) if( taskValid[i] ) rows = i+1;
+	tt->setRowCount( rows );
+
+	for( int i=0; i<rows; i++ )
+	{
+		tt->setItem( i, 0, new QTableWidgetItem( TaskNames[i] ) );
+		if( !taskValid[i] ) {
+			for( int c=1; c<6; c++ ) tt->setItem( i, c, new QTableWidgetItem( "" ) );
+			continue;
+		}
+
+		const LoopTimingData & lt = taskPrev[i];
+		tt->setItem( i, 1, new QTableWidgetItem( QString::number( lt.TaskPeriod ) ) );
+		tt->setItem( i, 2, new QTableWidgetItem( QString::number( lt.TaskBudget / CyclesPerUS, 'f', 0 ) ) );
+		tt->setItem( i, 3, new QTableWidgetItem( QString::number( taskMax[i] / CyclesPerUS, 'f', 0 ) ) );
+		tt->setItem( i, 4, new QTableWidgetItem( QString::number( taskRuns[i] ) ) );
+		tt->setItem( i, 5, new QTableWidgetItem( QString::number( taskOverruns[i] ) ) );
+	}
+}
+
+void MainWindow::ResetLoopTiming(void)
+{
+	for( int i=0; i<9; i++ ) {
+		loopTimingValid[i] = false;
+		loopTimingMax[i] = 0;
+		for( int b=0; b<16; b++ ) loopTimingCounts[i][b] = 0;
+
+		taskValid[i] = false;
+		taskRuns[i] = taskOverruns[i] = 0;
+		taskMax[i] = 0;
+	}
+	loopOverruns = 0;
+}
+
+void MainWindow::on_btnLoopTimingReset_clicked()
+{
+	ResetLoopTiming();
+	ui->tblLoopTiming->setRowCount(0);
+	ui->tblTasks->setRowCount(0);
+	ui->lblLoopTiming->setText( "Overruns: 0" );
+}
+
+
 void MainWindow::on_tabWidget_currentChanged(int index)
 {
 	(void)index;	// prevent compilation warning from unused variable
 
 	Mode newMode;
 	CancelThrottleCalibration();	// just in case
+	SendSubscription();				// Only stream what the new tab shows
 
 	if(ui->tabWidget->currentWidget() == ui->tpGyroCalib) {
 		newMode = GyroCalibration;
@@ -1030,15 +1355,15 @@ void MainWindow::ConfigureUIFromPreferences(void)
 	AttemptSetValue( ui->hsAutoRollPitchSpeed, (int)(Source + 0.5f) );
 
 	Source = prefs.AutoLevelYawRate;
-	Source = (Source * 2.0f) / (PI / 180.0f) * 1024.0f * 250.0f;
+	Source = (Source * 2.0f) / (PI / 180.0f) * 1024.0f * (float)Prefs_UpdateRate;
 	AttemptSetValue( ui->hsAutoYawSpeed, (int)(Source + 0.5f) / 10 );
 
 	Source = prefs.ManualRollPitchRate;
-	Source = (Source * 2.0f) / (PI / 180.0f) * 1024.0f * 250.0f;
+	Source = (Source * 2.0f) / (PI / 180.0f) * 1024.0f * (float)Prefs_UpdateRate;
 	AttemptSetValue( ui->hsManualRollPitchSpeed, (int)(Source + 0.5f) / 10 );
 
 	Source = prefs.ManualYawRate;
-	Source = (Source * 2.0f) / (PI / 180.0f) * 1024.0f * 250.0f;
+	Source = (Source * 2.0f) / (PI / 180.0f) * 1024.0f * (float)Prefs_UpdateRate;
 	AttemptSetValue( ui->hsManualYawSpeed, (int)(Source + 0.5f) / 10 );
 
 	ui->cb_FlightMode_Up->setCurrentIndex( prefs.FlightMode[2] );
@@ -1062,6 +1387,10 @@ void MainWindow::ConfigureUIFromPreferences(void)
 	ui->hsAccelCorrection->setValue( prefs.AccelCorrectionStrength );
 	ui->hsThrustCorrection->setValue( prefs.ThrustCorrectionScale );
 
+	AttemptSetValue( ui->sbGyroLowpass, prefs.GyroLowpass );
+	AttemptSetValue( ui->sbGyroNotch, prefs.GyroNotch );
+	AttemptSetValue( ui->sbGyroNotchWidth, prefs.GyroNotchWidth );
+
 
 	// System Setup
 	//----------------------------------------------------------------------------
@@ -1073,6 +1402,8 @@ void MainWindow::ConfigureUIFromPreferences(void)
 	AttemptSetValue( ui->sbHighThrottle, prefs.MaxThrottle / 8 );
 	AttemptSetValue( ui->sbTestThrottle, prefs.ThrottleTest / 8 );
 	ui->btnDisableMotors->setChecked(prefs.DisableMotors == 1);
+	ui->cbFrameType->setCurrentIndex( prefs.FrameType );
+	UpdateFrameTypeLabel();
 
 
 	AttemptSetValue( ui->sbLowVoltageAlarmThreshold, (double)prefs.LowVoltageAlarmThreshold / 100.0 );
@@ -1083,19 +1414,19 @@ void MainWindow::ConfigureUIFromPreferences(void)
 	switch( prefs.ArmDelay )
 	{
 		default:
-		case 250: ui->cbArmingDelay->setCurrentIndex(0); break;	// 1 sec
-		case 125: ui->cbArmingDelay->setCurrentIndex(1); break;	// 1/2 sec
-		case 62:  ui->cbArmingDelay->setCurrentIndex(2); break;	// 1/4 sec
-		case 0:   ui->cbArmingDelay->setCurrentIndex(3); break;	// none
+		case Prefs_UpdateRate:   ui->cbArmingDelay->setCurrentIndex(0); break;	// 1 sec
+		case Prefs_UpdateRate/2: ui->cbArmingDelay->setCurrentIndex(1); break;	// 1/2 sec
+		case Prefs_UpdateRate/4: ui->cbArmingDelay->setCurrentIndex(2); break;	// 1/4 sec
+		case 0:                  ui->cbArmingDelay->setCurrentIndex(3); break;	// none
 	}
 
 	switch(prefs.DisarmDelay)
 	{
 		default:
-		case 250: ui->cbDisarmDelay->setCurrentIndex(0); break;	// 1 sec
-		case 125: ui->cbDisarmDelay->setCurrentIndex(1); break;	// 1/2 sec
-		case 62:  ui->cbDisarmDelay->setCurrentIndex(2); break;	// 1/4 sec
-		case 0:   ui->cbDisarmDelay->setCurrentIndex(3); break;	// none
+		case Prefs_UpdateRate:   ui->cbDisarmDelay->setCurrentIndex(0); break;	// 1 sec
+		case Prefs_UpdateRate/2: ui->cbDisarmDelay->setCurrentIndex(1); break;	// 1/2 sec
+		case Prefs_UpdateRate/4: ui->cbDisarmDelay->setCurrentIndex(2); break;	// 1/4 sec
+		case 0:                  ui->cbDisarmDelay->setCurrentIndex(3); break;	// none
 	}
 
 
@@ -1248,15 +1579,15 @@ void MainWindow::on_btnUploadRadioChanges_clicked()
 	prefs.AutoLevelRollPitch = Rate;
 
 	Value = ui->hsAutoYawSpeed->value() * 10;
-	Rate = (((float)Value / 250.0f) / 1024.0f) * (PI / 180.0f) * 0.5f;
+	Rate = (((float)Value / (float)Prefs_UpdateRate) / 1024.0f) * (PI / 180.0f) * 0.5f;
 	prefs.AutoLevelYawRate = Rate;
 
 	Value = ui->hsManualRollPitchSpeed->value() * 10;
-	Rate = (((float)Value / 250.0f) / 1024.0f) * (PI / 180.0f) * 0.5f;
+	Rate = (((float)Value / (float)Prefs_UpdateRate) / 1024.0f) * (PI / 180.0f) * 0.5f;
 	prefs.ManualRollPitchRate = Rate;
 
 	Value = ui->hsManualYawSpeed->value() * 10;
-	Rate = (((float)Value / 250.0f) / 1024.0f) * (PI / 180.0f) * 0.5f;
+	Rate = (((float)Value / (float)Prefs_UpdateRate) / 1024.0f) * (PI / 180.0f) * 0.5f;
 	prefs.ManualYawRate = Rate;
 
 	prefs.FlightMode[0] = ui->cb_FlightMode_Down->currentIndex();
@@ -1582,6 +1913,10 @@ void MainWindow::on_btnUploadFlightChanges_clicked()
 	prefs.AccelCorrectionStrength = (unsigned char)ui->hsAccelCorrection->value();
 	prefs.ThrustCorrectionScale = (short)ui->hsThrustCorrection->value();
 
+	prefs.GyroLowpass = (quint8)ui->sbGyroLowpass->value();
+	prefs.GyroNotch = (quint8)ui->sbGyroNotch->value();
+	prefs.GyroNotchWidth = (quint8)ui->sbGyroNotchWidth->value();
+
 	// Apply the prefs to the elev-8
 	UpdateElev8Preferences();
 }
@@ -1593,7 +1928,7 @@ void MainWindow::on_btnUploadFlightChanges_clicked()
 
 void MainWindow::on_btnUploadSystemSetup_clicked()
 {
-	static qint16 DelayTable[] = {250, 125, 62, 0 };
+	static qint16 DelayTable[] = {Prefs_UpdateRate, Prefs_UpdateRate/2, Prefs_UpdateRate/4, 0 };
 
 	prefs.MinThrottle = (qint16)(ui->sbLowThrottle->value() * 8);
 	prefs.MinThrottleArmed = (qint16)(ui->sbArmedLowThrottle->value() * 8);
@@ -1609,6 +1944,8 @@ void MainWindow::on_btnUploadSystemSetup_clicked()
 	prefs.DisarmDelay = DelayTable[ui->cbDisarmDelay->currentIndex()];
 
 	prefs.DisableMotors = (quint8)(ui->btnDisableMotors->isChecked() ? 1 : 0);
+	prefs.FrameType = (quint8)ui->cbFrameType->currentIndex();
+	UpdateFrameTypeLabel();
 
 	UpdateElev8Preferences();
 }
@@ -1825,9 +2162,9 @@ void MainWindow::WriteSettings( QIODevice *file )
 
 	float RateScale = 2.0f / (PI/180.0f) * 1024.0;
 	WritePref( writer, "AutoLevelRollPitch", prefs.AutoLevelRollPitch * RateScale );
-	WritePref( writer, "AutoLevelYawRate", prefs.AutoLevelYawRate * RateScale * 250.0f );
-	WritePref( writer, "ManualRollPitchRate", prefs.ManualRollPitchRate * RateScale * 250.0f );
-	WritePref( writer, "ManualYawRate", prefs.ManualYawRate * RateScale * 250.0f );
+	WritePref( writer, "AutoLevelYawRate", prefs.AutoLevelYawRate * RateScale * (float)Prefs_UpdateRate );
+	WritePref( writer, "ManualRollPitchRate", prefs.ManualRollPitchRate * RateScale * (float)Prefs_UpdateRate );
+	WritePref( writer, "ManualYawRate", prefs.ManualYawRate * RateScale * (float)Prefs_UpdateRate );
 
 	WritePref( writer, "PitchGain", prefs.PitchGain );
 	WritePref( writer, "RollGain", prefs.RollGain );
@@ -1841,6 +2178,7 @@ void MainWindow::WriteSettings( QIODevice *file )
 
 	WritePref( writer, "UseBattMon", prefs.UseBattMon );
 	WritePref( writer, "DisableMotors", prefs.DisableMotors );
+	WritePref( writer, "FrameType", prefs.FrameType );
 	WritePref( writer, "LowVoltageAlarm", prefs.LowVoltageAlarm );
 	WritePref( writer, "LowVoltageAscentLimit", prefs.LowVoltageAscentLimit );
 
@@ -1854,6 +2192,9 @@ void MainWindow::WriteSettings( QIODevice *file )
 
 	WritePref( writer, "ThrustCorrectionScale", prefs.ThrustCorrectionScale );
 	WritePref( writer, "AccelCorrectionFilter", prefs.AccelCorrectionFilter );
+	WritePref( writer, "GyroLowpass", prefs.GyroLowpass );
+	WritePref( writer, "GyroNotch", prefs.GyroNotch );
+	WritePref( writer, "GyroNotchWidth", prefs.GyroNotchWidth );
 
 	WritePref( writer, "VoltageOffset", prefs.VoltageOffset );
 	WritePref( writer, "LowVoltageAlarmThreshold", prefs.LowVoltageAlarmThreshold );
@@ -2018,9 +2359,9 @@ void MainWindow::ReadSettingsContents( QXmlStreamReader & reader )
 			else if( reader.name() == "PitchCorrectCos")		ReadFloat(reader, prefs.PitchCorrectCos);
 
 			else if( reader.name() == "AutoLevelRollPitch")		ReadFloat(reader, prefs.AutoLevelRollPitch, RateScale );
-			else if( reader.name() == "AutoLevelYawRate")		ReadFloat(reader, prefs.AutoLevelYawRate, RateScale / 250.0f );
-			else if( reader.name() == "ManualRollPitchRate")	ReadFloat(reader, prefs.ManualRollPitchRate, RateScale / 250.0f );
-			else if( reader.name() == "ManualYawRate")			ReadFloat(reader, prefs.ManualYawRate, RateScale / 250.0f );
+			else if( reader.name() == "AutoLevelYawRate")		ReadFloat(reader, prefs.AutoLevelYawRate, RateScale / (float)Prefs_UpdateRate );
+			else if( reader.name() == "ManualRollPitchRate")	ReadFloat(reader, prefs.ManualRollPitchRate, RateScale / (float)Prefs_UpdateRate );
+			else if( reader.name() == "ManualYawRate")			ReadFloat(reader, prefs.ManualYawRate, RateScale / (float)Prefs_UpdateRate );
 
 			else if( reader.name() == "PitchGain")				ReadInt(reader, prefs.PitchGain);
 			else if( reader.name() == "RollGain")				ReadInt(reader, prefs.RollGain);
@@ -2033,6 +2374,7 @@ void MainWindow::ReadSettingsContents( QXmlStreamReader & reader )
 			else if( reader.name() == "ReceiverType")			ReadInt(reader, prefs.ReceiverType);
 			else if( reader.name() == "UseBattMon")				ReadInt(reader, prefs.UseBattMon);
 			else if( reader.name() == "DisableMotors")			ReadInt(reader, prefs.DisableMotors);
+			else if( reader.name() == "FrameType")				ReadInt(reader, prefs.FrameType);
 			else if( reader.name() == "LowVoltageAlarm")		ReadInt(reader, prefs.LowVoltageAlarm);
 			else if( reader.name() == "LowVoltageAscentLimit")	ReadInt(reader, prefs.LowVoltageAscentLimit);
 
@@ -2045,6 +2387,9 @@ void MainWindow::ReadSettingsContents( QXmlStreamReader & reader )
 			else if( reader.name() == "DisarmDelay")			ReadInt(reader, prefs.DisarmDelay);
 			else if( reader.name() == "ThrustCorrectionScale")	ReadInt(reader, prefs.ThrustCorrectionScale);
 			else if( reader.name() == "AccelCorrectionFilter")	ReadInt(reader, prefs.AccelCorrectionFilter);
+			else if( reader.name() == "GyroLowpass")			ReadInt(reader, prefs.GyroLowpass);
+			else if( reader.name() == "GyroNotch")				ReadInt(reader, prefs.GyroNotch);
+			else if( reader.name() == "GyroNotchWidth")			ReadInt(reader, prefs.GyroNotchWidth);
 			else if( reader.name() == "VoltageOffset")			ReadInt(reader, prefs.VoltageOffset);
 			else if( reader.name() == "LowVoltageAlarmThreshold")	ReadInt(reader, prefs.LowVoltageAlarmThreshold);
 
@@ -17,6 +17,7 @@ class QSlider;
 class QSpinBox;
 class QDoubleSpinBox;
 class QScrollBar;
+class ValueBar_Widget;
 
 
 namespace Ui {
@@ -37,6 +38,7 @@ public:
 	void UpdateStatus(void);
 	void SendCommand(const char *command);
 	void SendCommand(QString command);
+	void SendSubscription(void);
 	void ProcessPackets(void);
 
 	void ConfigureUIFromPreferences(void);
@@ -138,6 +140,8 @@ private slots:
 	void on_actionExport_Settings_to_File_triggered();
 	void on_actionImport_Settings_from_File_triggered();
 
+	void on_btnLoopTimingReset_clicked();
+
 
 private:
 	void FillChannelComboBox( QComboBox *cb , int defaultIndex );
@@ -150,6 +154,8 @@ private:
 	void AttemptSetValue( QDoubleSpinBox * slider , double value );
 	void AttemptSetValue( QScrollBar * slider , int value );
 	void SetReverseChannel(int channel, bool bReverse);
+	void SetMotorLayout( int frameType );
+	void UpdateFrameTypeLabel(void);
 
 	void TestMotor(int);
 	void CancelThrottleCalibration(void);
@@ -165,6 +171,9 @@ private:
 
 	void GetAccelAvgSasmple( int i );
 	void AddGraphSample( int GraphIndex , float SampleValue );
+	void UpdateF32Profile(void);
+	void UpdateLoopTiming(void);
+	void ResetLoopTiming(void);
 
 	QString m_sSettingsFile;
 
@@ -186,6 +195,7 @@ private:
 	QLabel * labelFWVersion;
 
 	int Heartbeat;
+	int sensorPeriod;	// Loops between sensor packets we asked for
 	int RadioMode;	// Mode == 1 or 2
 
 	Connection comm;
@@ -196,8 +206,26 @@ private:
 	QQuaternion q;
 	QQuaternion cq;
 	MotorData motors;
+	ValueBar_Widget * motorBars[8];		// left column top to bottom, then the right column
+	int motorLayout;					// frame type the motor bars are showing
+	int fcFrameType;					// frame type the FC says it's running, -1 until it has
 	ComputedData computed;
+	LinkData linkData;
 	DebugValues debugData;
+	F32ProfileData f32Profile, f32ProfilePrev;
+	bool f32ProfileValid;
+
+	LoopTimingData loopTimingPrev[9];			// last packet for each loop phase
+	bool loopTimingValid[9];
+	quint32 loopTimingCounts[9][16];			// totals since the last reset
+	int loopTimingMax[9];
+	quint32 loopOverruns;
+	int loopCycles;								// clock cycles in one update loop, from the FC - 0 until it has sent them
+
+	LoopTimingData taskPrev[9];					// last packet for each scheduler task
+	bool taskValid[9];
+	quint32 taskRuns[9], taskOverruns[9];		// totals since the last reset
+	int taskMax[9];
 
 	float accXCal[4];
 	float accYCal[4];
@@ -28,6 +28,10 @@
 
 typedef unsigned char byte;
 
+// Per-update rates and the arm / disarm delays are stored as if the flight loop ran at this rate -
+// must match Prefs_UpdateRate in the firmware prefs.h
+#define Prefs_UpdateRate  250
+
 
 typedef struct {
 	int DriftScaleX,  DriftScaleY,  DriftScaleZ;
@@ -54,7 +58,7 @@ typedef struct {
 	byte  unused;
 
 	byte  ReceiverType;     // 0 = PWM, 1 = SBUS, 2 = PPM
-	byte  unused2;
+	byte  FrameType;        // 0 = Quad X, 1 = Quad +, 2 = Hex X, 3 = Octo X, 4 = Y6 - read by the FC at power up
 	byte  UseBattMon;
 	byte  DisableMotors;
 
@@ -105,6 +109,11 @@ typedef struct {
 	short Aux2Center;
 	short Aux3Center;
 
+	byte  GyroLowpass;      // Gyro lowpass ahead of the rate PIDs, -3dB point in Hz - 0 = off
+	byte  GyroNotch;        // Gyro notch ahead of the rate PIDs, center in Hz - 0 = off
+	byte  GyroNotchWidth;   // Notch bandwidth in Hz
+	byte  unused2;
+
 	int   Checksum;
 
 	// Accessors for looping over channel assignments, scales, centers